@@ -6,6 +6,7 @@ extern "C" {
 
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 const char* qjson_version();
@@ -34,25 +35,849 @@ typedef struct
  */
 bool qjson_parse_string(const char* input, const qjson_parse_callbacks* callbacks, void* context);
 
+/**
+ * Parse a length-delimited JSON document in place.
+ * The input is neither copied nor modified, and does not need to be null terminated.
+ * Strings are unescaped into a separate scratch area before being passed to the callbacks.
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_buffer(const char* data, size_t length, const qjson_parse_callbacks* callbacks, void* context);
+
+/**
+ * Parse a JSON file in place, by mapping it into memory rather than reading it into a buffer.
+ * The page cache holds the only copy of the document.
+ *
+ * @param path The path of the file to parse.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful. If the file could not be opened or mapped, on_parse_error says why.
+ */
+bool qjson_parse_file(const char* path, const qjson_parse_callbacks* callbacks, void* context);
+
+
+/**
+ * A push-mode parser that accepts a document in arbitrarily sized chunks.
+ * Callbacks fire as soon as each value is complete, and tokens that are split
+ * across chunk boundaries are reassembled internally.
+ */
+typedef struct qjson_parser qjson_parser;
+
+/**
+ * Create a new push-mode parser.
+ *
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return The new parser, or NULL if memory could not be allocated.
+ */
+qjson_parser* qjson_new_parser(const qjson_parse_callbacks* callbacks, void* context);
+
+/**
+ * Where a parser gets its memory from.
+ */
+typedef struct
+{
+    // Returns a block of at least size bytes, aligned for any type, or NULL if there is no memory left.
+    void* (*allocate) (void* context, size_t size);
+    // Gives back a block from allocate. May be NULL if blocks never need to be given back.
+    void  (*free)     (void* context, void* memory);
+    // Passed directly to allocate and free.
+    void* context;
+} qjson_allocator;
+
+/**
+ * Create a new push-mode parser that takes all of its memory from an allocator, including the parser itself.
+ *
+ * @param allocator The allocator, which is copied into the parser.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return The new parser, or NULL if memory could not be allocated.
+ */
+qjson_parser* qjson_new_parser_with_allocator(const qjson_allocator* allocator,
+                                              const qjson_parse_callbacks* callbacks,
+                                              void* context);
+
+/**
+ * Create a new push-mode parser inside a fixed memory region. The parser and everything it needs are carved
+ * out of the region, and nothing is allocated from the heap. Memory is never given back to the region, so a
+ * parser that is reset and reused keeps whatever it has grown to.
+ *
+ * If the region runs out while parsing, the parse fails with the error "Arena too small".
+ *
+ * @param memory The memory region, which must outlive the parser. Freeing the parser is optional.
+ * @param size The size of the region in bytes. A few kilobytes is enough for most documents.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return The new parser, or NULL if the region is too small to hold it.
+ */
+qjson_parser* qjson_new_parser_in_arena(void* memory, size_t size, const qjson_parse_callbacks* callbacks, void* context);
+
+/**
+ * Parse a length-delimited JSON document in place, using only a fixed memory region.
+ * See qjson_new_parser_in_arena().
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @param memory The memory region to parse in.
+ * @param size The size of the region in bytes.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_buffer_in_arena(const char* data,
+                                 size_t length,
+                                 const qjson_parse_callbacks* callbacks,
+                                 void* context,
+                                 void* memory,
+                                 size_t size);
+
+/**
+ * Free a parser and all memory associated with it.
+ *
+ * @param parser The parser to free (may be NULL).
+ */
+void qjson_free_parser(qjson_parser* parser);
+
+/**
+ * Feed the next chunk of the document to a parser.
+ * The chunk does not need to end on a token boundary, and need not remain valid after this call returns.
+ *
+ * @param parser The parser.
+ * @param chunk The start of the chunk.
+ * @param length The length of the chunk in bytes.
+ * @return true if the document is still valid so far.
+ */
+bool qjson_feed_parser(qjson_parser* parser, const char* chunk, size_t length);
+
+/**
+ * Signal the end of the document to a parser.
+ *
+ * @param parser The parser.
+ * @return true if a complete, valid document was parsed.
+ */
+bool qjson_finish_parser(qjson_parser* parser);
+
+/**
+ * Reset a parser so that it can be reused for a new document.
+ * Internal buffers and stacks are kept, so a warm parser does not allocate memory for documents
+ * similar in size to ones it has already parsed.
+ *
+ * @param parser The parser.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ */
+void qjson_reset_parser(qjson_parser* parser, const qjson_parse_callbacks* callbacks, void* context);
+
+/**
+ * Reset a parser and use it to parse a complete length-delimited document in place.
+ *
+ * @param parser The parser.
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_buffer_with_parser(qjson_parser* parser,
+                                    const char* data,
+                                    size_t length,
+                                    const qjson_parse_callbacks* callbacks,
+                                    void* context);
+
+/**
+ * Take a parser from the calling thread's pool, creating one only if the pool is empty.
+ * Pooled parsers keep their buffers warm between documents, and are freed automatically when the thread exits.
+ * qjson_parse_string() and qjson_parse_buffer() use this pool internally.
+ *
+ * @return A parser to be returned with qjson_release_thread_parser(), or NULL if memory could not be allocated.
+ */
+qjson_parser* qjson_acquire_thread_parser(void);
+
+/**
+ * Return a parser to the calling thread's pool.
+ *
+ * @param parser The parser, which must have been acquired on the same thread.
+ */
+void qjson_release_thread_parser(qjson_parser* parser);
+
+
+/**
+ * What the parser should do after an action callback returns.
+ */
+typedef enum
+{
+    // Carry on parsing.
+    QJSON_CONTINUE,
+    // Skip the rest of the current container: the one just started if the callback was on_list_start or
+    // on_map_start, and otherwise the one holding the value. The skipped contents are only checked for balanced
+    // brackets and terminated strings. The container's end callback is still called. At the top level of the
+    // document there is no container to skip, and this acts like QJSON_CONTINUE.
+    QJSON_SKIP_CONTAINER,
+    // Stop parsing. The parse is reported as successful, and any further input is ignored.
+    QJSON_STOP,
+} qjson_action;
+
+/**
+ * A fixed set of map keys, compiled into a perfect hash table so that keys can be identified by number.
+ */
+typedef struct qjson_key_set qjson_key_set;
+
+// The ID given to map keys that are not in the key set.
+#define QJSON_UNKNOWN_KEY -1
+
+/**
+ * Compile a set of map keys. Each key's ID is its index in keys.
+ *
+ * @param keys The keys, which must be valid UTF-8 and distinct.
+ * @param key_count The number of keys.
+ * @return The new key set, or NULL if a key is invalid or repeated, or memory could not be allocated.
+ */
+qjson_key_set* qjson_new_key_set(const char* const* keys, size_t key_count);
+
+/**
+ * Free a key set.
+ *
+ * @param set The key set to free (may be NULL).
+ */
+void qjson_free_key_set(qjson_key_set* set);
+
+// The current version of qjson_action_callbacks. Later versions only add callbacks at the end of the table.
+// Version 2 added on_map_key and key_set, and version 3 added on_number_raw.
+#define QJSON_ACTION_CALLBACKS_VERSION 3
+
+// Flags passed to on_number_raw. A number with neither flag is an integer.
+#define QJSON_NUMBER_HAS_FRACTION 1
+#define QJSON_NUMBER_HAS_EXPONENT 2
+
+/**
+ * Callbacks that steer the parser by returning an action.
+ */
+typedef struct
+{
+    // Set to QJSON_ACTION_CALLBACKS_VERSION.
+    int version;
+    void         (*on_parse_error) (void* context, const char* message);
+    qjson_action (*on_null)        (void* context);
+    qjson_action (*on_boolean)     (void* context, bool value);
+    qjson_action (*on_int)         (void* context, int64_t value);
+    qjson_action (*on_float)       (void* context, double value);
+    qjson_action (*on_string)      (void* context, const char* value);
+    qjson_action (*on_list_start)  (void* context);
+    qjson_action (*on_list_end)    (void* context);
+    qjson_action (*on_map_start)   (void* context);
+    qjson_action (*on_map_end)     (void* context);
+    // Called for map keys instead of on_string, if set. key_id is the key's ID in key_set, or QJSON_UNKNOWN_KEY.
+    // Keys in the set are matched without being unescaped, and key then points to the set's own copy.
+    qjson_action (*on_map_key)     (void* context, const char* key, size_t length, int key_id);
+    // The keys to identify for on_map_key (may be NULL).
+    const qjson_key_set* key_set;
+    // Called for numbers instead of on_int and on_float, if set, with the number's text exactly as it appears in
+    // the document. The number is checked against the JSON grammar but not converted, so it is never out of range.
+    // flags holds QJSON_NUMBER_HAS_FRACTION and QJSON_NUMBER_HAS_EXPONENT as they apply.
+    qjson_action (*on_number_raw)  (void* context, const char* start, size_t length, int flags);
+} qjson_action_callbacks;
+
+/**
+ * Convert the text of a JSON integer, such as one delivered to on_number_raw.
+ *
+ * @param start The start of the number.
+ * @param length The length of the number in bytes.
+ * @param value Receives the value.
+ * @return false if the text is not exactly one JSON integer, or the integer does not fit in an int64.
+ */
+bool qjson_number_to_int64(const char* start, size_t length, int64_t* value);
+
+/**
+ * Convert the text of any JSON number to the nearest double, such as one delivered to on_number_raw.
+ * Integers of any size are converted, rounding as for floats.
+ *
+ * @param start The start of the number.
+ * @param length The length of the number in bytes.
+ * @param value Receives the value.
+ * @return false if the text is not exactly one JSON number, or the number is too large for a double.
+ */
+bool qjson_number_to_double(const char* start, size_t length, double* value);
+
+// The outcome of qjson_parse_number().
+typedef enum
+{
+    QJSON_NUMBER_OK,
+    // The input ended partway through the number.
+    QJSON_NUMBER_INCOMPLETE,
+    // The input does not follow the JSON number grammar.
+    QJSON_NUMBER_INVALID,
+    // An integer does not fit in an int64, or a float overflows a double.
+    QJSON_NUMBER_OUT_OF_RANGE,
+} qjson_number_status;
+
+typedef struct
+{
+    // Points past the number on success, or at the offending character on failure.
+    const char* end;
+    bool is_float;
+    int64_t int_value;
+    double float_value;
+} qjson_number;
+
+/**
+ * Convert the JSON number at the start of [start, end), for parsers built on top of this library.
+ * Parsing stops at the first character that cannot continue the number; that character is not checked.
+ * A number without a fraction or an exponent is an integer, and must fit in an int64.
+ *
+ * @param start The start of the number.
+ * @param end The end of the available input.
+ * @param number Receives the result.
+ * @return The status of the conversion.
+ */
+qjson_number_status qjson_parse_number(const char* start, const char* end, qjson_number* number);
+
+// The outcome of qjson_decode_string().
+typedef enum
+{
+    QJSON_STRING_OK,
+    QJSON_STRING_BAD_ESCAPE,
+    QJSON_STRING_BAD_UTF8,
+    // A control character (below 0x20) that is not escaped.
+    QJSON_STRING_CONTROL_CHARACTER,
+} qjson_string_status;
+
+/**
+ * Unescape the contents of a JSON string (without the surrounding quotes) and validate them as UTF-8,
+ * for parsers built on top of this library. Unescaped control characters are rejected.
+ * The output is never longer than the input, and may be written over it (dst == start).
+ *
+ * @param start The start of the string contents.
+ * @param end The end of the string contents.
+ * @param dst Receives the decoded string, which is not null terminated. Must have room for end - start bytes.
+ * @param length Receives the length of the decoded string on success.
+ * @param error_pos Receives the offending escape sequence, UTF-8 sequence or control character on failure.
+ * @return The status of the decode.
+ */
+qjson_string_status qjson_decode_string(const char* start, const char* end, char* dst, size_t* length, const char** error_pos);
+
+/**
+ * Parse a length-delimited JSON document in place, letting the callbacks skip containers or stop early.
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful, or was stopped by a callback before any error.
+ */
+bool qjson_parse_buffer_with_actions(const char* data,
+                                     size_t length,
+                                     const qjson_action_callbacks* callbacks,
+                                     void* context);
+
+/**
+ * Reset a parser so that it can be reused for a new document, delivering events to action callbacks.
+ * This is also how a push-mode parser is given action callbacks.
+ *
+ * @param parser The parser.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ */
+void qjson_reset_parser_with_actions(qjson_parser* parser, const qjson_action_callbacks* callbacks, void* context);
+
+
+typedef enum
+{
+    QJSON_EVENT_NULL,
+    QJSON_EVENT_FALSE,
+    QJSON_EVENT_TRUE,
+    QJSON_EVENT_INT,
+    QJSON_EVENT_FLOAT,
+    QJSON_EVENT_STRING,
+    QJSON_EVENT_MAP_KEY,
+    QJSON_EVENT_LIST_START,
+    QJSON_EVENT_LIST_END,
+    QJSON_EVENT_MAP_START,
+    QJSON_EVENT_MAP_END,
+} qjson_event_type;
+
+/**
+ * A parse event, as delivered in batches.
+ */
+typedef struct
+{
+    // A qjson_event_type.
+    uint32_t type;
+    // The number of containers the event is inside. A container's start and end are at the depth of its parent.
+    uint32_t depth;
+    union
+    {
+        int64_t int_value;
+        double float_value;
+        // The unescaped contents of a string or map key, which are not null terminated.
+        const char* string;
+    };
+    size_t string_length;
+} qjson_event;
+
+/**
+ * Callbacks that receive the parse events in batches.
+ */
+typedef struct
+{
+    void (*on_parse_error) (void* context, const char* message);
+    // Called with the events parsed so far whenever the event array fills, and at the end of every buffer.
+    // The strings the events point to are only valid until the callback returns.
+    void (*on_events)      (void* context, const qjson_event* events, size_t count);
+} qjson_event_callbacks;
+
+/**
+ * Parse a length-delimited JSON document in place, delivering the events in batches rather than one call each.
+ * Events that come before an error are delivered before on_parse_error is called.
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to deliver the batches to.
+ * @param events The array to fill with events.
+ * @param event_capacity The number of events the array can hold (at least 1).
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_buffer_batched(const char* data,
+                                size_t length,
+                                const qjson_event_callbacks* callbacks,
+                                qjson_event* events,
+                                size_t event_capacity,
+                                void* context);
+
+/**
+ * Reset a parser so that it can be reused for a new document, delivering events in batches.
+ * This is also how a push-mode parser is given batch callbacks. Each call to qjson_feed_parser() delivers
+ * the events from its chunk before returning.
+ *
+ * @param parser The parser.
+ * @param callbacks The callbacks to deliver the batches to.
+ * @param events The array to fill with events, which must outlive the parse.
+ * @param event_capacity The number of events the array can hold (at least 1).
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ */
+void qjson_reset_parser_batched(qjson_parser* parser,
+                                const qjson_event_callbacks* callbacks,
+                                qjson_event* events,
+                                size_t event_capacity,
+                                void* context);
+
+
+typedef struct
+{
+    void (*on_document_start) (void* context, size_t document_index);
+    void (*on_document_end)   (void* context, size_t document_index);
+} qjson_document_callbacks;
+
+typedef enum
+{
+    // Documents are delivered one at a time, in the order they appear in the input.
+    QJSON_DOCUMENTS_IN_ORDER,
+    // Documents are delivered as soon as they are parsed, possibly from several threads at once.
+    // The events of any one document are always delivered together, on a single thread.
+    QJSON_DOCUMENTS_ANY_ORDER,
+} qjson_document_order;
+
+/**
+ * Parse a buffer of newline-delimited or concatenated JSON documents (NDJSON / JSON Lines), using multiple threads.
+ * The buffer is split into chunks at newlines between documents, and the chunks are parsed in parallel.
+ * Documents may span several lines.
+ *
+ * Events are delivered per document, bracketed by on_document_start and on_document_end, with each document
+ * numbered by its position in the buffer. The callbacks are called from the calling thread and from worker threads.
+ *
+ * On error, every document before the failing one is delivered, followed by the failing document's events up to
+ * the error and then on_parse_error. No later documents are delivered.
+ *
+ * @param data The start of the documents to parse.
+ * @param length The length of the buffer in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param document_callbacks The callbacks to call at the start and end of each document.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @param thread_count The number of threads to parse with, including the calling thread (0 = one per CPU).
+ * @param order The order to deliver documents in.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_documents(const char* data,
+                           size_t length,
+                           const qjson_parse_callbacks* callbacks,
+                           const qjson_document_callbacks* document_callbacks,
+                           void* context,
+                           int thread_count,
+                           qjson_document_order order);
+
+/**
+ * Parse a document that is one large top-level list, parsing its elements in parallel.
+ * The list is cut between top-level elements (never inside a string or a nested container), and the pieces are
+ * parsed concurrently.
+ *
+ * Each element's events are bracketed by on_document_start and on_document_end, with the element's index in the
+ * list as the document index. Every thread delivers the elements it parses to its own context, so the elements
+ * of the list are spread across the contexts, and each context only ever sees calls from one thread at a time.
+ * The calling thread uses thread_contexts[0].
+ *
+ * On error, on_parse_error is called on the context of the thread that found the error, which stops the other
+ * threads after the chunk they are working on. A chunk holds up to 1 MiB of elements, so elements after the failing
+ * one may already have been delivered, or still be delivered before this returns.
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param element_callbacks The callbacks to call at the start and end of each element.
+ * @param thread_contexts One user-supplied context object per thread, passed directly to the callback functions.
+ * @param thread_count The number of threads to parse with, including the calling thread.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_list_elements(const char* data,
+                               size_t length,
+                               const qjson_parse_callbacks* callbacks,
+                               const qjson_document_callbacks* element_callbacks,
+                               void* const* thread_contexts,
+                               int thread_count);
+
+
+/**
+ * A parsed document, stored as a flat tape of 64-bit words in a single growable buffer.
+ * Strings and numbers are stored inline, and every container records where it ends, so that
+ * it can be skipped in constant time. Reading the document only touches the tape.
+ */
+typedef struct qjson_document qjson_document;
+
+/**
+ * A position on a document's tape. Values stay valid until their document is parsed into again or freed.
+ */
+typedef struct
+{
+    const uint64_t* word;
+} qjson_value;
+
+typedef enum
+{
+    // Not a value: a missing map field, or the position after the last entry of a container.
+    QJSON_TYPE_NONE,
+    QJSON_TYPE_NULL,
+    QJSON_TYPE_BOOLEAN,
+    QJSON_TYPE_INT,
+    QJSON_TYPE_FLOAT,
+    QJSON_TYPE_STRING,
+    QJSON_TYPE_LIST,
+    QJSON_TYPE_MAP,
+} qjson_type;
+
+/**
+ * Create a new, empty document.
+ *
+ * @return The new document, or NULL if memory could not be allocated.
+ */
+qjson_document* qjson_new_document(void);
+
+/**
+ * Free a document and its tape.
+ *
+ * @param document The document to free (may be NULL).
+ */
+void qjson_free_document(qjson_document* document);
+
+/**
+ * Parse a length-delimited JSON document into a document, replacing its previous contents.
+ * The tape is kept between parses, so a reused document does not allocate memory for inputs
+ * similar in size to ones it has already held.
+ *
+ * @param document The document to parse into.
+ * @param data The start of the JSON text.
+ * @param length The length of the JSON text in bytes.
+ * @return true if parsing was successful. On failure, qjson_document_error() describes the problem.
+ */
+bool qjson_parse_into_document(qjson_document* document, const char* data, size_t length);
+
+/**
+ * Get the reason that the last parse into a document failed.
+ *
+ * @param document The document.
+ * @return The error message, or NULL if the last parse succeeded.
+ */
+const char* qjson_document_error(const qjson_document* document);
+
+/**
+ * Get the top-level value of a document.
+ *
+ * @param document The document.
+ * @return The top-level value, or a QJSON_TYPE_NONE value if the last parse failed.
+ */
+qjson_value qjson_document_root(const qjson_document* document);
+
+/**
+ * Get the type of a value.
+ *
+ * @param value The value.
+ * @return The value's type.
+ */
+qjson_type qjson_value_type(qjson_value value);
+
+/**
+ * Get the contents of a boolean value.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_BOOLEAN.
+ * @return The boolean.
+ */
+bool qjson_value_boolean(qjson_value value);
+
+/**
+ * Get the contents of an integer value.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_INT.
+ * @return The integer.
+ */
+int64_t qjson_value_int(qjson_value value);
+
+/**
+ * Get the contents of a floating point value.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_FLOAT.
+ * @return The floating point number.
+ */
+double qjson_value_float(qjson_value value);
+
+/**
+ * Get the contents of a string value.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_STRING.
+ * @param length Receives the length of the string in bytes (may be NULL).
+ * @return The null terminated string, which lives on the document's tape.
+ */
+const char* qjson_value_string(qjson_value value, size_t* length);
+
+/**
+ * Get the number of entries in a container, in constant time.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_LIST or QJSON_TYPE_MAP.
+ * @return The number of elements in a list, or of key-value pairs in a map.
+ */
+size_t qjson_value_count(qjson_value value);
+
+/**
+ * Get the first entry of a container.
+ * The entries of a map alternate between keys and values.
+ *
+ * @param value The value.
+ * @return The first entry, or a QJSON_TYPE_NONE value if the container is empty or the value is not a container.
+ */
+qjson_value qjson_value_first(qjson_value value);
+
+/**
+ * Get the entry that follows a value in its container, skipping over the value in constant time.
+ *
+ * @param value The value.
+ * @return The next entry, or a QJSON_TYPE_NONE value after the last entry.
+ */
+qjson_value qjson_value_next(qjson_value value);
+
+/**
+ * Look up the value that a map associates with a key.
+ *
+ * @param value The value, which must be of type QJSON_TYPE_MAP.
+ * @param key The key to look up.
+ * @return The field's value, or a QJSON_TYPE_NONE value if the map has no such key.
+ */
+qjson_value qjson_value_field(qjson_value value, const char* key);
+
+
+/**
+ * A lazy cursor over a JSON document in a buffer.
+ * Nothing is parsed up front: values are only validated and converted when they are read, and values that are
+ * passed over are skipped by matching brackets and quotes. Malformed input is only detected where the cursor
+ * touches it.
+ *
+ * Cursors are plain values. Copy one to remember a position.
+ */
+typedef struct
+{
+    // The start of the current value.
+    const char* pos;
+    const char* end;
+} qjson_cursor;
+
+/**
+ * Create a cursor positioned at the top-level value of a document.
+ * The document is not copied, and must stay valid for as long as the cursor is used.
+ *
+ * @param data The start of the document.
+ * @param length The length of the document in bytes.
+ * @return The new cursor.
+ */
+qjson_cursor qjson_new_cursor(const char* data, size_t length);
+
+/**
+ * Get the type of the value at a cursor, judging by its first character.
+ *
+ * @param cursor The cursor.
+ * @return The value's type, or QJSON_TYPE_NONE if the cursor is not at a value.
+ */
+qjson_type qjson_cursor_type(const qjson_cursor* cursor);
+
+/**
+ * Move a cursor from a list or map to its first entry.
+ * The entries of a map alternate between keys and values.
+ *
+ * @param cursor The cursor, which is left unchanged on failure.
+ * @return true if the cursor moved, or false if the value is not a container or is empty.
+ */
+bool qjson_cursor_enter(qjson_cursor* cursor);
+
+/**
+ * Move a cursor past the current entry to the next one in its container, skipping over the entry unparsed.
+ * In a map, this moves from a key to its value, and from a value to the next key.
+ *
+ * @param cursor The cursor, which is left unchanged on failure.
+ * @return true if the cursor moved, or false at the last entry or if the input is malformed.
+ */
+bool qjson_cursor_next(qjson_cursor* cursor);
+
+/**
+ * Move a cursor from a map to the value of one of its fields. The values of other fields are skipped unparsed.
+ *
+ * @param cursor The cursor, which is left unchanged on failure.
+ * @param key The key to look for.
+ * @return true if the field was found.
+ */
+bool qjson_cursor_find_field(qjson_cursor* cursor, const char* key);
+
+/**
+ * Read the value at a cursor as a boolean.
+ *
+ * @param cursor The cursor.
+ * @param value Receives the boolean.
+ * @return false if the value is not a boolean.
+ */
+bool qjson_cursor_get_boolean(const qjson_cursor* cursor, bool* value);
+
+/**
+ * Read the value at a cursor as an integer.
+ *
+ * @param cursor The cursor.
+ * @param value Receives the integer.
+ * @return false if the value is not an integer, or does not fit in an int64.
+ */
+bool qjson_cursor_get_int64(const qjson_cursor* cursor, int64_t* value);
 
+/**
+ * Read the value at a cursor as a floating point number. Integers are converted.
+ *
+ * @param cursor The cursor.
+ * @param value Receives the number.
+ * @return false if the value is not a number, or is out of range.
+ */
+bool qjson_cursor_get_double(const qjson_cursor* cursor, double* value);
+
+/**
+ * Read the value at a cursor as a string, unescaping it and validating it as UTF-8.
+ *
+ * @param cursor The cursor.
+ * @param buffer Receives the null terminated string.
+ * @param buffer_size The size of the buffer, which must be at least one byte longer than the encoded string.
+ * @param length Receives the length of the string, or if the buffer is too small, the buffer size required.
+ * @return false if the value is not a valid string, or the buffer is too small.
+ */
+bool qjson_cursor_get_string(const qjson_cursor* cursor, char* buffer, size_t buffer_size, size_t* length);
+
+
+/**
+ * A compiled set of paths that selects which parts of a document to parse.
+ */
+typedef struct qjson_path_filter qjson_path_filter;
+
+#define QJSON_MAX_FILTER_PATHS 64
+
+/**
+ * Compile a set of paths into a filter.
+ *
+ * Paths are JSON Pointers (RFC 6901), such as "/user/id" or "/events/0/ts". In addition, a segment consisting of
+ * a single asterisk matches every key of a map or every element of a list. The empty path "" selects the whole
+ * document.
+ *
+ * @param paths The paths to select.
+ * @param path_count The number of paths, up to QJSON_MAX_FILTER_PATHS.
+ * @return The new filter, or NULL if a path is malformed, there are too many paths, or memory could not be allocated.
+ */
+qjson_path_filter* qjson_new_path_filter(const char* const* paths, size_t path_count);
+
+/**
+ * Free a path filter.
+ *
+ * @param filter The filter to free (may be NULL).
+ */
+void qjson_free_path_filter(qjson_path_filter* filter);
+
+/**
+ * Parse a length-delimited JSON document, delivering only the values that a filter selects.
+ *
+ * The callbacks see the document as if everything outside the selected paths had been removed: selected values
+ * are delivered in full, along with the containers and map keys that lead to them. Containers that hold no
+ * selected values are not delivered at all, so list elements lose their original positions.
+ *
+ * Everything outside the selected paths is skipped by matching brackets and quotes, without being converted or
+ * unescaped, and is only checked for being properly terminated.
+ *
+ * @param data The start of the document to parse.
+ * @param length The length of the document in bytes.
+ * @param filter The paths to deliver.
+ * @param callbacks The callbacks to call as the parser encounters selected entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if parsing was successful.
+ */
+bool qjson_parse_buffer_filtered(const char* data,
+                                 size_t length,
+                                 const qjson_path_filter* filter,
+                                 const qjson_parse_callbacks* callbacks,
+                                 void* context);
+
+
+
+/**
+ * Where an encoder's output goes when its buffer fills up. Set one of flush or grow.
+ */
+typedef struct
+{
+    // Takes the bytes encoded so far, after which the encoder reuses the whole buffer. Return false to fail the encode.
+    bool (*flush)(void* context, const uint8_t* data, size_t length);
+    // Resizes the buffer to size bytes, keeping its contents as realloc() does. Return NULL to fail the encode.
+    uint8_t* (*grow)(void* context, uint8_t* memory, size_t size);
+    void* context;
+} qjson_encode_sink;
 
 typedef struct
 {
-    const uint8_t* const start;
-    const uint8_t* const end;
+    // Moved by the sink's grow callback.
+    uint8_t* start;
+    uint8_t* end;
     uint8_t* pos;
+    const qjson_encode_sink* sink;
     int indent_spaces;
     int float_digits_precision;
     int container_level;
-    bool is_inside_map[200];
     bool is_first_in_document;
     bool is_first_in_container;
     bool next_object_is_map_key;
+    // Set if container_overflow was allocated through container_allocator, rather than supplied by the caller.
+    bool is_container_overflow_allocated;
+    // One bit per open container (1 = map). The first 64 levels are kept inline, and the rest in container_overflow.
+    uint64_t container_bits;
+    uint64_t* container_overflow;
+    size_t container_overflow_word_count;
+    const qjson_allocator* container_allocator;
 } qjson_encode_context;
 
+// The deepest a context can nest containers without any container storage.
+#define QJSON_ENCODE_INLINE_DEPTH 64
+
 
 #define DEFAULT_INDENT_SPACES 0
 #define DEFAULT_FLOAT_DIGITS_PRECISION 15
+// Floats are written in the shortest form that reads back as the same double.
+#define QJSON_FLOAT_PRECISION_SHORTEST 0
 
 /**
  * Create a new encoding context metadata object.
@@ -60,7 +885,8 @@ typedef struct
  * @param memory_start The start of the context's memory.
  * @param memory_end The end of the context's memory.
  * @param indent_spaces The number of spaces to indent for pretty printing (0 = don't pretty print).
- * @param float_digits_precision The number of significant digits to print for floating point numbers.
+ * @param float_digits_precision The number of significant digits to print for floating point numbers,
+ *                               up to 17 (QJSON_FLOAT_PRECISION_SHORTEST = as few as will read back as the same double).
  * @return The new context.
  */
 qjson_encode_context qjson_new_encode_context_with_config(uint8_t* const memory_start,
@@ -68,6 +894,52 @@ qjson_encode_context qjson_new_encode_context_with_config(uint8_t* const memory_
                                                           int indent_spaces,
                                                           int float_digits_precision);
 
+/**
+ * Create a new encoding context metadata object that hands its output to a sink whenever the buffer fills up,
+ * so that documents of any size can be encoded through a buffer of fixed size, or into one that grows.
+ *
+ * With a flush sink, qjson_end_encoding() flushes what remains (without a null terminator). The buffer must
+ * still be able to hold the longest number and the deepest line of indentation.
+ * With a grow sink, the encoded document is in [context.start, context.pos) once encoding ends.
+ *
+ * @param memory_start The start of the context's memory.
+ * @param memory_end The end of the context's memory.
+ * @param indent_spaces The number of spaces to indent for pretty printing (0 = don't pretty print).
+ * @param float_digits_precision The number of significant digits to print for floating point numbers.
+ * @param sink The sink to hand the output to. It must outlive the context.
+ * @return The new context.
+ */
+qjson_encode_context qjson_new_encode_context_with_sink(uint8_t* const memory_start,
+                                                        uint8_t* const memory_end,
+                                                        int indent_spaces,
+                                                        int float_digits_precision,
+                                                        const qjson_encode_sink* sink);
+
+/**
+ * Give a context room to nest containers deeper than QJSON_ENCODE_INLINE_DEPTH. Each word of storage holds
+ * 64 more levels. With an allocator, the storage grows as needed, and qjson_release_encode_context() must
+ * be called once the context is no longer used. Without one, starting a container beyond the storage fails.
+ *
+ * Call this before adding anything to the context.
+ *
+ * @param context The context to configure.
+ * @param words The caller's storage (can be NULL). It must outlive the context, and is never freed.
+ * @param word_count The number of words at words.
+ * @param allocator The allocator to grow the storage with (can be NULL). It must outlive the context.
+ *                  If its allocate function is NULL, malloc and free are used instead.
+ */
+void qjson_set_encode_container_storage(qjson_encode_context* const context,
+                                        uint64_t* words,
+                                        size_t word_count,
+                                        const qjson_allocator* allocator);
+
+/**
+ * Free any container storage that a context has allocated.
+ *
+ * @param context The context to release.
+ */
+void qjson_release_encode_context(qjson_encode_context* const context);
+
 /**
  * Create a new encoding context metadata object with the default configuration.
  *
@@ -104,8 +976,35 @@ bool qjson_add_boolean(qjson_encode_context* const context, const bool value);
 bool qjson_add_integer(qjson_encode_context* const context, const int64_t value);
 
 /**
- * Add a floating point value to the context.
- * Note that this will add a narrower type if it will fit.
+ * Add an unsigned 64-bit integer value to the context.
+ *
+ * @param context The context to add to.
+ * @param value The value to add.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_uint64(qjson_encode_context* const context, const uint64_t value);
+
+/**
+ * Add a 32-bit integer value to the context.
+ *
+ * @param context The context to add to.
+ * @param value The value to add.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_int32(qjson_encode_context* const context, const int32_t value);
+
+/**
+ * Add an unsigned 32-bit integer value to the context.
+ *
+ * @param context The context to add to.
+ * @param value The value to add.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_uint32(qjson_encode_context* const context, const uint32_t value);
+
+/**
+ * Add a floating point value to the context, rounded to the context's precision.
+ * Infinities and NaN cannot be represented in JSON, and fail.
  *
  * @param context The context to add to.
  * @param value The value to add.
@@ -158,6 +1057,39 @@ bool qjson_start_map(qjson_encode_context* const context);
  */
 bool qjson_end_container(qjson_encode_context* const context);
 
+/**
+ * Add a complete list of integers to the context. This produces the same output as starting a list,
+ * adding each value and ending the list, but checks for room once per buffer-full rather than per value.
+ *
+ * @param context The context to add to.
+ * @param values The values to add.
+ * @param count The number of values.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_int64_array(qjson_encode_context* const context, const int64_t* const values, const size_t count);
+
+/**
+ * Add a complete list of floating point numbers to the context. This produces the same output as starting a list,
+ * adding each value and ending the list, but checks for room once per buffer-full rather than per value.
+ * Nothing is added if any value is an infinity or NaN.
+ *
+ * @param context The context to add to.
+ * @param values The values to add.
+ * @param count The number of values.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_double_array(qjson_encode_context* const context, const double* const values, const size_t count);
+
+/**
+ * Add a complete list of UTF-8 encoded, null terminated strings to the context.
+ *
+ * @param context The context to add to.
+ * @param strings The strings to add.
+ * @param count The number of strings.
+ * @return true if the operation was successful.
+ */
+bool qjson_add_string_array(qjson_encode_context* const context, const char* const* const strings, const size_t count);
+
 /**
  * End the encoding process and ensure the encoded buffer is properly terminated.
  * Any opened lists or maps will be closed, and the encoded buffer will be null terminated.
@@ -0,0 +1,446 @@
+#ifndef qjson_HPP
+#define qjson_HPP
+
+// A header-only C++17 front end to the parser.
+//
+// qjson::parse() instantiates the parser's state machine against the handler's type,
+// so the handler's on_* members are called directly and can be inlined into the
+// parsing loop rather than dispatched through a table of function pointers.
+// Numbers and escaped strings are converted by the same code as the C parser.
+
+#include <qjson/qjson.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace qjson
+{
+
+namespace detail
+{
+
+template<typename T, typename = void>
+struct has_on_map_key : std::false_type {};
+
+template<typename T>
+struct has_on_map_key<T, std::void_t<decltype(std::declval<T&>().on_map_key(std::string_view()))>> : std::true_type {};
+
+enum container_type : uint8_t
+{
+    CONTAINER_LIST,
+    CONTAINER_MAP,
+};
+
+// Characters that end the fast scan through a string: quotes, backslashes, control characters,
+// and anything outside of ASCII.
+struct string_special_table
+{
+    bool table[256];
+
+    constexpr string_special_table() : table()
+    {
+        table[(uint8_t)'"'] = true;
+        table[(uint8_t)'\\'] = true;
+        for(int i = 0; i < 0x20; i++)
+        {
+            table[i] = true;
+        }
+        for(int i = 0x80; i < 256; i++)
+        {
+            table[i] = true;
+        }
+    }
+};
+
+inline constexpr string_special_table g_string_special;
+
+inline bool is_whitespace(const char ch)
+{
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+template<typename Handler>
+class parser
+{
+public:
+    parser(std::string_view document, Handler& handler)
+    : start_(document.data())
+    , end_(document.data() + document.size())
+    , handler_(handler)
+    {
+    }
+
+    bool parse()
+    {
+        const char* pos = start_;
+
+    parse_value:
+        pos = skip_whitespace(pos);
+        if(pos >= end_)
+        {
+            return report_unexpected_end();
+        }
+        switch(*pos)
+        {
+            case '{':
+                push_container(CONTAINER_MAP);
+                handler_.on_map_start();
+                pos = skip_whitespace(pos + 1);
+                if(pos < end_ && *pos == '}')
+                {
+                    pos++;
+                    goto end_container;
+                }
+                goto parse_map_key;
+            case '[':
+                push_container(CONTAINER_LIST);
+                handler_.on_list_start();
+                pos = skip_whitespace(pos + 1);
+                if(pos < end_ && *pos == ']')
+                {
+                    pos++;
+                    goto end_container;
+                }
+                goto parse_value;
+            case '"':
+                pos = parse_string(pos);
+                if(pos == nullptr)
+                {
+                    return false;
+                }
+                handler_.on_string(string_);
+                goto parse_value_end;
+            case 't':
+                pos = parse_literal(pos, "true", 4);
+                if(pos == nullptr)
+                {
+                    return false;
+                }
+                handler_.on_boolean(true);
+                goto parse_value_end;
+            case 'f':
+                pos = parse_literal(pos, "false", 5);
+                if(pos == nullptr)
+                {
+                    return false;
+                }
+                handler_.on_boolean(false);
+                goto parse_value_end;
+            case 'n':
+                pos = parse_literal(pos, "null", 4);
+                if(pos == nullptr)
+                {
+                    return false;
+                }
+                handler_.on_null();
+                goto parse_value_end;
+            case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+                pos = parse_number(pos);
+                if(pos == nullptr)
+                {
+                    return false;
+                }
+                goto parse_value_end;
+            default:
+                return report_unexpected(pos);
+        }
+
+    parse_map_key:
+        if(pos >= end_)
+        {
+            return report_unexpected_end();
+        }
+        if(*pos != '"')
+        {
+            return report_unexpected(pos);
+        }
+        pos = parse_string(pos);
+        if(pos == nullptr)
+        {
+            return false;
+        }
+        if constexpr(has_on_map_key<Handler>::value)
+        {
+            handler_.on_map_key(string_);
+        }
+        else
+        {
+            handler_.on_string(string_);
+        }
+        pos = skip_whitespace(pos);
+        if(pos >= end_)
+        {
+            return report_unexpected_end();
+        }
+        if(*pos != ':')
+        {
+            return report_unexpected(pos);
+        }
+        pos++;
+        goto parse_value;
+
+    end_container:
+        if(top_container() == CONTAINER_MAP)
+        {
+            handler_.on_map_end();
+        }
+        else
+        {
+            handler_.on_list_end();
+        }
+        pop_container();
+
+    parse_value_end:
+        pos = skip_whitespace(pos);
+        if(depth_ == 0)
+        {
+            if(pos < end_)
+            {
+                return report_unexpected(pos);
+            }
+            return true;
+        }
+        if(pos >= end_)
+        {
+            return report_unexpected_end();
+        }
+        if(*pos == ',')
+        {
+            pos = skip_whitespace(pos + 1);
+            if(top_container() == CONTAINER_MAP)
+            {
+                goto parse_map_key;
+            }
+            goto parse_value;
+        }
+        if(*pos == (top_container() == CONTAINER_MAP ? '}' : ']'))
+        {
+            pos++;
+            goto end_container;
+        }
+        return report_unexpected(pos);
+    }
+
+private:
+    // Containers nested deeper than this spill over onto the heap.
+    static constexpr size_t INLINE_STACK_SIZE = 64;
+
+    const char* skip_whitespace(const char* pos) const
+    {
+        while(pos < end_ && is_whitespace(*pos))
+        {
+            pos++;
+        }
+        return pos;
+    }
+
+    void push_container(const container_type type)
+    {
+        if(depth_ < INLINE_STACK_SIZE)
+        {
+            inline_stack_[depth_] = type;
+        }
+        else
+        {
+            overflow_stack_.push_back(type);
+        }
+        depth_++;
+    }
+
+    container_type top_container() const
+    {
+        return depth_ <= INLINE_STACK_SIZE ? inline_stack_[depth_ - 1] : overflow_stack_.back();
+    }
+
+    void pop_container()
+    {
+        depth_--;
+        if(depth_ >= INLINE_STACK_SIZE)
+        {
+            overflow_stack_.pop_back();
+        }
+    }
+
+    size_t offset_of(const char* const pos) const
+    {
+        return (size_t)(pos - start_);
+    }
+
+    bool report_error(const char* const message)
+    {
+        handler_.on_parse_error(std::string_view(message));
+        return false;
+    }
+
+    bool report_unexpected(const char* const pos)
+    {
+        char buff[200];
+        std::snprintf(buff, sizeof(buff), "Unexpected token: '%c' at offset %zu", *pos, offset_of(pos));
+        return report_error(buff);
+    }
+
+    bool report_unexpected_end()
+    {
+        char buff[200];
+        std::snprintf(buff, sizeof(buff), "Unexpected end of document at offset %zu", offset_of(end_));
+        return report_error(buff);
+    }
+
+    bool report_bad_data(const char* const pos, const char* const description)
+    {
+        char buff[200];
+        std::snprintf(buff, sizeof(buff), "Bad encoding: %s at offset %zu", description, offset_of(pos));
+        return report_error(buff);
+    }
+
+    // Parses the string starting at the opening quote at pos into string_.
+    // Plain ASCII strings are viewed where they are in the document; anything else is decoded into the scratch buffer.
+    // Returns a pointer past the closing quote, or nullptr on error.
+    const char* parse_string(const char* const pos)
+    {
+        const char* const start = pos + 1;
+        const char* string_end = start;
+        while(string_end < end_ && !g_string_special.table[(uint8_t)*string_end])
+        {
+            string_end++;
+        }
+        if(string_end < end_ && *string_end == '"')
+        {
+            string_ = std::string_view(start, (size_t)(string_end - start));
+            return string_end + 1;
+        }
+
+        while(string_end < end_ && *string_end != '"')
+        {
+            string_end += *string_end == '\\' ? 2 : 1;
+        }
+        if(string_end >= end_)
+        {
+            report_bad_data(pos, "unterminated string");
+            return nullptr;
+        }
+
+        const size_t raw_length = (size_t)(string_end - start);
+        if(scratch_.size() < raw_length)
+        {
+            scratch_.resize(raw_length);
+        }
+        size_t length = 0;
+        const char* error_pos = nullptr;
+        switch(qjson_decode_string(start, string_end, scratch_.data(), &length, &error_pos))
+        {
+            case QJSON_STRING_OK:
+                break;
+            case QJSON_STRING_BAD_ESCAPE:
+                report_bad_data(error_pos, "invalid escape sequence");
+                return nullptr;
+            case QJSON_STRING_BAD_UTF8:
+                report_bad_data(error_pos, "invalid UTF-8");
+                return nullptr;
+            case QJSON_STRING_CONTROL_CHARACTER:
+                report_bad_data(error_pos, "unescaped control character");
+                return nullptr;
+        }
+        string_ = std::string_view(scratch_.data(), length);
+        return string_end + 1;
+    }
+
+    // Converts the number starting at pos and delivers it.
+    // Returns a pointer past the end of the number, or nullptr on error.
+    const char* parse_number(const char* const pos)
+    {
+        qjson_number number;
+        switch(qjson_parse_number(pos, end_, &number))
+        {
+            case QJSON_NUMBER_OK:
+                break;
+            case QJSON_NUMBER_INCOMPLETE:
+                report_unexpected_end();
+                return nullptr;
+            case QJSON_NUMBER_INVALID:
+                report_unexpected(number.end);
+                return nullptr;
+            case QJSON_NUMBER_OUT_OF_RANGE:
+                report_bad_data(pos, number.is_float ? "float out of range" : "integer out of range");
+                return nullptr;
+        }
+        if(number.is_float)
+        {
+            handler_.on_float(number.float_value);
+        }
+        else
+        {
+            handler_.on_int(number.int_value);
+        }
+        return number.end;
+    }
+
+    // Matches the literal at pos against expected.
+    // Returns a pointer past the end of the literal, or nullptr on error.
+    const char* parse_literal(const char* const pos, const char* const expected, const size_t length)
+    {
+        const size_t available = (size_t)(end_ - pos);
+        if(available >= length)
+        {
+            if(std::memcmp(pos, expected, length) == 0)
+            {
+                return pos + length;
+            }
+        }
+        else if(std::memcmp(pos, expected, available) == 0)
+        {
+            report_unexpected_end();
+            return nullptr;
+        }
+        report_unexpected(pos);
+        return nullptr;
+    }
+
+    const char* const start_;
+    const char* const end_;
+    Handler& handler_;
+    std::string_view string_;
+    std::vector<char> scratch_;
+    container_type inline_stack_[INLINE_STACK_SIZE];
+    std::vector<container_type> overflow_stack_;
+    size_t depth_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * Parse a JSON document, calling the handler's members directly as the parser encounters entities.
+ *
+ * The handler must have these members (their return values are ignored):
+ *
+ *     void on_parse_error(std::string_view message);
+ *     void on_null();
+ *     void on_boolean(bool value);
+ *     void on_int(int64_t value);
+ *     void on_float(double value);
+ *     void on_string(std::string_view value);
+ *     void on_list_start();
+ *     void on_list_end();
+ *     void on_map_start();
+ *     void on_map_end();
+ *
+ * Map keys go to on_map_key(std::string_view key) if the handler has it, and to on_string otherwise.
+ * String views are only valid until the callback returns, and are not null terminated.
+ *
+ * @param document The document to parse. It is neither copied nor modified.
+ * @param handler The handler to deliver entities to.
+ * @return true if parsing was successful.
+ */
+template<typename Handler>
+bool parse(std::string_view document, Handler& handler)
+{
+    return detail::parser<Handler>(document, handler).parse();
+}
+
+} // namespace qjson
+
+#endif // qjson_HPP
@@ -0,0 +1,76 @@
+#include "json_parser.h"
+#include <stdint.h>
+
+// Parsing inside a fixed memory region.
+//
+// The region is used as a bump allocator: its bookkeeping sits at the start,
+// and every allocation is carved off the front of what remains. Nothing is
+// ever given back, so allocation is a bounds check and an addition, and the
+// parser never touches the heap or takes a lock.
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct
+{
+    char* next;
+    char* end;
+} arena;
+
+static inline uintptr_t align_up(const uintptr_t address)
+{
+    return (address + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+}
+
+static void* allocate_from_arena(void* const arena_ptr, const size_t size)
+{
+    arena* const region = (arena*)arena_ptr;
+    const size_t available = (size_t)(region->end - region->next);
+    if(size > available || align_up(size) > available)
+    {
+        return NULL;
+    }
+    void* const memory = region->next;
+    region->next += align_up(size);
+    return memory;
+}
+
+qjson_parser* qjson_new_parser_in_arena(void* const memory,
+                                        const size_t size,
+                                        const qjson_parse_callbacks* const callbacks,
+                                        void* const context)
+{
+    const uintptr_t start = align_up((uintptr_t)memory);
+    const uintptr_t end = (uintptr_t)memory + size;
+    if(end < (uintptr_t)memory || start > end || end - start < align_up(sizeof(arena)))
+    {
+        return NULL;
+    }
+    arena* const region = (arena*)start;
+    region->next = (char*)(start + align_up(sizeof(arena)));
+    region->end = (char*)end;
+
+    const qjson_allocator allocator =
+    {
+        .allocate = allocate_from_arena,
+        .free     = NULL,
+        .context  = region,
+    };
+    return new_parser_with_allocator(&allocator, "Arena too small", callbacks, context);
+}
+
+bool qjson_parse_buffer_in_arena(const char* const data,
+                                 const size_t length,
+                                 const qjson_parse_callbacks* const callbacks,
+                                 void* const context,
+                                 void* const memory,
+                                 const size_t size)
+{
+    qjson_parser* const parser = qjson_new_parser_in_arena(memory, size, callbacks, context);
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Arena too small");
+        return false;
+    }
+    // Everything the parser allocated stays in the region, so there is nothing to free.
+    return qjson_parse_buffer_with_parser(parser, data, length, callbacks, context);
+}
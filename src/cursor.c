@@ -0,0 +1,201 @@
+#include "qjson/qjson.h"
+#include "number_parser.h"
+#include "string_decoder.h"
+#include "value_scanner.h"
+#include <string.h>
+
+// Lazy cursor navigation.
+//
+// A cursor is just a position in the input. Moving it only looks at the
+// characters needed to find the next value (see value_scanner.h), and nothing
+// is converted or decoded until one of the getters is called.
+
+qjson_cursor qjson_new_cursor(const char* const data, const size_t length)
+{
+    qjson_cursor cursor = {skip_json_whitespace(data, data + length), data + length};
+    return cursor;
+}
+
+qjson_type qjson_cursor_type(const qjson_cursor* const cursor)
+{
+    if(cursor->pos >= cursor->end)
+    {
+        return QJSON_TYPE_NONE;
+    }
+    switch(*cursor->pos)
+    {
+        case '{': return QJSON_TYPE_MAP;
+        case '[': return QJSON_TYPE_LIST;
+        case '"': return QJSON_TYPE_STRING;
+        case 't':
+        case 'f': return QJSON_TYPE_BOOLEAN;
+        case 'n': return QJSON_TYPE_NULL;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            for(const char* pos = cursor->pos; !is_json_value_end(pos, cursor->end); pos++)
+            {
+                if(*pos == '.' || *pos == 'e' || *pos == 'E')
+                {
+                    return QJSON_TYPE_FLOAT;
+                }
+            }
+            return QJSON_TYPE_INT;
+        default:
+            return QJSON_TYPE_NONE;
+    }
+}
+
+bool qjson_cursor_enter(qjson_cursor* const cursor)
+{
+    if(cursor->pos >= cursor->end || (*cursor->pos != '[' && *cursor->pos != '{'))
+    {
+        return false;
+    }
+    const char* const first = skip_json_whitespace(cursor->pos + 1, cursor->end);
+    if(first >= cursor->end || *first == ']' || *first == '}')
+    {
+        return false;
+    }
+    cursor->pos = first;
+    return true;
+}
+
+bool qjson_cursor_next(qjson_cursor* const cursor)
+{
+    const char* pos = skip_json_value(cursor->pos, cursor->end);
+    if(pos == NULL)
+    {
+        return false;
+    }
+    pos = skip_json_whitespace(pos, cursor->end);
+    if(pos >= cursor->end || (*pos != ',' && *pos != ':'))
+    {
+        return false;
+    }
+    pos = skip_json_whitespace(pos + 1, cursor->end);
+    if(pos >= cursor->end)
+    {
+        return false;
+    }
+    cursor->pos = pos;
+    return true;
+}
+
+bool qjson_cursor_find_field(qjson_cursor* const cursor, const char* const key)
+{
+    if(cursor->pos >= cursor->end || *cursor->pos != '{')
+    {
+        return false;
+    }
+    const size_t key_length = strlen(key);
+    qjson_cursor entry = *cursor;
+    if(!qjson_cursor_enter(&entry))
+    {
+        return false;
+    }
+    for(;;)
+    {
+        if(*entry.pos != '"')
+        {
+            return false;
+        }
+        const char* const key_end = find_json_string_end(entry.pos + 1, entry.end);
+        if(key_end == NULL)
+        {
+            return false;
+        }
+        const bool is_match = json_key_equals(entry.pos + 1, key_end, key, key_length);
+        if(!qjson_cursor_next(&entry))
+        {
+            return false;
+        }
+        if(is_match)
+        {
+            *cursor = entry;
+            return true;
+        }
+        if(!qjson_cursor_next(&entry))
+        {
+            return false;
+        }
+    }
+}
+
+bool qjson_cursor_get_boolean(const qjson_cursor* const cursor, bool* const value)
+{
+    const char* const pos = cursor->pos;
+    const size_t available = cursor->end - pos;
+    if(available >= 4 && memcmp(pos, "true", 4) == 0 && is_json_value_end(pos + 4, cursor->end))
+    {
+        *value = true;
+        return true;
+    }
+    if(available >= 5 && memcmp(pos, "false", 5) == 0 && is_json_value_end(pos + 5, cursor->end))
+    {
+        *value = false;
+        return true;
+    }
+    return false;
+}
+
+// Converts the number at the cursor, which must be followed by a delimiter.
+static bool get_number(const qjson_cursor* const cursor, json_number* const number)
+{
+    return parse_json_number(cursor->pos, cursor->end, number) == NUMBER_STATUS_OK &&
+           is_json_value_end(number->end, cursor->end);
+}
+
+bool qjson_cursor_get_int64(const qjson_cursor* const cursor, int64_t* const value)
+{
+    json_number number;
+    if(!get_number(cursor, &number) || number.is_float)
+    {
+        return false;
+    }
+    *value = number.int_value;
+    return true;
+}
+
+bool qjson_cursor_get_double(const qjson_cursor* const cursor, double* const value)
+{
+    json_number number;
+    if(!get_number(cursor, &number))
+    {
+        return false;
+    }
+    *value = number.is_float ? number.float_value : (double)number.int_value;
+    return true;
+}
+
+bool qjson_cursor_get_string(const qjson_cursor* const cursor,
+                             char* const buffer,
+                             const size_t buffer_size,
+                             size_t* const length)
+{
+    if(cursor->pos >= cursor->end || *cursor->pos != '"')
+    {
+        return false;
+    }
+    const char* const start = cursor->pos + 1;
+    const char* const string_end = find_json_string_end(start, cursor->end);
+    if(string_end == NULL)
+    {
+        return false;
+    }
+    const size_t required_size = (size_t)(string_end - start) + 1;
+    if(buffer_size < required_size)
+    {
+        *length = required_size;
+        return false;
+    }
+    char* decoded_end = NULL;
+    const char* error_pos = NULL;
+    if(decode_json_string(start, string_end, buffer, &decoded_end, &error_pos) != STRING_DECODE_OK)
+    {
+        return false;
+    }
+    *decoded_end = 0;
+    *length = decoded_end - buffer;
+    return true;
+}
@@ -0,0 +1,663 @@
+#include "json_parser.h"
+#include "structural_index.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Multi-threaded parsing of document streams (NDJSON / JSON Lines).
+//
+// The buffer is cut into chunks at newlines between documents, which are
+// found by counting bracket depth over the structural index (see
+// structural_index.h), and the threads take turns parsing whole chunks into
+// compact event logs. A parsed chunk is replayed
+// into the caller's callbacks once its first document index is known (and,
+// for ordered delivery, once every earlier chunk has been delivered).
+//
+// The calling thread works alongside the worker threads, and delivery takes
+// priority over parsing. The number of chunks that are parsed but not yet
+// delivered is bounded, so memory use does not grow with the input size.
+
+#define MIN_CHUNK_SIZE (64 * 1024)
+#define MAX_CHUNK_SIZE (1024 * 1024)
+#define CHUNKS_PER_THREAD 4
+#define SPLIT_WINDOW_SIZE (16 * 1024)
+#define LOGS_PER_THREAD 2
+#define INITIAL_EVENT_CAPACITY 1024
+#define INITIAL_STRING_CAPACITY 4096
+
+typedef enum
+{
+    EVENT_NULL,
+    EVENT_FALSE,
+    EVENT_TRUE,
+    EVENT_INT,
+    EVENT_FLOAT,
+    EVENT_STRING,
+    EVENT_LIST_START,
+    EVENT_LIST_END,
+    EVENT_MAP_START,
+    EVENT_MAP_END,
+    EVENT_DOCUMENT_START,
+    EVENT_DOCUMENT_END,
+} event_type;
+
+typedef struct
+{
+    event_type type;
+    union
+    {
+        int64_t int_value;
+        double float_value;
+        // Offset of the null terminated string in the log's string area.
+        size_t string_offset;
+        // Relative to the first document in the chunk.
+        size_t document_index;
+    };
+} recorded_event;
+
+typedef struct
+{
+    recorded_event* events;
+    size_t event_count;
+    size_t event_capacity;
+    char* strings;
+    size_t string_length;
+    size_t string_capacity;
+    size_t document_count;
+    bool is_out_of_memory;
+    bool has_error;
+    char error_message[ERROR_MESSAGE_SIZE];
+} event_log;
+
+typedef enum
+{
+    CHUNK_PENDING,
+    CHUNK_PARSING,
+    CHUNK_PARSED,
+    CHUNK_DELIVERING,
+    CHUNK_DELIVERED,
+} chunk_state;
+
+typedef struct
+{
+    size_t offset;
+    size_t length;
+    chunk_state state;
+    event_log* log;
+    size_t first_document_index;
+} document_chunk;
+
+typedef struct
+{
+    const char* data;
+    const qjson_parse_callbacks* callbacks;
+    const qjson_document_callbacks* document_callbacks;
+    void* context;
+    qjson_document_order order;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    document_chunk* chunks;
+    size_t chunk_count;
+    // Chunks at or after this index are never delivered (it moves back to just past a chunk that fails).
+    size_t chunk_limit;
+    size_t next_chunk_to_parse;
+    // Every chunk before this one has been delivered.
+    size_t next_chunk_to_deliver;
+    // Every chunk before this one has been parsed and has its first document index assigned.
+    size_t next_chunk_to_number;
+    size_t next_document_index;
+    bool is_delivering;
+    bool has_failed;
+    event_log** free_logs;
+    size_t free_log_count;
+} document_session;
+
+static void log_out_of_memory(event_log* const log)
+{
+    log->is_out_of_memory = true;
+}
+
+static recorded_event* add_event(event_log* const log, const event_type type)
+{
+    if(log->event_count >= log->event_capacity)
+    {
+        if(log->is_out_of_memory)
+        {
+            return NULL;
+        }
+        size_t new_capacity = log->event_capacity > 0 ? log->event_capacity * 2 : INITIAL_EVENT_CAPACITY;
+        recorded_event* new_events = realloc(log->events, new_capacity * sizeof(*new_events));
+        if(new_events == NULL)
+        {
+            log_out_of_memory(log);
+            return NULL;
+        }
+        log->events = new_events;
+        log->event_capacity = new_capacity;
+    }
+    recorded_event* const event = &log->events[log->event_count++];
+    event->type = type;
+    return event;
+}
+
+static void record_parse_error(void* const context, const char* const message)
+{
+    event_log* const log = (event_log*)context;
+    log->has_error = true;
+    strncpy(log->error_message, message, sizeof(log->error_message) - 1);
+    log->error_message[sizeof(log->error_message) - 1] = 0;
+}
+
+static void record_null(void* const context)
+{
+    add_event((event_log*)context, EVENT_NULL);
+}
+
+static void record_boolean(void* const context, const bool value)
+{
+    add_event((event_log*)context, value ? EVENT_TRUE : EVENT_FALSE);
+}
+
+static void record_int(void* const context, const int64_t value)
+{
+    recorded_event* const event = add_event((event_log*)context, EVENT_INT);
+    if(event != NULL)
+    {
+        event->int_value = value;
+    }
+}
+
+static void record_float(void* const context, const double value)
+{
+    recorded_event* const event = add_event((event_log*)context, EVENT_FLOAT);
+    if(event != NULL)
+    {
+        event->float_value = value;
+    }
+}
+
+static void record_string(void* const context, const char* const value)
+{
+    event_log* const log = (event_log*)context;
+    const size_t size = strlen(value) + 1;
+    const size_t required = log->string_length + size;
+    if(required > log->string_capacity)
+    {
+        size_t new_capacity = log->string_capacity > 0 ? log->string_capacity * 2 : INITIAL_STRING_CAPACITY;
+        if(new_capacity < required)
+        {
+            new_capacity = required;
+        }
+        char* const new_strings = realloc(log->strings, new_capacity);
+        if(new_strings == NULL)
+        {
+            log_out_of_memory(log);
+            return;
+        }
+        log->strings = new_strings;
+        log->string_capacity = new_capacity;
+    }
+    recorded_event* const event = add_event(log, EVENT_STRING);
+    if(event != NULL)
+    {
+        memcpy(log->strings + log->string_length, value, size);
+        event->string_offset = log->string_length;
+        log->string_length = required;
+    }
+}
+
+static void record_list_start(void* const context)
+{
+    add_event((event_log*)context, EVENT_LIST_START);
+}
+
+static void record_list_end(void* const context)
+{
+    add_event((event_log*)context, EVENT_LIST_END);
+}
+
+static void record_map_start(void* const context)
+{
+    add_event((event_log*)context, EVENT_MAP_START);
+}
+
+static void record_map_end(void* const context)
+{
+    add_event((event_log*)context, EVENT_MAP_END);
+}
+
+static void record_document_start(void* const context, const size_t document_index)
+{
+    recorded_event* const event = add_event((event_log*)context, EVENT_DOCUMENT_START);
+    if(event != NULL)
+    {
+        event->document_index = document_index;
+    }
+}
+
+static void record_document_end(void* const context, const size_t document_index)
+{
+    event_log* const log = (event_log*)context;
+    recorded_event* const event = add_event(log, EVENT_DOCUMENT_END);
+    if(event != NULL)
+    {
+        event->document_index = document_index;
+    }
+    log->document_count = document_index + 1;
+}
+
+static const qjson_parse_callbacks g_recording_callbacks =
+{
+    .on_parse_error = record_parse_error,
+    .on_null        = record_null,
+    .on_boolean     = record_boolean,
+    .on_int         = record_int,
+    .on_float       = record_float,
+    .on_string      = record_string,
+    .on_list_start  = record_list_start,
+    .on_list_end    = record_list_end,
+    .on_map_start   = record_map_start,
+    .on_map_end     = record_map_end,
+};
+
+static const qjson_document_callbacks g_recording_document_callbacks =
+{
+    .on_document_start = record_document_start,
+    .on_document_end   = record_document_end,
+};
+
+static void clear_log(event_log* const log)
+{
+    log->event_count = 0;
+    log->string_length = 0;
+    log->document_count = 0;
+    log->is_out_of_memory = false;
+    log->has_error = false;
+}
+
+static void free_log(event_log* const log)
+{
+    if(log != NULL)
+    {
+        free(log->events);
+        free(log->strings);
+        free(log);
+    }
+}
+
+static void parse_chunk(const document_session* const session, const document_chunk* const chunk)
+{
+    event_log* const log = chunk->log;
+    clear_log(log);
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        log_out_of_memory(log);
+    }
+    else
+    {
+        parse_document_sequence(parser,
+                                session->data + chunk->offset,
+                                chunk->length,
+                                chunk->offset,
+                                &g_recording_callbacks,
+                                &g_recording_document_callbacks,
+                                log);
+        qjson_release_thread_parser(parser);
+    }
+    if(log->is_out_of_memory && !log->has_error)
+    {
+        record_parse_error(log, "Out of memory");
+    }
+}
+
+static void deliver_chunk(const document_session* const session, const document_chunk* const chunk)
+{
+    const qjson_parse_callbacks* const callbacks = session->callbacks;
+    const qjson_document_callbacks* const document_callbacks = session->document_callbacks;
+    void* const context = session->context;
+    const event_log* const log = chunk->log;
+    const recorded_event* const events_end = log->events + log->event_count;
+
+    for(const recorded_event* event = log->events; event < events_end; event++)
+    {
+        switch(event->type)
+        {
+            case EVENT_NULL:       callbacks->on_null(context); break;
+            case EVENT_FALSE:      callbacks->on_boolean(context, false); break;
+            case EVENT_TRUE:       callbacks->on_boolean(context, true); break;
+            case EVENT_INT:        callbacks->on_int(context, event->int_value); break;
+            case EVENT_FLOAT:      callbacks->on_float(context, event->float_value); break;
+            case EVENT_STRING:     callbacks->on_string(context, log->strings + event->string_offset); break;
+            case EVENT_LIST_START: callbacks->on_list_start(context); break;
+            case EVENT_LIST_END:   callbacks->on_list_end(context); break;
+            case EVENT_MAP_START:  callbacks->on_map_start(context); break;
+            case EVENT_MAP_END:    callbacks->on_map_end(context); break;
+            case EVENT_DOCUMENT_START:
+                document_callbacks->on_document_start(context, chunk->first_document_index + event->document_index);
+                break;
+            case EVENT_DOCUMENT_END:
+                document_callbacks->on_document_end(context, chunk->first_document_index + event->document_index);
+                break;
+        }
+    }
+    if(log->has_error)
+    {
+        callbacks->on_parse_error(context, log->error_message);
+    }
+}
+
+// Returns a parsed chunk that may be delivered now, or NULL if there are none.
+static document_chunk* find_deliverable_chunk(document_session* const session)
+{
+    const size_t first = session->next_chunk_to_deliver;
+    if(first >= session->chunk_limit)
+    {
+        return NULL;
+    }
+    if(session->order == QJSON_DOCUMENTS_IN_ORDER)
+    {
+        if(session->is_delivering || session->chunks[first].state != CHUNK_PARSED)
+        {
+            return NULL;
+        }
+        return &session->chunks[first];
+    }
+
+    // A failed chunk is held back until everything before it has been delivered.
+    for(size_t i = first; i < session->next_chunk_to_number && i < session->chunk_limit; i++)
+    {
+        document_chunk* const chunk = &session->chunks[i];
+        if(chunk->state == CHUNK_PARSED && (i == first || !chunk->log->has_error))
+        {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+static void release_log(document_session* const session, document_chunk* const chunk)
+{
+    session->free_logs[session->free_log_count++] = chunk->log;
+    chunk->log = NULL;
+}
+
+static void finish_parsing(document_session* const session, document_chunk* const chunk)
+{
+    const size_t index = chunk - session->chunks;
+    chunk->state = CHUNK_PARSED;
+    if(index >= session->chunk_limit)
+    {
+        // An earlier chunk failed while this one was being parsed.
+        release_log(session, chunk);
+        return;
+    }
+    if(chunk->log->has_error)
+    {
+        session->chunk_limit = index + 1;
+        session->has_failed = true;
+    }
+    while(session->next_chunk_to_number < session->chunk_limit &&
+          session->chunks[session->next_chunk_to_number].state >= CHUNK_PARSED)
+    {
+        document_chunk* const numbered = &session->chunks[session->next_chunk_to_number++];
+        numbered->first_document_index = session->next_document_index;
+        session->next_document_index += numbered->log->document_count;
+    }
+}
+
+static void finish_delivery(document_session* const session, document_chunk* const chunk)
+{
+    chunk->state = CHUNK_DELIVERED;
+    release_log(session, chunk);
+    session->is_delivering = false;
+    while(session->next_chunk_to_deliver < session->chunk_limit &&
+          session->chunks[session->next_chunk_to_deliver].state == CHUNK_DELIVERED)
+    {
+        session->next_chunk_to_deliver++;
+    }
+}
+
+static void run_session(document_session* const session)
+{
+    pthread_mutex_lock(&session->mutex);
+    while(session->next_chunk_to_deliver < session->chunk_limit)
+    {
+        document_chunk* chunk = find_deliverable_chunk(session);
+        if(chunk != NULL)
+        {
+            chunk->state = CHUNK_DELIVERING;
+            session->is_delivering = true;
+            pthread_mutex_unlock(&session->mutex);
+            deliver_chunk(session, chunk);
+            pthread_mutex_lock(&session->mutex);
+            finish_delivery(session, chunk);
+            pthread_cond_broadcast(&session->changed);
+            continue;
+        }
+
+        if(session->next_chunk_to_parse < session->chunk_limit && session->free_log_count > 0)
+        {
+            chunk = &session->chunks[session->next_chunk_to_parse++];
+            chunk->state = CHUNK_PARSING;
+            chunk->log = session->free_logs[--session->free_log_count];
+            pthread_mutex_unlock(&session->mutex);
+            parse_chunk(session, chunk);
+            pthread_mutex_lock(&session->mutex);
+            finish_parsing(session, chunk);
+            pthread_cond_broadcast(&session->changed);
+            continue;
+        }
+
+        pthread_cond_wait(&session->changed, &session->mutex);
+    }
+    pthread_mutex_unlock(&session->mutex);
+}
+
+static void* run_worker(void* const session)
+{
+    run_session((document_session*)session);
+    return NULL;
+}
+
+// Splits the buffer after newlines, into chunks of roughly chunk_size bytes.
+static void add_chunk(document_chunk* const chunk, const size_t offset, const size_t end)
+{
+    chunk->offset = offset;
+    chunk->length = end - offset;
+    chunk->state = CHUNK_PENDING;
+    chunk->log = NULL;
+}
+
+// Cuts the buffer into chunks of at least chunk_size bytes, each ending just after a newline between documents.
+// Only the bytes between structural characters at nesting depth 0, outside of strings, are searched for newlines,
+// so a document that spans several lines is never cut.
+static size_t split_into_chunks(const char* const data,
+                                const size_t length,
+                                const size_t chunk_size,
+                                document_chunk* const chunks)
+{
+    structural_scanner scanner;
+    structural_scanner_init(&scanner);
+    uint64_t structurals[SPLIT_WINDOW_SIZE / STRUCTURAL_BLOCK_SIZE];
+    size_t chunk_count = 0;
+    size_t chunk_offset = 0;
+    size_t depth = 0;
+    bool is_in_string = false;
+    // The start of the bytes after the last structural character.
+    size_t gap_offset = 0;
+
+    for(size_t window_offset = 0; window_offset < length; window_offset += SPLIT_WINDOW_SIZE)
+    {
+        size_t size = length - window_offset;
+        if(size > SPLIT_WINDOW_SIZE)
+        {
+            size = SPLIT_WINDOW_SIZE;
+        }
+        const size_t block_count = structural_index_window(&scanner, data + window_offset, size, structurals, NULL);
+        for(size_t block_index = 0; block_index < block_count; block_index++)
+        {
+            const size_t block_offset = window_offset + block_index * STRUCTURAL_BLOCK_SIZE;
+            uint64_t block_bits = structurals[block_index];
+            while(block_bits != 0)
+            {
+                const size_t offset = block_offset + (size_t)__builtin_ctzll(block_bits);
+                block_bits &= block_bits - 1;
+
+                if(depth == 0 && !is_in_string && offset - chunk_offset >= chunk_size)
+                {
+                    const char* const newline = memchr(data + gap_offset, '\n', offset - gap_offset);
+                    if(newline != NULL)
+                    {
+                        const size_t chunk_end = newline + 1 - data;
+                        add_chunk(&chunks[chunk_count++], chunk_offset, chunk_end);
+                        chunk_offset = chunk_end;
+                    }
+                }
+
+                switch(data[offset])
+                {
+                    case '[':
+                    case '{':
+                        depth++;
+                        break;
+                    case ']':
+                    case '}':
+                        // Unbalanced brackets are left to the parser to report.
+                        if(depth > 0)
+                        {
+                            depth--;
+                        }
+                        break;
+                    case '"':
+                        is_in_string = !is_in_string;
+                        break;
+                    default:
+                        break;
+                }
+                gap_offset = offset + 1;
+            }
+        }
+    }
+    add_chunk(&chunks[chunk_count++], chunk_offset, length);
+    return chunk_count;
+}
+
+static bool parse_on_calling_thread(const char* const data,
+                                    const size_t length,
+                                    const qjson_parse_callbacks* const callbacks,
+                                    const qjson_document_callbacks* const document_callbacks,
+                                    void* const context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    bool result = parse_document_sequence(parser, data, length, 0, callbacks, document_callbacks, context);
+    qjson_release_thread_parser(parser);
+    return result;
+}
+
+bool qjson_parse_documents(const char* const data,
+                           const size_t length,
+                           const qjson_parse_callbacks* const callbacks,
+                           const qjson_document_callbacks* const document_callbacks,
+                           void* const context,
+                           int thread_count,
+                           const qjson_document_order order)
+{
+    if(thread_count <= 0)
+    {
+        const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpu_count > 0 ? (int)cpu_count : 1;
+    }
+
+    size_t chunk_size = length / ((size_t)thread_count * CHUNKS_PER_THREAD);
+    if(chunk_size < MIN_CHUNK_SIZE)
+    {
+        chunk_size = MIN_CHUNK_SIZE;
+    }
+    if(chunk_size > MAX_CHUNK_SIZE)
+    {
+        chunk_size = MAX_CHUNK_SIZE;
+    }
+    if(thread_count == 1 || length <= chunk_size)
+    {
+        return parse_on_calling_thread(data, length, callbacks, document_callbacks, context);
+    }
+
+    document_session session =
+    {
+        .data = data,
+        .callbacks = callbacks,
+        .document_callbacks = document_callbacks,
+        .context = context,
+        .order = order,
+    };
+    const size_t log_count = (size_t)thread_count * LOGS_PER_THREAD;
+    session.chunks = malloc((length / chunk_size + 1) * sizeof(*session.chunks));
+    session.free_logs = calloc(log_count, sizeof(*session.free_logs));
+    pthread_t* const threads = malloc((size_t)(thread_count - 1) * sizeof(*threads));
+    bool is_allocated = session.chunks != NULL && session.free_logs != NULL && threads != NULL;
+    for(size_t i = 0; i < log_count && is_allocated; i++)
+    {
+        session.free_logs[i] = calloc(1, sizeof(event_log));
+        is_allocated = session.free_logs[i] != NULL;
+    }
+    session.free_log_count = log_count;
+
+    bool result = false;
+    if(!is_allocated)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+    }
+    else
+    {
+        session.chunk_count = split_into_chunks(data, length, chunk_size, session.chunks);
+        session.chunk_limit = session.chunk_count;
+        pthread_mutex_init(&session.mutex, NULL);
+        pthread_cond_init(&session.changed, NULL);
+
+        // If some threads cannot be started, the rest of them (and at least the calling thread) do all of the work.
+        int started_count = 0;
+        while(started_count < thread_count - 1 &&
+              pthread_create(&threads[started_count], NULL, run_worker, &session) == 0)
+        {
+            started_count++;
+        }
+        run_session(&session);
+        while(started_count > 0)
+        {
+            pthread_join(threads[--started_count], NULL);
+        }
+
+        pthread_cond_destroy(&session.changed);
+        pthread_mutex_destroy(&session.mutex);
+        result = !session.has_failed;
+
+        // Chunks that were parsed after an earlier chunk failed still hold their logs.
+        for(size_t i = 0; i < session.chunk_count; i++)
+        {
+            if(session.chunks[i].log != NULL)
+            {
+                release_log(&session, &session.chunks[i]);
+            }
+        }
+    }
+
+    if(session.free_logs != NULL)
+    {
+        for(size_t i = 0; i < log_count; i++)
+        {
+            free_log(session.free_logs[i]);
+        }
+    }
+    free(session.free_logs);
+    free(session.chunks);
+    free(threads);
+    return result;
+}
@@ -0,0 +1,69 @@
+#include "json_parser.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Parsing straight from a memory-mapped file.
+//
+// The file is mapped read-only and parsed in place, so the page cache holds
+// the only copy of the document. The kernel is told that the mapping will be
+// read front to back, which lets it read ahead aggressively and drop pages
+// once they have been parsed, and where the kernel supports it, that the
+// mapping may be backed by huge pages to cut down on TLB misses.
+
+static void report_file_error(const char* const path,
+                              const char* const action,
+                              const qjson_parse_callbacks* const callbacks,
+                              void* const context)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    snprintf(buff, sizeof(buff), "Could not %s %s: %s", action, path, strerror(errno));
+    callbacks->on_parse_error(context, buff);
+}
+
+bool qjson_parse_file(const char* const path, const qjson_parse_callbacks* const callbacks, void* const context)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        report_file_error(path, "open", callbacks, context);
+        return false;
+    }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0)
+    {
+        report_file_error(path, "read", callbacks, context);
+        close(fd);
+        return false;
+    }
+    const size_t length = (size_t)file_stat.st_size;
+    if(length == 0)
+    {
+        // Empty files cannot be mapped, and hold no document anyway.
+        close(fd);
+        return qjson_parse_buffer("", 0, callbacks, context);
+    }
+
+    void* const mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        report_file_error(path, "map", callbacks, context);
+        return false;
+    }
+
+    // Both are only hints, so failures are ignored.
+    madvise(mapping, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(mapping, length, MADV_HUGEPAGE);
+#endif
+
+    const bool result = qjson_parse_buffer((const char*)mapping, length, callbacks, context);
+    munmap(mapping, length);
+    return result;
+}
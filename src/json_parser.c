@@ -0,0 +1,1580 @@
+#include "json_parser.h"
+#include "key_set.h"
+#include "number_parser.h"
+#include "string_decoder.h"
+#include "structural_index.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Direct-coded JSON scanner and parser.
+//
+// The grammar is driven by a goto state machine with an explicit container
+// stack, so nesting depth is bounded only by available memory and every
+// token is classified and delivered in a single pass over the input.
+//
+// The machine can stop at any token boundary and resume later, which is what
+// allows a document to be fed in chunks. A token that is cut off by the end
+// of a chunk is moved to the carry buffer and completed from the next chunk.
+//
+// Buffers of a reasonable size are first run through the SIMD structural
+// indexer (see structural_index.h) one window at a time, and the parser then
+// jumps over whitespace and string contents using the indexed positions.
+//
+// Callbacks come from either a plain table or an action table (see
+// qjson_action_callbacks), whose callbacks can ask to skip the rest of the
+// current container or to stop. A skipped container is stepped over by
+// counting brackets, so its contents are neither validated nor converted.
+//
+// Alternatively, events are written to a caller-supplied array and handed
+// over in batches (see qjson_event_callbacks). A batch is delivered when the
+// array fills, and at the end of every buffer, so strings that were not
+// unescaped can point straight into the buffer. Unescaped strings are copied
+// into the parser's event string area, which only grows between batches.
+
+#define INLINE_CONTAINER_STACK_SIZE 64
+#define INLINE_SCRATCH_SIZE 256
+#define INITIAL_CARRY_SIZE 64
+#define INITIAL_EVENT_STRINGS_SIZE 4096
+#define MAX_RETAINED_BUFFER_SIZE (1024 * 1024)
+#define THREAD_PARSER_POOL_SIZE 4
+// Must be a multiple of STRUCTURAL_BLOCK_SIZE.
+#define INDEX_WINDOW_SIZE (16 * 1024)
+#define MIN_INDEXED_BUFFER_SIZE 128
+
+typedef enum
+{
+    CONTAINER_LIST = 0,
+    CONTAINER_MAP = 1,
+} container_type;
+
+typedef enum
+{
+    STATE_VALUE,
+    STATE_FIRST_LIST_ENTRY,
+    STATE_FIRST_MAP_KEY,
+    STATE_MAP_KEY,
+    STATE_MAP_ASSIGNMENT,
+    STATE_AFTER_VALUE,
+    STATE_DOCUMENT_END,
+    STATE_SKIP_CONTAINER,
+    STATE_STOPPED,
+    STATE_ELEMENT_SEPARATOR,
+} parse_state;
+
+struct qjson_parser
+{
+    // All of the parser's memory comes from here. A NULL allocate function means malloc and free.
+    qjson_allocator allocator;
+    const char* out_of_memory_message;
+    const qjson_parse_callbacks* callbacks;
+    // Non-NULL when the callbacks come from an action table, in which case callbacks is NULL.
+    const qjson_action_callbacks* actions;
+    // Non-NULL when map keys go to their own action callback rather than on_string.
+    qjson_action (*on_map_key)(void* context, const char* key, size_t length, int key_id);
+    // Non-NULL when numbers are delivered unconverted rather than to on_int and on_float.
+    qjson_action (*on_number_raw)(void* context, const char* start, size_t length, int flags);
+    const qjson_key_set* key_set;
+    // Non-NULL when events are delivered in batches, in which case callbacks is NULL.
+    const qjson_event_callbacks* event_callbacks;
+    qjson_event* events;
+    size_t event_count;
+    size_t event_capacity;
+    char* event_strings;
+    size_t event_strings_length;
+    size_t event_strings_capacity;
+    // Non-NULL when parsing a sequence of documents rather than a single one.
+    const qjson_document_callbacks* document_callbacks;
+    size_t document_index;
+    // Documents are separated by commas, as the elements of a list are.
+    bool is_element_sequence;
+    // The element sequence runs up to the list's closing bracket, which ends the document.
+    bool is_list_tail;
+    void* context;
+    parse_state state;
+    bool has_error;
+    // When false, a token that runs into the end of the buffer may continue in the next chunk.
+    bool is_final_buffer;
+    bool is_token_incomplete;
+    const char* buffer_start;
+    size_t buffer_offset;
+    size_t bytes_received;
+    uint8_t* container_stack;
+    int container_level;
+    int container_capacity;
+    // The number of containers opened inside the container being skipped.
+    int skip_depth;
+    char* scratch;
+    size_t scratch_capacity;
+    // The raw contents and decoded length of the string last decoded into scratch.
+    const char* string_source;
+    size_t string_source_length;
+    size_t string_length;
+    char* carry;
+    size_t carry_length;
+    size_t carry_capacity;
+    size_t carry_offset;
+    bool carry_is_escaped;
+    bool use_index;
+    structural_scanner scanner;
+    const char* index_base;
+    const char* index_end;
+    size_t index_block_count;
+    uint64_t* index_structurals;
+    uint8_t inline_container_stack[INLINE_CONTAINER_STACK_SIZE];
+    char inline_scratch[INLINE_SCRATCH_SIZE];
+};
+
+static const uint8_t g_is_whitespace[256] =
+{
+    [' '] = 1, ['\t'] = 1, ['\r'] = 1, ['\n'] = 1,
+};
+
+static const uint8_t g_is_string_special[256] =
+{
+    ['"'] = 1, ['\\'] = 1,
+};
+
+// Characters that matter when skipping a container.
+static const uint8_t g_is_skip_special[256] =
+{
+    ['"'] = 1, ['['] = 1, [']'] = 1, ['{'] = 1, ['}'] = 1,
+};
+
+static const uint8_t g_is_number_char[256] =
+{
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1,
+    ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['-'] = 1, ['+'] = 1, ['.'] = 1, ['e'] = 1, ['E'] = 1,
+};
+
+static inline bool is_digit(char ch)
+{
+    return (unsigned)(ch - '0') <= 9;
+}
+
+static inline bool is_letter(char ch)
+{
+    return (unsigned)((ch | 0x20) - 'a') < 26;
+}
+
+static void* allocate(const qjson_parser* const parser, const size_t size)
+{
+    if(parser->allocator.allocate != NULL)
+    {
+        return parser->allocator.allocate(parser->allocator.context, size);
+    }
+    return malloc(size);
+}
+
+static void deallocate(const qjson_parser* const parser, void* const memory)
+{
+    if(parser->allocator.allocate == NULL)
+    {
+        free(memory);
+    }
+    else if(parser->allocator.free != NULL && memory != NULL)
+    {
+        parser->allocator.free(parser->allocator.context, memory);
+    }
+}
+
+static void* reallocate(const qjson_parser* const parser, void* const memory, const size_t old_size, const size_t new_size)
+{
+    if(parser->allocator.allocate == NULL)
+    {
+        return realloc(memory, new_size);
+    }
+    void* const new_memory = allocate(parser, new_size);
+    if(new_memory != NULL && memory != NULL)
+    {
+        memcpy(new_memory, memory, old_size);
+        deallocate(parser, memory);
+    }
+    return new_memory;
+}
+
+static void reset_parser(qjson_parser* const parser,
+                         const qjson_parse_callbacks* const callbacks,
+                         void* const context)
+{
+    parser->callbacks = callbacks;
+    parser->actions = NULL;
+    parser->on_map_key = NULL;
+    parser->on_number_raw = NULL;
+    parser->key_set = NULL;
+    parser->event_callbacks = NULL;
+    parser->events = NULL;
+    parser->event_count = 0;
+    parser->event_capacity = 0;
+    parser->event_strings_length = 0;
+    parser->document_callbacks = NULL;
+    parser->document_index = 0;
+    parser->is_element_sequence = false;
+    parser->is_list_tail = false;
+    parser->context = context;
+    parser->state = STATE_VALUE;
+    parser->has_error = false;
+    parser->is_final_buffer = true;
+    parser->is_token_incomplete = false;
+    parser->buffer_start = NULL;
+    parser->buffer_offset = 0;
+    parser->bytes_received = 0;
+    parser->container_level = 0;
+    parser->skip_depth = 0;
+    parser->carry_length = 0;
+    parser->carry_offset = 0;
+    parser->carry_is_escaped = false;
+    parser->use_index = false;
+}
+
+static void init_parser(qjson_parser* const parser,
+                        const qjson_allocator* const allocator,
+                        const char* const out_of_memory_message,
+                        const qjson_parse_callbacks* const callbacks,
+                        void* const context)
+{
+    parser->allocator = *allocator;
+    parser->out_of_memory_message = out_of_memory_message;
+    parser->container_stack = parser->inline_container_stack;
+    parser->container_capacity = INLINE_CONTAINER_STACK_SIZE;
+    parser->scratch = parser->inline_scratch;
+    parser->scratch_capacity = INLINE_SCRATCH_SIZE;
+    parser->carry = NULL;
+    parser->carry_capacity = 0;
+    parser->event_strings = NULL;
+    parser->event_strings_capacity = 0;
+    parser->index_structurals = NULL;
+    reset_parser(parser, callbacks, context);
+}
+
+static void release_parser(qjson_parser* const parser)
+{
+    if(parser->container_stack != parser->inline_container_stack)
+    {
+        deallocate(parser, parser->container_stack);
+    }
+    if(parser->scratch != parser->inline_scratch)
+    {
+        deallocate(parser, parser->scratch);
+    }
+    deallocate(parser, parser->carry);
+    deallocate(parser, parser->event_strings);
+    deallocate(parser, parser->index_structurals);
+}
+
+// Gives back any buffers that have grown past the retention limit, so that one
+// huge document does not pin its memory for the lifetime of a pooled parser.
+static void trim_parser(qjson_parser* const parser)
+{
+    if(parser->container_capacity * sizeof(*parser->container_stack) > MAX_RETAINED_BUFFER_SIZE)
+    {
+        deallocate(parser, parser->container_stack);
+        parser->container_stack = parser->inline_container_stack;
+        parser->container_capacity = INLINE_CONTAINER_STACK_SIZE;
+    }
+    if(parser->scratch_capacity > MAX_RETAINED_BUFFER_SIZE)
+    {
+        deallocate(parser, parser->scratch);
+        parser->scratch = parser->inline_scratch;
+        parser->scratch_capacity = INLINE_SCRATCH_SIZE;
+    }
+    if(parser->carry_capacity > MAX_RETAINED_BUFFER_SIZE)
+    {
+        deallocate(parser, parser->carry);
+        parser->carry = NULL;
+        parser->carry_capacity = 0;
+    }
+    if(parser->event_strings_capacity > MAX_RETAINED_BUFFER_SIZE)
+    {
+        deallocate(parser, parser->event_strings);
+        parser->event_strings = NULL;
+        parser->event_strings_capacity = 0;
+    }
+}
+
+static void flush_events(qjson_parser* const parser)
+{
+    if(parser->event_count > 0)
+    {
+        parser->event_callbacks->on_events(parser->context, parser->events, parser->event_count);
+        parser->event_count = 0;
+    }
+    parser->event_strings_length = 0;
+}
+
+static void report_error(qjson_parser* const parser, const char* const message)
+{
+    parser->has_error = true;
+    if(parser->event_callbacks != NULL)
+    {
+        // Everything parsed before the error is delivered first.
+        flush_events(parser);
+        parser->event_callbacks->on_parse_error(parser->context, message);
+    }
+    else if(parser->actions != NULL)
+    {
+        parser->actions->on_parse_error(parser->context, message);
+    }
+    else
+    {
+        parser->callbacks->on_parse_error(parser->context, message);
+    }
+}
+
+static inline size_t offset_of(const qjson_parser* const parser, const char* const pos)
+{
+    return parser->buffer_offset + (size_t)(pos - parser->buffer_start);
+}
+
+static void report_unexpected(qjson_parser* const parser, const char* const pos)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    snprintf(buff, sizeof(buff), "Unexpected token: '%c' at offset %zu", *pos, offset_of(parser, pos));
+    report_error(parser, buff);
+}
+
+static void report_unexpected_end(qjson_parser* const parser)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    snprintf(buff, sizeof(buff), "Unexpected end of document at offset %zu", parser->bytes_received);
+    report_error(parser, buff);
+}
+
+static void report_bad_data(qjson_parser* const parser, const char* const pos, const char* const description)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    snprintf(buff, sizeof(buff), "Bad encoding: %s at offset %zu", description, offset_of(parser, pos));
+    report_error(parser, buff);
+}
+
+// Reports the token at pos as unexpected, unless it may still be completed by the next chunk.
+static const char* token_cut_off(qjson_parser* const parser, const char* const pos, const char* const description)
+{
+    if(!parser->is_final_buffer)
+    {
+        parser->is_token_incomplete = true;
+    }
+    else if(description == NULL)
+    {
+        report_unexpected_end(parser);
+    }
+    else
+    {
+        report_bad_data(parser, pos, description);
+    }
+    return NULL;
+}
+
+static bool push_container(qjson_parser* const parser, const container_type type)
+{
+    if(parser->container_level >= parser->container_capacity)
+    {
+        int new_capacity = parser->container_capacity * 2;
+        uint8_t* new_stack = allocate(parser, new_capacity);
+        if(new_stack == NULL)
+        {
+            report_error(parser, parser->out_of_memory_message);
+            return false;
+        }
+        memcpy(new_stack, parser->container_stack, parser->container_level);
+        if(parser->container_stack != parser->inline_container_stack)
+        {
+            deallocate(parser, parser->container_stack);
+        }
+        parser->container_stack = new_stack;
+        parser->container_capacity = new_capacity;
+    }
+    parser->container_stack[parser->container_level++] = (uint8_t)type;
+    return true;
+}
+
+static char* reserve_scratch(qjson_parser* const parser, const size_t size)
+{
+    if(size > parser->scratch_capacity)
+    {
+        size_t new_capacity = parser->scratch_capacity * 2;
+        if(new_capacity < size)
+        {
+            new_capacity = size;
+        }
+        char* new_scratch = allocate(parser, new_capacity);
+        if(new_scratch == NULL)
+        {
+            report_error(parser, parser->out_of_memory_message);
+            return NULL;
+        }
+        if(parser->scratch != parser->inline_scratch)
+        {
+            deallocate(parser, parser->scratch);
+        }
+        parser->scratch = new_scratch;
+        parser->scratch_capacity = new_capacity;
+    }
+    return parser->scratch;
+}
+
+static inline qjson_event* add_event(qjson_parser* const parser, const qjson_event_type type, const int depth)
+{
+    if(parser->event_count >= parser->event_capacity)
+    {
+        flush_events(parser);
+    }
+    qjson_event* const event = &parser->events[parser->event_count++];
+    event->type = type;
+    event->depth = (uint32_t)depth;
+    return event;
+}
+
+// Reserves room for a string in the event string area, delivering the pending events first if it is full.
+static char* reserve_event_string(qjson_parser* const parser, const size_t length)
+{
+    if(parser->event_strings_length + length > parser->event_strings_capacity)
+    {
+        if(parser->event_strings_length > 0)
+        {
+            // Pending events point into the area, so it can only be reused or replaced once they are delivered.
+            flush_events(parser);
+        }
+        if(length > parser->event_strings_capacity)
+        {
+            size_t new_capacity = parser->event_strings_capacity > 0 ? parser->event_strings_capacity * 2 : INITIAL_EVENT_STRINGS_SIZE;
+            if(new_capacity < length)
+            {
+                new_capacity = length;
+            }
+            // The area is empty, so nothing needs to be copied.
+            deallocate(parser, parser->event_strings);
+            parser->event_strings = allocate(parser, new_capacity);
+            parser->event_strings_capacity = parser->event_strings != NULL ? new_capacity : 0;
+            if(parser->event_strings == NULL)
+            {
+                report_error(parser, parser->out_of_memory_message);
+                return NULL;
+            }
+        }
+    }
+    char* const str = parser->event_strings + parser->event_strings_length;
+    parser->event_strings_length += length;
+    return str;
+}
+
+// Adds an event for the string last decoded into scratch.
+static bool add_string_event(qjson_parser* const parser, const qjson_event_type type)
+{
+    if(parser->event_count >= parser->event_capacity)
+    {
+        flush_events(parser);
+    }
+    const char* str = parser->string_source;
+    // Unescaping always shortens a string, so one of the same length reads the same as its raw contents.
+    if(parser->string_length != parser->string_source_length)
+    {
+        char* const copy = reserve_event_string(parser, parser->string_length);
+        if(copy == NULL)
+        {
+            return false;
+        }
+        memcpy(copy, parser->scratch, parser->string_length);
+        str = copy;
+    }
+    qjson_event* const event = add_event(parser, type, parser->container_level);
+    event->string = str;
+    event->string_length = parser->string_length;
+    return true;
+}
+
+// The batched counterparts of the parse callbacks, as used by DELIVER. A container's start and end are at the
+// depth of its parent, and it has already been pushed when it starts.
+
+static inline bool batch_on_null(qjson_parser* const parser)
+{
+    add_event(parser, QJSON_EVENT_NULL, parser->container_level);
+    return true;
+}
+
+static inline bool batch_on_boolean(qjson_parser* const parser, const bool value)
+{
+    add_event(parser, value ? QJSON_EVENT_TRUE : QJSON_EVENT_FALSE, parser->container_level);
+    return true;
+}
+
+static inline bool batch_on_int(qjson_parser* const parser, const int64_t value)
+{
+    add_event(parser, QJSON_EVENT_INT, parser->container_level)->int_value = value;
+    return true;
+}
+
+static inline bool batch_on_float(qjson_parser* const parser, const double value)
+{
+    add_event(parser, QJSON_EVENT_FLOAT, parser->container_level)->float_value = value;
+    return true;
+}
+
+static inline bool batch_on_string(qjson_parser* const parser, const char* const value)
+{
+    (void)value;
+    return add_string_event(parser, QJSON_EVENT_STRING);
+}
+
+static inline bool batch_on_list_start(qjson_parser* const parser)
+{
+    add_event(parser, QJSON_EVENT_LIST_START, parser->container_level - 1);
+    return true;
+}
+
+static inline bool batch_on_list_end(qjson_parser* const parser)
+{
+    add_event(parser, QJSON_EVENT_LIST_END, parser->container_level);
+    return true;
+}
+
+static inline bool batch_on_map_start(qjson_parser* const parser)
+{
+    add_event(parser, QJSON_EVENT_MAP_START, parser->container_level - 1);
+    return true;
+}
+
+static inline bool batch_on_map_end(qjson_parser* const parser)
+{
+    add_event(parser, QJSON_EVENT_MAP_END, parser->container_level);
+    return true;
+}
+
+#define INDEX_WINDOW_BLOCKS (INDEX_WINDOW_SIZE / STRUCTURAL_BLOCK_SIZE)
+
+static void begin_index(qjson_parser* const parser, const char* const start, const char* const end)
+{
+    parser->use_index = false;
+    if(end - start < MIN_INDEXED_BUFFER_SIZE)
+    {
+        return;
+    }
+    if(parser->index_structurals == NULL)
+    {
+        parser->index_structurals = allocate(parser, INDEX_WINDOW_BLOCKS * sizeof(uint64_t));
+        if(parser->index_structurals == NULL)
+        {
+            // Not fatal: the parser just steps through the buffer unindexed.
+            return;
+        }
+    }
+    structural_scanner_init(&parser->scanner);
+    parser->use_index = true;
+    parser->index_base = start;
+    parser->index_end = start;
+    parser->index_block_count = 0;
+}
+
+// Returns the first indexed position at or after pos, indexing further windows as needed.
+static const char* next_indexed_position(qjson_parser* const parser, const char* const pos, const char* const end)
+{
+    for(;;)
+    {
+        if(pos < parser->index_end)
+        {
+            // pos may precede the window if the previous window had nothing left after it.
+            const size_t offset = pos > parser->index_base ? (size_t)(pos - parser->index_base) : 0;
+            size_t block = offset / STRUCTURAL_BLOCK_SIZE;
+            uint64_t bits = parser->index_structurals[block] & (~0ULL << (offset % STRUCTURAL_BLOCK_SIZE));
+            while(bits == 0 && ++block < parser->index_block_count)
+            {
+                bits = parser->index_structurals[block];
+            }
+            if(bits != 0)
+            {
+                return parser->index_base + block * STRUCTURAL_BLOCK_SIZE + __builtin_ctzll(bits);
+            }
+        }
+        if(parser->index_end >= end)
+        {
+            return end;
+        }
+        size_t window_size = end - parser->index_end;
+        if(window_size > INDEX_WINDOW_SIZE)
+        {
+            window_size = INDEX_WINDOW_SIZE;
+        }
+        parser->index_base = parser->index_end;
+        parser->index_end += window_size;
+        parser->index_block_count = structural_index_window(&parser->scanner,
+                                                            parser->index_base,
+                                                            window_size,
+                                                            parser->index_structurals,
+                                                            NULL);
+    }
+}
+
+static inline const char* skip_whitespace(qjson_parser* const parser, const char* pos, const char* const end)
+{
+    if(pos < end && !g_is_whitespace[(uint8_t)*pos])
+    {
+        return pos;
+    }
+    if(pos + 1 < end && !g_is_whitespace[(uint8_t)pos[1]])
+    {
+        return pos + 1;
+    }
+    if(parser->use_index)
+    {
+        // Everything between here and the next indexed position is whitespace.
+        return next_indexed_position(parser, pos, end);
+    }
+    while(pos < end && g_is_whitespace[(uint8_t)*pos])
+    {
+        pos++;
+    }
+    return pos;
+}
+
+// Returns a pointer to the closing quote of the string whose contents begin at pos, or NULL if unterminated.
+static inline const char* find_string_end(const char* pos, const char* const end)
+{
+    while(pos < end)
+    {
+        char ch = *pos;
+        if(ch == '"')
+        {
+            return pos;
+        }
+        pos += ch == '\\' ? 2 : 1;
+    }
+    return NULL;
+}
+
+// Finds the closing quote of the string whose contents begin at start, or returns NULL if unterminated.
+static inline const char* locate_string_end(qjson_parser* const parser,
+                                            const char* const start,
+                                            const char* const end)
+{
+    if(parser->use_index)
+    {
+        // Nothing inside a string is indexed, so the next position is the closing quote.
+        const char* const string_end = next_indexed_position(parser, start, end);
+        if(string_end < end && *string_end == '"')
+        {
+            return string_end;
+        }
+    }
+
+    const char* pos = start;
+    while(pos < end && !g_is_string_special[(uint8_t)*pos])
+    {
+        pos++;
+    }
+    if(pos < end && *pos == '"')
+    {
+        return pos;
+    }
+    return find_string_end(pos, end);
+}
+
+// Returns the first quote or bracket at or after pos, or end.
+static inline const char* next_skip_position(qjson_parser* const parser, const char* pos, const char* const end)
+{
+    if(parser->use_index)
+    {
+        // The index also holds commas and colons, which the caller steps over.
+        return next_indexed_position(parser, pos, end);
+    }
+    while(pos < end && !g_is_skip_special[(uint8_t)*pos])
+    {
+        pos++;
+    }
+    return pos;
+}
+
+// Decodes the string contents [start, string_end) into the scratch buffer.
+// Returns a pointer to the null terminator of the decoded string, or NULL on error.
+static char* decode_string(qjson_parser* const parser, const char* const start, const char* const string_end)
+{
+    const size_t length = string_end - start;
+    char* const str = reserve_scratch(parser, length + 1);
+    if(str == NULL)
+    {
+        return NULL;
+    }
+    char* str_end = NULL;
+    const char* error_pos = NULL;
+    switch(decode_json_string(start, string_end, str, &str_end, &error_pos))
+    {
+        case STRING_DECODE_OK:
+            break;
+        case STRING_DECODE_BAD_ESCAPE:
+            report_bad_data(parser, error_pos, "invalid escape sequence");
+            return NULL;
+        case STRING_DECODE_BAD_UTF8:
+            report_bad_data(parser, error_pos, "invalid UTF-8");
+            return NULL;
+        case STRING_DECODE_CONTROL_CHARACTER:
+            report_bad_data(parser, error_pos, "unescaped control character");
+            return NULL;
+    }
+    *str_end = 0;
+    parser->string_source = start;
+    parser->string_source_length = length;
+    parser->string_length = str_end - str;
+    return str_end;
+}
+
+// Decodes the string starting at the opening quote at pos into the scratch buffer.
+// Returns a pointer past the closing quote, or NULL on error or if the string is cut off.
+static const char* parse_string(qjson_parser* const parser, const char* pos, const char* const end)
+{
+    const char* const start = pos + 1;
+    const char* const string_end = locate_string_end(parser, start, end);
+    if(string_end == NULL)
+    {
+        return token_cut_off(parser, pos, "unterminated string");
+    }
+    return decode_string(parser, start, string_end) != NULL ? string_end + 1 : NULL;
+}
+
+// Parses the map key starting at the opening quote at pos, and identifies it if the parser has a key set.
+// Returns a pointer past the closing quote, or NULL on error or if the key is cut off.
+static const char* parse_map_key(qjson_parser* const parser,
+                                 const char* pos,
+                                 const char* const end,
+                                 const char** const key,
+                                 size_t* const length,
+                                 int* const key_id)
+{
+    const char* const start = pos + 1;
+    const char* const string_end = locate_string_end(parser, start, end);
+    if(string_end == NULL)
+    {
+        return token_cut_off(parser, pos, "unterminated string");
+    }
+
+    const size_t raw_length = string_end - start;
+    const qjson_key_set* const key_set = parser->key_set;
+    *key_id = QJSON_UNKNOWN_KEY;
+    if(key_set != NULL)
+    {
+        // Keys in the set were validated when it was built, so a raw match needs no decoding.
+        *key_id = find_key_in_set(key_set, start, raw_length, true);
+        if(*key_id != QJSON_UNKNOWN_KEY)
+        {
+            *key = get_key_in_set(key_set, *key_id, length);
+            return string_end + 1;
+        }
+    }
+
+    const char* const str_end = decode_string(parser, start, string_end);
+    if(str_end == NULL)
+    {
+        return NULL;
+    }
+    *key = parser->scratch;
+    *length = str_end - parser->scratch;
+    // Unescaping shortens a string, so a key of the same length was already looked up as it is.
+    if(key_set != NULL && *length != raw_length)
+    {
+        *key_id = find_key_in_set(key_set, *key, *length, false);
+    }
+    return string_end + 1;
+}
+
+// Converts the number starting at pos, or only checks it if is_raw is true.
+// Returns a pointer past the end of the number, or NULL on error or if the number is cut off.
+static inline const char* parse_number(qjson_parser* const parser,
+                                       const char* const pos,
+                                       const char* const end,
+                                       json_number* const number,
+                                       const bool is_raw)
+{
+    if(!parser->is_final_buffer)
+    {
+        const char* lexeme_end = pos;
+        while(lexeme_end < end && g_is_number_char[(uint8_t)*lexeme_end])
+        {
+            lexeme_end++;
+        }
+        if(lexeme_end >= end)
+        {
+            return token_cut_off(parser, pos, NULL);
+        }
+    }
+
+    switch(is_raw ? scan_json_number(pos, end, number) : parse_json_number(pos, end, number))
+    {
+        case NUMBER_STATUS_OK:
+            break;
+        case NUMBER_STATUS_INCOMPLETE:
+            return token_cut_off(parser, pos, NULL);
+        case NUMBER_STATUS_INVALID:
+            report_unexpected(parser, number->end);
+            return NULL;
+        case NUMBER_STATUS_OUT_OF_RANGE:
+            report_bad_data(parser, pos, number->is_float ? "float out of range" : "integer out of range");
+            return NULL;
+    }
+    return number->end;
+}
+
+// Matches the literal at pos against expected.
+// Returns a pointer past the end of the literal, or NULL on error or if the literal is cut off.
+static inline const char* parse_literal(qjson_parser* const parser,
+                                        const char* const pos,
+                                        const char* const end,
+                                        const char* const expected,
+                                        const size_t length)
+{
+    const size_t available = (size_t)(end - pos);
+    if(available >= length)
+    {
+        if(memcmp(pos, expected, length) == 0)
+        {
+            return pos + length;
+        }
+    }
+    else if(memcmp(pos, expected, available) == 0)
+    {
+        return token_cut_off(parser, pos, NULL);
+    }
+    report_unexpected(parser, pos);
+    return NULL;
+}
+
+// Delivers an event through whichever callback table the parser was given, or adds it to the batch.
+// An action callback that asks for anything but QJSON_CONTINUE diverts parse_tokens to apply_action.
+#define DELIVER(EVENT, ...) \
+    do \
+    { \
+        if(actions == NULL) \
+        { \
+            if(!is_batched) \
+            { \
+                callbacks->EVENT(context, ## __VA_ARGS__); \
+            } \
+            else if(!batch_##EVENT(parser, ## __VA_ARGS__)) \
+            { \
+                return NULL; \
+            } \
+        } \
+        else if((action = actions->EVENT(context, ## __VA_ARGS__)) != QJSON_CONTINUE) \
+        { \
+            goto apply_action; \
+        } \
+    } while(0)
+
+// Runs the state machine over [pos, end).
+// Returns end if the buffer was consumed, the start of the last token if it was cut off, or NULL on error.
+static const char* parse_tokens(qjson_parser* const parser, const char* pos, const char* const end)
+{
+    const qjson_parse_callbacks* const callbacks = parser->callbacks;
+    const qjson_action_callbacks* const actions = parser->actions;
+    const bool is_batched = parser->event_callbacks != NULL;
+    qjson_action (*const on_map_key)(void*, const char*, size_t, int) = parser->on_map_key;
+    qjson_action (*const on_number_raw)(void*, const char*, size_t, int) = parser->on_number_raw;
+    void* const context = parser->context;
+    const char* token_start = pos;
+    qjson_action action = QJSON_CONTINUE;
+    json_number number;
+
+    switch(parser->state)
+    {
+        case STATE_VALUE:             goto parse_value;
+        case STATE_FIRST_LIST_ENTRY:  goto parse_first_list_entry;
+        case STATE_FIRST_MAP_KEY:     goto parse_first_map_key;
+        case STATE_MAP_KEY:           goto parse_map_key;
+        case STATE_MAP_ASSIGNMENT:    goto parse_map_assignment;
+        case STATE_AFTER_VALUE:       goto after_value;
+        case STATE_DOCUMENT_END:      goto parse_document_trailer;
+        case STATE_SKIP_CONTAINER:    goto skip_container;
+        case STATE_STOPPED:           return end;
+        case STATE_ELEMENT_SEPARATOR: goto parse_element_separator;
+    }
+
+parse_value:
+    parser->state = STATE_VALUE;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(parser->container_level == 0 && parser->document_callbacks != NULL)
+    {
+        parser->document_callbacks->on_document_start(context, parser->document_index);
+    }
+    token_start = pos;
+    switch(*pos)
+    {
+        case '{':
+            if(!push_container(parser, CONTAINER_MAP)) return NULL;
+            pos++;
+            DELIVER(on_map_start);
+            goto parse_first_map_key;
+        case '[':
+            if(!push_container(parser, CONTAINER_LIST)) return NULL;
+            pos++;
+            DELIVER(on_list_start);
+            goto parse_first_list_entry;
+        case '"':
+            pos = parse_string(parser, pos, end);
+            if(pos == NULL) goto token_stopped;
+            DELIVER(on_string, parser->scratch);
+            goto after_value;
+        case 't':
+            pos = parse_literal(parser, pos, end, "true", 4);
+            if(pos == NULL) goto token_stopped;
+            DELIVER(on_boolean, true);
+            goto after_value;
+        case 'f':
+            pos = parse_literal(parser, pos, end, "false", 5);
+            if(pos == NULL) goto token_stopped;
+            DELIVER(on_boolean, false);
+            goto after_value;
+        case 'n':
+            pos = parse_literal(parser, pos, end, "null", 4);
+            if(pos == NULL) goto token_stopped;
+            DELIVER(on_null);
+            goto after_value;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if(on_number_raw != NULL)
+            {
+                pos = parse_number(parser, pos, end, &number, true);
+                if(pos == NULL) goto token_stopped;
+                action = on_number_raw(context,
+                                       token_start,
+                                       pos - token_start,
+                                       (number.has_fraction ? QJSON_NUMBER_HAS_FRACTION : 0) |
+                                       (number.has_exponent ? QJSON_NUMBER_HAS_EXPONENT : 0));
+                if(action != QJSON_CONTINUE) goto apply_action;
+                goto after_value;
+            }
+            pos = parse_number(parser, pos, end, &number, false);
+            if(pos == NULL) goto token_stopped;
+            if(number.is_float)
+            {
+                DELIVER(on_float, number.float_value);
+            }
+            else
+            {
+                DELIVER(on_int, number.int_value);
+            }
+            goto after_value;
+        default:
+            report_unexpected(parser, pos);
+            return NULL;
+    }
+
+parse_first_list_entry:
+    parser->state = STATE_FIRST_LIST_ENTRY;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(*pos == ']')
+    {
+        pos++;
+        parser->container_level--;
+        DELIVER(on_list_end);
+        goto after_value;
+    }
+    goto parse_value;
+
+parse_first_map_key:
+    parser->state = STATE_FIRST_MAP_KEY;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(*pos == '}')
+    {
+        pos++;
+        parser->container_level--;
+        DELIVER(on_map_end);
+        goto after_value;
+    }
+    goto parse_map_key_string;
+
+parse_map_key:
+    parser->state = STATE_MAP_KEY;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+parse_map_key_string:
+    if(*pos != '"')
+    {
+        report_unexpected(parser, pos);
+        return NULL;
+    }
+    token_start = pos;
+    if(on_map_key != NULL)
+    {
+        const char* key;
+        size_t key_length;
+        int key_id;
+        pos = parse_map_key(parser, pos, end, &key, &key_length, &key_id);
+        if(pos == NULL) goto token_stopped;
+        action = on_map_key(context, key, key_length, key_id);
+        if(action != QJSON_CONTINUE) goto apply_action;
+    }
+    else if(is_batched)
+    {
+        pos = parse_string(parser, pos, end);
+        if(pos == NULL) goto token_stopped;
+        if(!add_string_event(parser, QJSON_EVENT_MAP_KEY)) return NULL;
+    }
+    else
+    {
+        pos = parse_string(parser, pos, end);
+        if(pos == NULL) goto token_stopped;
+        DELIVER(on_string, parser->scratch);
+    }
+
+parse_map_assignment:
+    parser->state = STATE_MAP_ASSIGNMENT;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(*pos != ':')
+    {
+        report_unexpected(parser, pos);
+        return NULL;
+    }
+    pos++;
+    goto parse_value;
+
+after_value:
+    if(parser->container_level == 0)
+    {
+        goto parse_document_end;
+    }
+    parser->state = STATE_AFTER_VALUE;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(parser->container_stack[parser->container_level - 1] == CONTAINER_MAP)
+    {
+        if(*pos == ',')
+        {
+            pos++;
+            goto parse_map_key;
+        }
+        if(*pos == '}')
+        {
+            pos++;
+            parser->container_level--;
+            DELIVER(on_map_end);
+            goto after_value;
+        }
+    }
+    else
+    {
+        if(*pos == ',')
+        {
+            pos++;
+            goto parse_value;
+        }
+        if(*pos == ']')
+        {
+            pos++;
+            parser->container_level--;
+            DELIVER(on_list_end);
+            goto after_value;
+        }
+    }
+    report_unexpected(parser, pos);
+    return NULL;
+
+parse_document_end:
+    if(parser->document_callbacks != NULL)
+    {
+        parser->document_callbacks->on_document_end(context, parser->document_index++);
+        if(!parser->is_element_sequence) goto parse_value;
+        goto parse_element_separator;
+    }
+parse_document_trailer:
+    parser->state = STATE_DOCUMENT_END;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos < end)
+    {
+        report_unexpected(parser, pos);
+        return NULL;
+    }
+    return end;
+
+parse_element_separator:
+    parser->state = STATE_ELEMENT_SEPARATOR;
+    pos = skip_whitespace(parser, pos, end);
+    if(pos >= end) return end;
+    if(*pos == ',')
+    {
+        pos++;
+        goto parse_value;
+    }
+    if(*pos == ']' && parser->is_list_tail)
+    {
+        pos++;
+        goto parse_document_trailer;
+    }
+    report_unexpected(parser, pos);
+    return NULL;
+
+apply_action:
+    if(action == QJSON_STOP)
+    {
+        parser->state = STATE_STOPPED;
+        return end;
+    }
+    if(parser->container_level == 0)
+    {
+        // There is no enclosing container to skip.
+        goto after_value;
+    }
+    parser->skip_depth = 0;
+
+skip_container:
+    parser->state = STATE_SKIP_CONTAINER;
+    for(;;)
+    {
+        pos = next_skip_position(parser, pos, end);
+        if(pos >= end) return end;
+        switch(*pos)
+        {
+            case '"':
+            {
+                // Strings are stepped over whole, so that brackets inside them are not counted.
+                token_start = pos;
+                const char* const string_end = locate_string_end(parser, pos + 1, end);
+                if(string_end == NULL)
+                {
+                    token_cut_off(parser, pos, "unterminated string");
+                    goto token_stopped;
+                }
+                pos = string_end + 1;
+                break;
+            }
+            case '[':
+            case '{':
+                parser->skip_depth++;
+                pos++;
+                break;
+            case ']':
+            case '}':
+                if(parser->skip_depth == 0)
+                {
+                    // The closing bracket is checked against the container and delivered as usual.
+                    goto after_value;
+                }
+                parser->skip_depth--;
+                pos++;
+                break;
+            default:
+                pos++;
+                break;
+        }
+    }
+
+token_stopped:
+    if(parser->is_token_incomplete)
+    {
+        parser->is_token_incomplete = false;
+        return token_start;
+    }
+    return NULL;
+}
+
+#undef DELIVER
+
+static bool append_carry(qjson_parser* const parser, const char* const data, const size_t length)
+{
+    size_t required = parser->carry_length + length;
+    if(required > parser->carry_capacity)
+    {
+        size_t new_capacity = parser->carry_capacity > 0 ? parser->carry_capacity * 2 : INITIAL_CARRY_SIZE;
+        if(new_capacity < required)
+        {
+            new_capacity = required;
+        }
+        char* new_carry = reallocate(parser, parser->carry, parser->carry_length, new_capacity);
+        if(new_carry == NULL)
+        {
+            report_error(parser, parser->out_of_memory_message);
+            return false;
+        }
+        parser->carry = new_carry;
+        parser->carry_capacity = new_capacity;
+    }
+    memcpy(parser->carry + parser->carry_length, data, length);
+    parser->carry_length = required;
+    return true;
+}
+
+// Scans data for the end of the token being carried over from previous chunks.
+// Returns the number of bytes of data that belong to the token, or SIZE_MAX if it continues past the end of data.
+static size_t find_carried_token_end(qjson_parser* const parser, const char* const data, const size_t length)
+{
+    const char first = parser->carry[0];
+    size_t i = 0;
+    if(first == '"')
+    {
+        for(; i < length; i++)
+        {
+            if(parser->carry_is_escaped)
+            {
+                parser->carry_is_escaped = false;
+            }
+            else if(data[i] == '\\')
+            {
+                parser->carry_is_escaped = true;
+            }
+            else if(data[i] == '"')
+            {
+                return i + 1;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    if(is_letter(first))
+    {
+        while(i < length && is_letter(data[i]))
+        {
+            i++;
+        }
+    }
+    else
+    {
+        while(i < length && g_is_number_char[(uint8_t)data[i]])
+        {
+            i++;
+        }
+    }
+    return i < length ? i : SIZE_MAX;
+}
+
+// Parses one buffer's worth of tokens, moving any token that is cut off at the end into the carry buffer.
+static bool parse_buffer(qjson_parser* const parser,
+                         const char* const start,
+                         const char* const end,
+                         const size_t offset,
+                         const bool is_final)
+{
+    parser->buffer_start = start;
+    parser->buffer_offset = offset;
+    parser->is_final_buffer = is_final;
+    begin_index(parser, start, end);
+
+    const char* const stop = parse_tokens(parser, start, end);
+    parser->use_index = false;
+    if(parser->event_callbacks != NULL)
+    {
+        // String events may point into this buffer.
+        flush_events(parser);
+    }
+    if(stop == NULL)
+    {
+        return false;
+    }
+    if(stop == end)
+    {
+        return true;
+    }
+
+    parser->carry_length = 0;
+    parser->carry_offset = offset_of(parser, stop);
+    parser->carry_is_escaped = false;
+    if(!append_carry(parser, stop, end - stop))
+    {
+        return false;
+    }
+    if(*stop == '"')
+    {
+        find_carried_token_end(parser, parser->carry + 1, parser->carry_length - 1);
+    }
+    return true;
+}
+
+static bool parse_carry(qjson_parser* const parser)
+{
+    // The carry buffer is not touched while it is being parsed, because a final buffer never leaves a token cut off.
+    bool result = parse_buffer(parser, parser->carry, parser->carry + parser->carry_length, parser->carry_offset, true);
+    parser->carry_length = 0;
+    return result;
+}
+
+static bool check_document_complete(qjson_parser* const parser)
+{
+    // A document sequence may end anywhere between documents, including before the first one,
+    // but an element sequence must end after an element (or after the list, if it runs to the list's end).
+    bool is_complete = parser->state == STATE_DOCUMENT_END;
+    if(parser->is_element_sequence)
+    {
+        is_complete = parser->state == (parser->is_list_tail ? STATE_DOCUMENT_END : STATE_ELEMENT_SEPARATOR);
+    }
+    else if(parser->document_callbacks != NULL)
+    {
+        is_complete = parser->state == STATE_VALUE && parser->container_level == 0;
+    }
+    is_complete = is_complete || parser->state == STATE_STOPPED;
+    if(!is_complete)
+    {
+        report_unexpected_end(parser);
+        return false;
+    }
+    return true;
+}
+
+qjson_parser* new_parser_with_allocator(const qjson_allocator* const allocator,
+                                        const char* const out_of_memory_message,
+                                        const qjson_parse_callbacks* const callbacks,
+                                        void* const context)
+{
+    qjson_parser* parser = allocator->allocate != NULL ? allocator->allocate(allocator->context, sizeof(*parser))
+                                                       : malloc(sizeof(*parser));
+    if(parser != NULL)
+    {
+        init_parser(parser, allocator, out_of_memory_message, callbacks, context);
+    }
+    return parser;
+}
+
+qjson_parser* qjson_new_parser(const qjson_parse_callbacks* const callbacks, void* const context)
+{
+    const qjson_allocator allocator = {0};
+    return new_parser_with_allocator(&allocator, "Out of memory", callbacks, context);
+}
+
+qjson_parser* qjson_new_parser_with_allocator(const qjson_allocator* const allocator,
+                                              const qjson_parse_callbacks* const callbacks,
+                                              void* const context)
+{
+    return new_parser_with_allocator(allocator, "Out of memory", callbacks, context);
+}
+
+void qjson_free_parser(qjson_parser* const parser)
+{
+    if(parser != NULL)
+    {
+        release_parser(parser);
+        deallocate(parser, parser);
+    }
+}
+
+bool qjson_feed_parser(qjson_parser* const parser, const char* const chunk, const size_t length)
+{
+    if(parser->has_error)
+    {
+        return false;
+    }
+
+    const size_t chunk_offset = parser->bytes_received;
+    parser->bytes_received += length;
+    size_t consumed = 0;
+
+    if(parser->carry_length > 0)
+    {
+        consumed = find_carried_token_end(parser, chunk, length);
+        if(consumed == SIZE_MAX)
+        {
+            return append_carry(parser, chunk, length);
+        }
+        if(!append_carry(parser, chunk, consumed) || !parse_carry(parser))
+        {
+            return false;
+        }
+    }
+
+    return parse_buffer(parser, chunk + consumed, chunk + length, chunk_offset + consumed, false);
+}
+
+bool qjson_finish_parser(qjson_parser* const parser)
+{
+    if(parser->has_error)
+    {
+        return false;
+    }
+    if(parser->carry_length > 0 && !parse_carry(parser))
+    {
+        return false;
+    }
+    return check_document_complete(parser);
+}
+
+void qjson_reset_parser(qjson_parser* const parser, const qjson_parse_callbacks* const callbacks, void* const context)
+{
+    reset_parser(parser, callbacks, context);
+}
+
+void qjson_reset_parser_with_actions(qjson_parser* const parser,
+                                     const qjson_action_callbacks* const callbacks,
+                                     void* const context)
+{
+    reset_parser(parser, NULL, context);
+    parser->actions = callbacks;
+    // Older tables end before the callbacks added in later versions.
+    if(callbacks->version >= 2)
+    {
+        parser->on_map_key = callbacks->on_map_key;
+        parser->key_set = callbacks->key_set;
+    }
+    if(callbacks->version >= 3)
+    {
+        parser->on_number_raw = callbacks->on_number_raw;
+    }
+}
+
+void qjson_reset_parser_batched(qjson_parser* const parser,
+                                const qjson_event_callbacks* const callbacks,
+                                qjson_event* const events,
+                                const size_t event_capacity,
+                                void* const context)
+{
+    reset_parser(parser, NULL, context);
+    parser->event_callbacks = callbacks;
+    parser->events = events;
+    parser->event_capacity = event_capacity;
+}
+
+bool qjson_parse_buffer_with_parser(qjson_parser* const parser,
+                                    const char* const data,
+                                    const size_t length,
+                                    const qjson_parse_callbacks* const callbacks,
+                                    void* const context)
+{
+    reset_parser(parser, callbacks, context);
+    parser->bytes_received = length;
+    return parse_buffer(parser, data, data + length, 0, true) && check_document_complete(parser);
+}
+
+bool parse_document_sequence(qjson_parser* const parser,
+                             const char* const data,
+                             const size_t length,
+                             const size_t offset,
+                             const qjson_parse_callbacks* const callbacks,
+                             const qjson_document_callbacks* const document_callbacks,
+                             void* const context)
+{
+    reset_parser(parser, callbacks, context);
+    parser->document_callbacks = document_callbacks;
+    parser->bytes_received = offset + length;
+    return parse_buffer(parser, data, data + length, offset, true) && check_document_complete(parser);
+}
+
+bool parse_element_sequence(qjson_parser* const parser,
+                            const char* const data,
+                            const size_t length,
+                            const size_t offset,
+                            const size_t first_element_index,
+                            const bool is_list_tail,
+                            const qjson_parse_callbacks* const callbacks,
+                            const qjson_document_callbacks* const element_callbacks,
+                            void* const context)
+{
+    reset_parser(parser, callbacks, context);
+    parser->document_callbacks = element_callbacks;
+    parser->document_index = first_element_index;
+    parser->is_element_sequence = true;
+    parser->is_list_tail = is_list_tail;
+    parser->bytes_received = offset + length;
+    return parse_buffer(parser, data, data + length, offset, true) && check_document_complete(parser);
+}
+
+typedef struct
+{
+    qjson_parser* parsers[THREAD_PARSER_POOL_SIZE];
+    int count;
+} thread_parser_pool;
+
+static _Thread_local thread_parser_pool g_thread_parser_pool;
+static pthread_key_t g_thread_parser_pool_key;
+static pthread_once_t g_thread_parser_pool_key_once = PTHREAD_ONCE_INIT;
+
+static void free_thread_parser_pool(void* const pool_ptr)
+{
+    thread_parser_pool* const pool = (thread_parser_pool*)pool_ptr;
+    while(pool->count > 0)
+    {
+        qjson_free_parser(pool->parsers[--pool->count]);
+    }
+}
+
+static void create_thread_parser_pool_key(void)
+{
+    pthread_key_create(&g_thread_parser_pool_key, free_thread_parser_pool);
+}
+
+qjson_parser* qjson_acquire_thread_parser(void)
+{
+    thread_parser_pool* const pool = &g_thread_parser_pool;
+    if(pool->count > 0)
+    {
+        return pool->parsers[--pool->count];
+    }
+    return qjson_new_parser(NULL, NULL);
+}
+
+void qjson_release_thread_parser(qjson_parser* const parser)
+{
+    thread_parser_pool* const pool = &g_thread_parser_pool;
+    if(pool->count >= THREAD_PARSER_POOL_SIZE)
+    {
+        qjson_free_parser(parser);
+        return;
+    }
+    if(pool->count == 0)
+    {
+        // Registering the pool with a thread-specific key frees it when the thread exits.
+        pthread_once(&g_thread_parser_pool_key_once, create_thread_parser_pool_key);
+        pthread_setspecific(g_thread_parser_pool_key, pool);
+    }
+    trim_parser(parser);
+    pool->parsers[pool->count++] = parser;
+}
+
+bool qjson_parse_buffer(const char* const data,
+                        const size_t length,
+                        const qjson_parse_callbacks* const callbacks,
+                        void* context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    bool result = qjson_parse_buffer_with_parser(parser, data, length, callbacks, context);
+    qjson_release_thread_parser(parser);
+    return result;
+}
+
+bool qjson_parse_buffer_with_actions(const char* const data,
+                                     const size_t length,
+                                     const qjson_action_callbacks* const callbacks,
+                                     void* context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    qjson_reset_parser_with_actions(parser, callbacks, context);
+    parser->bytes_received = length;
+    const bool result = parse_buffer(parser, data, data + length, 0, true) && check_document_complete(parser);
+    qjson_release_thread_parser(parser);
+    return result;
+}
+
+bool qjson_parse_buffer_batched(const char* const data,
+                                const size_t length,
+                                const qjson_event_callbacks* const callbacks,
+                                qjson_event* const events,
+                                const size_t event_capacity,
+                                void* const context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    qjson_reset_parser_batched(parser, callbacks, events, event_capacity, context);
+    parser->bytes_received = length;
+    const bool result = parse_buffer(parser, data, data + length, 0, true) && check_document_complete(parser);
+    qjson_release_thread_parser(parser);
+    return result;
+}
+
+#ifndef QJSON_USE_FLEX_BISON_PARSER
+bool qjson_parse_string(const char* const input, const qjson_parse_callbacks* const callbacks, void* context)
+{
+    return qjson_parse_buffer(input, strlen(input), callbacks, context);
+}
+#endif
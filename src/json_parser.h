@@ -0,0 +1,82 @@
+#ifndef json_parser_H
+#define json_parser_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "qjson/qjson.h"
+
+// Internal entry points into the hand-written parser (see json_parser.c).
+
+#define ERROR_MESSAGE_SIZE 200
+
+/**
+ * Create a new push-mode parser that takes all of its memory from an allocator.
+ *
+ * @param allocator The allocator, which is copied into the parser. A NULL allocate function means malloc and free.
+ * @param out_of_memory_message The error to report when the allocator runs out of memory.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return The new parser, or NULL if memory could not be allocated.
+ */
+qjson_parser* new_parser_with_allocator(const qjson_allocator* allocator,
+                                        const char* out_of_memory_message,
+                                        const qjson_parse_callbacks* callbacks,
+                                        void* context);
+
+/**
+ * Reset a parser and use it to parse a buffer holding any number of documents,
+ * separated by optional whitespace, or exactly one document if document_callbacks
+ * is NULL. Offsets in error messages are reported relative to the start of the
+ * enclosing stream rather than the buffer.
+ *
+ * @param parser The parser.
+ * @param data The start of the buffer.
+ * @param length The length of the buffer in bytes.
+ * @param offset The offset of the buffer within the enclosing stream.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param document_callbacks The callbacks to call at the start and end of each document (may be NULL).
+ *                           Document indices count from 0 at the start of the buffer.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if the buffer held only complete, valid documents.
+ */
+bool parse_document_sequence(qjson_parser* parser,
+                             const char* data,
+                             size_t length,
+                             size_t offset,
+                             const qjson_parse_callbacks* callbacks,
+                             const qjson_document_callbacks* document_callbacks,
+                             void* context);
+
+/**
+ * Reset a parser and use it to parse the comma-separated elements of a list, without its opening bracket.
+ * Each element is delivered as a document, and there must be at least one.
+ *
+ * @param parser The parser.
+ * @param data The start of the elements.
+ * @param length The length of the elements in bytes.
+ * @param offset The offset of the elements within the enclosing document.
+ * @param first_element_index The index of the first element within the list.
+ * @param is_list_tail true if the buffer runs on through the list's closing bracket to the end of the document,
+ *                     and false if it ends just before a comma between elements.
+ * @param callbacks The callbacks to call as the parser encounters entities.
+ * @param element_callbacks The callbacks to call at the start and end of each element.
+ * @param context Pointer to a user-supplied context object that gets passed directly to the callback functions.
+ * @return true if the buffer held only complete, valid elements.
+ */
+bool parse_element_sequence(qjson_parser* parser,
+                            const char* data,
+                            size_t length,
+                            size_t offset,
+                            size_t first_element_index,
+                            bool is_list_tail,
+                            const qjson_parse_callbacks* callbacks,
+                            const qjson_document_callbacks* element_callbacks,
+                            void* context);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // json_parser_H
@@ -0,0 +1,352 @@
+#include "key_set.h"
+#include "string_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Perfect hashing of a fixed set of map keys.
+//
+// Every key is hashed once with a seeded 64-bit hash. The top bits of the
+// hash pick a bucket, and the bucket's displacement is XORed into the low
+// bits to pick a slot. Construction places the fullest buckets first, looking
+// for a displacement that sends all of a bucket's keys to free slots, until
+// each key has a slot to itself. A lookup is then one hash, two loads and one
+// comparison, however many keys there are.
+
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+#define MIN_SLOT_BITS 3
+#define MAX_SLOT_BITS 30
+#define SEED_ATTEMPTS 16
+#define EMPTY_SLOT -1
+
+typedef struct
+{
+    const char* key;
+    size_t length;
+    // The key holds a backslash or a control character, so the raw contents of a valid JSON string never read the same.
+    bool is_escaped;
+} key_entry;
+
+struct qjson_key_set
+{
+    uint64_t seed;
+    int bucket_shift;
+    uint32_t slot_mask;
+    uint32_t* displacements;
+    int32_t* slots;
+    key_entry* keys;
+    size_t key_count;
+    char* strings;
+};
+
+typedef struct
+{
+    uint32_t bucket;
+    uint32_t key_count;
+} bucket_size;
+
+static inline uint64_t load_word(const char* const pos)
+{
+    uint64_t word;
+    memcpy(&word, pos, sizeof(word));
+    return word;
+}
+
+static inline uint64_t hash_key(const char* const key, const size_t length, const uint64_t seed)
+{
+    uint64_t hash = seed ^ (length * HASH_MULTIPLIER);
+    if(length >= sizeof(uint64_t))
+    {
+        for(size_t i = 0; i + sizeof(uint64_t) < length; i += sizeof(uint64_t))
+        {
+            hash = (hash ^ load_word(key + i)) * HASH_MULTIPLIER;
+            hash ^= hash >> 32;
+        }
+        // The last word overlaps the previous one, rather than reading past the key.
+        hash ^= load_word(key + length - sizeof(uint64_t));
+    }
+    else
+    {
+        uint64_t word = 0;
+        memcpy(&word, key, length);
+        hash ^= word;
+    }
+    // The 64-bit finalizer from MurmurHash3.
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static inline uint32_t get_slot(const qjson_key_set* const set, const uint64_t hash)
+{
+    return ((uint32_t)hash ^ set->displacements[hash >> set->bucket_shift]) & set->slot_mask;
+}
+
+static int compare_bucket_sizes(const void* const a, const void* const b)
+{
+    const bucket_size* const first = (const bucket_size*)a;
+    const bucket_size* const second = (const bucket_size*)b;
+    if(first->key_count != second->key_count)
+    {
+        return first->key_count > second->key_count ? -1 : 1;
+    }
+    return first->bucket < second->bucket ? -1 : first->bucket > second->bucket;
+}
+
+typedef enum
+{
+    PLACE_OK,
+    PLACE_COLLISION,
+    PLACE_DUPLICATE_KEY,
+    PLACE_OUT_OF_MEMORY,
+} place_status;
+
+// Tries to give every key its own slot using the set's current seed and table size.
+static place_status place_keys(qjson_key_set* const set, const int slot_bits)
+{
+    const uint32_t slot_count = 1U << slot_bits;
+    const uint32_t bucket_count = slot_count / 2;
+    const size_t key_count = set->key_count;
+    place_status status = PLACE_OUT_OF_MEMORY;
+
+    uint64_t* const hashes = malloc(key_count * sizeof(*hashes) + 1);
+    uint32_t* const bucket_starts = calloc(bucket_count + 1, sizeof(*bucket_starts));
+    uint32_t* const bucket_keys = malloc(key_count * sizeof(*bucket_keys) + 1);
+    bucket_size* const sizes = malloc(bucket_count * sizeof(*sizes));
+    if(hashes == NULL || bucket_starts == NULL || bucket_keys == NULL || sizes == NULL)
+    {
+        goto done;
+    }
+
+    set->bucket_shift = 64 - (slot_bits - 1);
+    set->slot_mask = slot_count - 1;
+    memset(set->displacements, 0, bucket_count * sizeof(*set->displacements));
+    for(uint32_t slot = 0; slot < slot_count; slot++)
+    {
+        set->slots[slot] = EMPTY_SLOT;
+    }
+
+    // Group the keys by bucket.
+    for(size_t i = 0; i < key_count; i++)
+    {
+        hashes[i] = hash_key(set->keys[i].key, set->keys[i].length, set->seed);
+        bucket_starts[(hashes[i] >> set->bucket_shift) + 1]++;
+    }
+    for(uint32_t bucket = 0; bucket < bucket_count; bucket++)
+    {
+        sizes[bucket].bucket = bucket;
+        sizes[bucket].key_count = bucket_starts[bucket + 1];
+        bucket_starts[bucket + 1] += bucket_starts[bucket];
+    }
+    for(size_t i = 0; i < key_count; i++)
+    {
+        // Fill each bucket from the back, which leaves the key counts at zero.
+        const uint32_t bucket = (uint32_t)(hashes[i] >> set->bucket_shift);
+        bucket_keys[bucket_starts[bucket] + --sizes[bucket].key_count] = (uint32_t)i;
+    }
+    for(uint32_t bucket = 0; bucket < bucket_count; bucket++)
+    {
+        sizes[bucket].key_count = bucket_starts[bucket + 1] - bucket_starts[bucket];
+    }
+    qsort(sizes, bucket_count, sizeof(*sizes), compare_bucket_sizes);
+
+    status = PLACE_COLLISION;
+    for(uint32_t i = 0; i < bucket_count && sizes[i].key_count > 0; i++)
+    {
+        const uint32_t bucket = sizes[i].bucket;
+        const uint32_t* const keys = bucket_keys + bucket_starts[bucket];
+        const uint32_t bucket_key_count = sizes[i].key_count;
+
+        // Keys whose low bits match always land on the same slot, whatever the displacement.
+        for(uint32_t a = 0; a < bucket_key_count; a++)
+        {
+            for(uint32_t b = a + 1; b < bucket_key_count; b++)
+            {
+                if(((hashes[keys[a]] ^ hashes[keys[b]]) & set->slot_mask) == 0)
+                {
+                    const key_entry* const first = &set->keys[keys[a]];
+                    const key_entry* const second = &set->keys[keys[b]];
+                    if(first->length == second->length && memcmp(first->key, second->key, first->length) == 0)
+                    {
+                        status = PLACE_DUPLICATE_KEY;
+                    }
+                    goto done;
+                }
+            }
+        }
+
+        bool is_placed = false;
+        for(uint32_t displacement = 0; displacement < slot_count && !is_placed; displacement++)
+        {
+            is_placed = true;
+            for(uint32_t k = 0; k < bucket_key_count; k++)
+            {
+                if(set->slots[((uint32_t)hashes[keys[k]] ^ displacement) & set->slot_mask] != EMPTY_SLOT)
+                {
+                    is_placed = false;
+                    break;
+                }
+            }
+            if(is_placed)
+            {
+                set->displacements[bucket] = displacement;
+                for(uint32_t k = 0; k < bucket_key_count; k++)
+                {
+                    set->slots[get_slot(set, hashes[keys[k]])] = (int32_t)keys[k];
+                }
+            }
+        }
+        if(!is_placed)
+        {
+            goto done;
+        }
+    }
+    status = PLACE_OK;
+
+done:
+    free(hashes);
+    free(bucket_starts);
+    free(bucket_keys);
+    free(sizes);
+    return status;
+}
+
+// Whether a key holds characters that a JSON string can only hold escaped.
+static bool has_escaped_characters(const char* const key, const size_t length)
+{
+    for(size_t i = 0; i < length; i++)
+    {
+        if(key[i] == '\\' || (uint8_t)key[i] < 0x20)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copies the keys into the set, checking that they are valid UTF-8.
+static bool copy_keys(qjson_key_set* const set, const char* const* const keys, const size_t key_count)
+{
+    size_t total_length = 0;
+    for(size_t i = 0; i < key_count; i++)
+    {
+        total_length += strlen(keys[i]) + 1;
+    }
+    set->strings = malloc(total_length + 1);
+    set->keys = malloc(key_count * sizeof(*set->keys) + 1);
+    if(set->strings == NULL || set->keys == NULL)
+    {
+        return false;
+    }
+
+    char* pos = set->strings;
+    for(size_t i = 0; i < key_count; i++)
+    {
+        key_entry* const entry = &set->keys[i];
+        entry->key = pos;
+        entry->length = strlen(keys[i]);
+        entry->is_escaped = has_escaped_characters(keys[i], entry->length);
+        memcpy(pos, keys[i], entry->length + 1);
+        if(!entry->is_escaped)
+        {
+            // Without a backslash the decoder only validates, and leaves the key as it is.
+            char* decoded_end = NULL;
+            const char* error_pos = NULL;
+            if(decode_json_string(pos, pos + entry->length, pos, &decoded_end, &error_pos) != STRING_DECODE_OK)
+            {
+                return false;
+            }
+        }
+        pos += entry->length + 1;
+    }
+    set->key_count = key_count;
+    return true;
+}
+
+qjson_key_set* qjson_new_key_set(const char* const* const keys, const size_t key_count)
+{
+    if(key_count > (1U << (MAX_SLOT_BITS - 1)))
+    {
+        return NULL;
+    }
+    qjson_key_set* const set = calloc(1, sizeof(*set));
+    if(set == NULL)
+    {
+        return NULL;
+    }
+    if(!copy_keys(set, keys, key_count))
+    {
+        qjson_free_key_set(set);
+        return NULL;
+    }
+
+    // Start with a table at least a quarter larger than the set.
+    int slot_bits = MIN_SLOT_BITS;
+    while((1U << slot_bits) < key_count + key_count / 4)
+    {
+        slot_bits++;
+    }
+    for(; slot_bits <= MAX_SLOT_BITS; slot_bits++)
+    {
+        free(set->slots);
+        free(set->displacements);
+        set->slots = malloc((1U << slot_bits) * sizeof(*set->slots));
+        set->displacements = malloc((1U << (slot_bits - 1)) * sizeof(*set->displacements));
+        if(set->slots == NULL || set->displacements == NULL)
+        {
+            break;
+        }
+        for(int attempt = 0; attempt < SEED_ATTEMPTS; attempt++)
+        {
+            set->seed = (uint64_t)(slot_bits * SEED_ATTEMPTS + attempt + 1) * HASH_MULTIPLIER;
+            switch(place_keys(set, slot_bits))
+            {
+                case PLACE_OK:
+                    return set;
+                case PLACE_COLLISION:
+                    continue;
+                case PLACE_DUPLICATE_KEY:
+                case PLACE_OUT_OF_MEMORY:
+                    qjson_free_key_set(set);
+                    return NULL;
+            }
+        }
+    }
+    qjson_free_key_set(set);
+    return NULL;
+}
+
+void qjson_free_key_set(qjson_key_set* const set)
+{
+    if(set != NULL)
+    {
+        free(set->displacements);
+        free(set->slots);
+        free(set->keys);
+        free(set->strings);
+        free(set);
+    }
+}
+
+int find_key_in_set(const qjson_key_set* const set, const char* const key, const size_t length, const bool is_raw)
+{
+    const int32_t key_id = set->slots[get_slot(set, hash_key(key, length, set->seed))];
+    if(key_id == EMPTY_SLOT)
+    {
+        return QJSON_UNKNOWN_KEY;
+    }
+    const key_entry* const entry = &set->keys[key_id];
+    if(entry->length != length || memcmp(entry->key, key, length) != 0 || (is_raw && entry->is_escaped))
+    {
+        return QJSON_UNKNOWN_KEY;
+    }
+    return key_id;
+}
+
+const char* get_key_in_set(const qjson_key_set* const set, const int key_id, size_t* const length)
+{
+    *length = set->keys[key_id].length;
+    return set->keys[key_id].key;
+}
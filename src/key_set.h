@@ -0,0 +1,38 @@
+#ifndef key_set_H
+#define key_set_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "qjson/qjson.h"
+
+// Lookup of map keys in a precompiled key set (see key_set.c).
+
+/**
+ * Look up a key in a key set.
+ *
+ * @param set The key set.
+ * @param key The key, which does not need to be null terminated.
+ * @param length The length of the key in bytes.
+ * @param is_raw true if key holds the raw contents of a JSON string, which can only match keys that read the same
+ *               without unescaping.
+ * @return The key's ID, or QJSON_UNKNOWN_KEY if it is not in the set.
+ */
+int find_key_in_set(const qjson_key_set* set, const char* key, size_t length, bool is_raw);
+
+/**
+ * Get a key from a key set.
+ *
+ * @param set The key set.
+ * @param key_id The ID of the key.
+ * @param length Receives the length of the key.
+ * @return The null terminated key, which lives as long as the set.
+ */
+const char* get_key_in_set(const qjson_key_set* set, int key_id, size_t* length);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // key_set_H
@@ -1,13 +1,62 @@
 #include "qjson/qjson.h"
 #include "qjson_version.h"
+#include "number_formatter.h"
+#include "string_encoder.h"
+#include <math.h>
 #include <memory.h>
+#include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 
 
-static inline bool has_room_for_bytes(qjson_encode_context* context, int byte_count)
+// Hands everything encoded so far to a flush sink, freeing the whole buffer.
+static bool flush_buffer(qjson_encode_context* const context)
 {
-    return context->pos + byte_count <= context->end;
+    if(context->pos > context->start &&
+       !context->sink->flush(context->sink->context, context->start, (size_t)(context->pos - context->start)))
+    {
+        return false;
+    }
+    context->pos = context->start;
+    return true;
+}
+
+// Makes room for byte_count more bytes by flushing or growing the buffer through the context's sink.
+static bool make_room(qjson_encode_context* const context, const size_t byte_count)
+{
+    const qjson_encode_sink* const sink = context->sink;
+    if(sink == NULL)
+    {
+        return false;
+    }
+    if(sink->flush != NULL)
+    {
+        return flush_buffer(context) && (size_t)(context->end - context->pos) >= byte_count;
+    }
+
+    const size_t used = context->pos - context->start;
+    const size_t required_size = used + byte_count;
+    size_t new_size = (size_t)(context->end - context->start) * 2;
+    if(new_size < required_size)
+    {
+        new_size = required_size;
+    }
+    uint8_t* const memory = sink->grow(sink->context, context->start, new_size);
+    if(memory == NULL)
+    {
+        return false;
+    }
+    context->start = memory;
+    context->pos = memory + used;
+    context->end = memory + new_size;
+    return true;
+}
+
+// The longest escape sequence the encoder writes (\\u00XX).
+#define MAX_ESCAPE_LENGTH 6
+
+static inline bool has_room_for_bytes(qjson_encode_context* context, size_t byte_count)
+{
+    return (size_t)(context->end - context->pos) >= byte_count || make_room(context, byte_count);
 }
 
 const char* qjson_version()
@@ -15,27 +64,42 @@ const char* qjson_version()
     return QJSON_VERSION;
 }
 
-qjson_encode_context qjson_new_encode_context_with_config(uint8_t* const memory_start,
-                                                          uint8_t* const memory_end,
-                                                          int indent_spaces,
-                                                          int float_digits_precision)
+qjson_encode_context qjson_new_encode_context_with_sink(uint8_t* const memory_start,
+                                                        uint8_t* const memory_end,
+                                                        int indent_spaces,
+                                                        int float_digits_precision,
+                                                        const qjson_encode_sink* sink)
 {
     qjson_encode_context context =
     {
         .start = memory_start,
         .pos = memory_start,
         .end = memory_end,
+        .sink = sink,
         .indent_spaces = indent_spaces,
         .float_digits_precision = float_digits_precision,
         .container_level = 0,
         .is_first_in_document = true,
         .is_first_in_container = false,
         .next_object_is_map_key = false,
+        .is_container_overflow_allocated = false,
+        .container_bits = 0,
+        .container_overflow = NULL,
+        .container_overflow_word_count = 0,
+        .container_allocator = NULL,
     };
     return context;
 
 }
 
+qjson_encode_context qjson_new_encode_context_with_config(uint8_t* const memory_start,
+                                                          uint8_t* const memory_end,
+                                                          int indent_spaces,
+                                                          int float_digits_precision)
+{
+    return qjson_new_encode_context_with_sink(memory_start, memory_end, indent_spaces, float_digits_precision, NULL);
+}
+
 qjson_encode_context qjson_new_encode_context(uint8_t* const memory_start, uint8_t* const memory_end)
 {
     return qjson_new_encode_context_with_config(memory_start,
@@ -44,6 +108,113 @@ qjson_encode_context qjson_new_encode_context(uint8_t* const memory_start, uint8
                                                 DEFAULT_FLOAT_DIGITS_PRECISION);
 }
 
+void qjson_set_encode_container_storage(qjson_encode_context* const context,
+                                        uint64_t* words,
+                                        size_t word_count,
+                                        const qjson_allocator* allocator)
+{
+    qjson_release_encode_context(context);
+    context->container_overflow = words;
+    context->container_overflow_word_count = words == NULL ? 0 : word_count;
+    context->container_allocator = allocator;
+}
+
+// An allocator without an allocate function stands for malloc and free, as it does for parsers.
+static void* allocate_container_words(const qjson_allocator* const allocator, const size_t size)
+{
+    if(allocator->allocate != NULL)
+    {
+        return allocator->allocate(allocator->context, size);
+    }
+    return malloc(size);
+}
+
+static void free_container_words(const qjson_allocator* const allocator, void* const memory)
+{
+    if(allocator->allocate == NULL)
+    {
+        free(memory);
+    }
+    else if(allocator->free != NULL)
+    {
+        allocator->free(allocator->context, memory);
+    }
+}
+
+void qjson_release_encode_context(qjson_encode_context* const context)
+{
+    if(context->is_container_overflow_allocated)
+    {
+        free_container_words(context->container_allocator, context->container_overflow);
+        context->is_container_overflow_allocated = false;
+    }
+    context->container_overflow = NULL;
+    context->container_overflow_word_count = 0;
+}
+
+// Level 0 is the document itself, and container levels start at 1.
+static bool is_map_at_level(const qjson_encode_context* const context, const int level)
+{
+    if(level <= 0)
+    {
+        return false;
+    }
+    const size_t index = (size_t)level - 1;
+    if(index < QJSON_ENCODE_INLINE_DEPTH)
+    {
+        return (context->container_bits >> index) & 1;
+    }
+    const size_t overflow_index = index - QJSON_ENCODE_INLINE_DEPTH;
+    return (context->container_overflow[overflow_index / 64] >> (overflow_index % 64)) & 1;
+}
+
+static void set_map_at_level(qjson_encode_context* const context, const int level, const bool is_map)
+{
+    const size_t index = (size_t)level - 1;
+    uint64_t* word = &context->container_bits;
+    size_t bit = index;
+    if(index >= QJSON_ENCODE_INLINE_DEPTH)
+    {
+        const size_t overflow_index = index - QJSON_ENCODE_INLINE_DEPTH;
+        word = &context->container_overflow[overflow_index / 64];
+        bit = overflow_index % 64;
+    }
+    *word = (*word & ~((uint64_t)1 << bit)) | ((uint64_t)is_map << bit);
+}
+
+// Makes sure there is a bit for the given level, growing the container storage through its allocator if needed.
+static bool reserve_container_level(qjson_encode_context* const context, const int level)
+{
+    const size_t index = (size_t)level - 1;
+    if(index < QJSON_ENCODE_INLINE_DEPTH ||
+       (index - QJSON_ENCODE_INLINE_DEPTH) / 64 < context->container_overflow_word_count)
+    {
+        return true;
+    }
+
+    const qjson_allocator* const allocator = context->container_allocator;
+    if(allocator == NULL)
+    {
+        return false;
+    }
+    const size_t old_word_count = context->container_overflow_word_count;
+    const size_t new_word_count = old_word_count == 0 ? 1 : old_word_count * 2;
+    uint64_t* const words = allocate_container_words(allocator, new_word_count * sizeof(*words));
+    if(words == NULL)
+    {
+        return false;
+    }
+    if(old_word_count > 0)
+    {
+        memcpy(words, context->container_overflow, old_word_count * sizeof(*words));
+    }
+    qjson_release_encode_context(context);
+    context->container_overflow = words;
+    context->container_overflow_word_count = new_word_count;
+    context->is_container_overflow_allocated = true;
+    return true;
+}
+
 static void add_bytes(qjson_encode_context* const context, const char* bytes, size_t length)
 {
     memcpy(context->pos, bytes, length);
@@ -73,7 +244,7 @@ static bool begin_new_object(qjson_encode_context* const context)
         return true;
     }
 
-    bool is_in_map = context->is_inside_map[context->container_level];
+    bool is_in_map = is_map_at_level(context, context->container_level);
     bool next_object_is_map_key = context->next_object_is_map_key;
 
     if(is_in_map)
@@ -127,22 +298,119 @@ bool qjson_add_boolean(qjson_encode_context* const context, const bool value)
     return add_object(context, value ? "true" : "false");
 }
 
-bool qjson_add_integer(qjson_encode_context* const context, const int64_t value)
+static const char g_digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const uint64_t g_powers_of_10[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+// Counts the decimal digits of value from its bit length, which gives the count to within one.
+static inline int count_decimal_digits(const uint64_t value)
+{
+    // Setting the low bit never carries a value over a power of 10, and gives 0 a bit length of 1.
+    const uint64_t nonzero = value | 1;
+    const int bit_length = 64 - __builtin_clzll(nonzero);
+    const int estimate = (bit_length * 1233) >> 12;
+    return estimate + 1 - (nonzero < g_powers_of_10[estimate]);
+}
+
+// Writes the digit_count digits of value at dst, two at a time from the end.
+static inline void write_decimal_digits(uint8_t* const dst, uint64_t value, const int digit_count)
+{
+    uint8_t* pos = dst + digit_count;
+    while(value >= 100)
+    {
+        const char* const pair = g_digit_pairs + (value % 100) * 2;
+        value /= 100;
+        *--pos = (uint8_t)pair[1];
+        *--pos = (uint8_t)pair[0];
+    }
+    if(value >= 10)
+    {
+        const char* const pair = g_digit_pairs + value * 2;
+        *--pos = (uint8_t)pair[1];
+        *--pos = (uint8_t)pair[0];
+    }
+    else
+    {
+        *--pos = (uint8_t)('0' + value);
+    }
+}
+
+static bool add_decimal(qjson_encode_context* const context, const uint64_t magnitude, const bool is_negative)
 {
     if(context->next_object_is_map_key) return false;
-    char buffer[21];
-    sprintf(buffer, "%ld", value);
-    return add_object(context, buffer);
+    if(!begin_new_object(context)) return false;
+    const int digit_count = count_decimal_digits(magnitude);
+    if(!has_room_for_bytes(context, digit_count + is_negative)) return false;
+    if(is_negative)
+    {
+        *context->pos++ = '-';
+    }
+    write_decimal_digits(context->pos, magnitude, digit_count);
+    context->pos += digit_count;
+    return true;
+}
+
+bool qjson_add_integer(qjson_encode_context* const context, const int64_t value)
+{
+    return add_decimal(context, value < 0 ? 0 - (uint64_t)value : (uint64_t)value, value < 0);
+}
+
+bool qjson_add_uint64(qjson_encode_context* const context, const uint64_t value)
+{
+    return add_decimal(context, value, false);
+}
+
+bool qjson_add_int32(qjson_encode_context* const context, const int32_t value)
+{
+    return qjson_add_integer(context, value);
+}
+
+bool qjson_add_uint32(qjson_encode_context* const context, const uint32_t value)
+{
+    return add_decimal(context, value, false);
+}
+
+static inline int format_double(const double value, const int precision, char* const dst)
+{
+    if(precision <= QJSON_FLOAT_PRECISION_SHORTEST)
+    {
+        return format_double_shortest(value, dst);
+    }
+    return format_double_with_precision(value, precision < MAX_DOUBLE_PRECISION ? precision : MAX_DOUBLE_PRECISION, dst);
 }
 
 bool qjson_add_float(qjson_encode_context* const context, const double value)
 {
     if(context->next_object_is_map_key) return false;
-    char fmt[10];
-    sprintf(fmt, "%%.%dlg", context->float_digits_precision);
-    char buffer[context->float_digits_precision + 2];
-    sprintf(buffer, fmt, value);
-    return add_object(context, buffer);
+    // JSON has no representation for infinities or NaN.
+    if(!isfinite(value)) return false;
+    if(!begin_new_object(context)) return false;
+    if((size_t)(context->end - context->pos) >= MAX_FORMATTED_DOUBLE_LENGTH)
+    {
+        context->pos += format_double(value, context->float_digits_precision, (char*)context->pos);
+        return true;
+    }
+    char buffer[MAX_FORMATTED_DOUBLE_LENGTH];
+    const int length = format_double(value, context->float_digits_precision, buffer);
+    if(!has_room_for_bytes(context, length)) return false;
+    add_bytes(context, buffer, length);
+    return true;
 }
 
 static char get_escape_char(char ch)
@@ -160,33 +428,62 @@ static char get_escape_char(char ch)
     }
 }
 
+// Writes the escape sequence for ch, returning its length.
+static int write_escape(uint8_t* const dst, const char ch)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    dst[0] = '\\';
+    const char escape_ch = get_escape_char(ch);
+    if(escape_ch != 0)
+    {
+        dst[1] = escape_ch;
+        return 2;
+    }
+    dst[1] = 'u';
+    dst[2] = '0';
+    dst[3] = '0';
+    dst[4] = hex_digits[(uint8_t)ch >> 4];
+    dst[5] = hex_digits[ch & 0x0f];
+    return MAX_ESCAPE_LENGTH;
+}
+
+// Adds a run of bytes. A run longer than a flush sink's whole buffer goes straight to the sink.
+static bool add_run(qjson_encode_context* const context, const char* const bytes, const size_t length)
+{
+    const qjson_encode_sink* const sink = context->sink;
+    if((size_t)(context->end - context->pos) < length &&
+       sink != NULL && sink->flush != NULL &&
+       (size_t)(context->end - context->start) < length)
+    {
+        return flush_buffer(context) && sink->flush(sink->context, (const uint8_t*)bytes, length);
+    }
+    if(!has_room_for_bytes(context, length)) return false;
+    add_bytes(context, bytes, length);
+    return true;
+}
+
 static bool add_substring_with_escaping(qjson_encode_context* const context, const char* const start, const char* const end)
 {
-    for(const char* src = start; src < end; src++)
+    const char* src = start;
+    for(;;)
     {
-        char ch = *src;
-        char escape_ch = get_escape_char(ch);
-        if(escape_ch != 0)
-        {
-            if(!has_room_for_bytes(context, 2)) return false;
-            *context->pos++ = '\\';
-            *context->pos++ = escape_ch;
-        }
-        else
+        const char* const run_end = find_byte_to_escape(src, end);
+        if(run_end > src && !add_run(context, src, run_end - src)) return false;
+        if(run_end >= end)
         {
-            if(!has_room_for_bytes(context, 1)) return false;
-            *context->pos++ = ch;
+            return true;
         }
+        if(!has_room_for_bytes(context, MAX_ESCAPE_LENGTH)) return false;
+        context->pos += write_escape(context->pos, *run_end);
+        src = run_end + 1;
     }
-    return true;
 }
 
 bool qjson_add_substring(qjson_encode_context* const context, const char* const start, const char* const end)
 {
-    size_t byte_count = end - start;
     if(!add_object(context, "\"")) return false;
-    if(!has_room_for_bytes(context, byte_count + 1)) return false;
-    add_substring_with_escaping(context, start, end);
+    if(!add_substring_with_escaping(context, start, end)) return false;
+    if(!has_room_for_bytes(context, 1)) return false;
     add_bytes(context, "\"", 1);
     return true;
 }
@@ -199,15 +496,15 @@ bool qjson_add_string(qjson_encode_context* const context, const char* const str
 static bool start_container(qjson_encode_context* const context, bool is_map)
 {
     if(context->next_object_is_map_key) return false;
-    begin_new_object(context);
+    if(!reserve_container_level(context, context->container_level + 1)) return false;
+    if(!begin_new_object(context)) return false;
     if(!has_room_for_bytes(context, 1)) return false;
     add_bytes(context, is_map ? "{" : "[", 1);
     context->container_level++;
     context->is_first_in_container = true;
-    context->is_inside_map[context->container_level] = is_map;
+    set_map_at_level(context, context->container_level, is_map);
     context->next_object_is_map_key = is_map;
     return true;
-
 }
 
 bool qjson_start_list(qjson_encode_context* const context)
@@ -226,7 +523,7 @@ bool qjson_end_container(qjson_encode_context* const context)
     {
         return false;
     }
-    bool is_in_map = context->is_inside_map[context->container_level];
+    bool is_in_map = is_map_at_level(context, context->container_level);
     if(is_in_map && !context->next_object_is_map_key)
     {
         return false;
@@ -236,10 +533,133 @@ bool qjson_end_container(qjson_encode_context* const context)
     if(!add_indentation(context)) return false;
     if(!has_room_for_bytes(context, 1)) return false;
     add_bytes(context, is_in_map ? "}" : "]", 1);
-    context->next_object_is_map_key = context->is_inside_map[context->container_level];
+    context->is_first_in_container = false;
+    context->next_object_is_map_key = is_map_at_level(context, context->container_level);
     return true;
 }
 
+// The length of the newline and indentation before each element of the current container.
+static inline size_t get_indentation_length(const qjson_encode_context* const context)
+{
+    return context->indent_spaces > 0 ? 1 + (size_t)context->indent_spaces * context->container_level : 0;
+}
+
+// Writes what comes before an element of a list: a comma unless it's the first, then the indentation.
+static inline uint8_t* write_list_separator(uint8_t* pos, const bool is_first, const size_t indentation_length)
+{
+    if(!is_first)
+    {
+        *pos++ = ',';
+    }
+    if(indentation_length > 0)
+    {
+        *pos++ = '\n';
+        memset(pos, ' ', indentation_length - 1);
+        pos += indentation_length - 1;
+    }
+    return pos;
+}
+
+// Writes one element of an array to dst, returning its length.
+typedef int (*write_array_element)(const qjson_encode_context* context, const void* elements, size_t index, uint8_t* dst);
+
+// The longest element add_fixed_size_array() can be asked to write.
+#define MAX_ARRAY_ELEMENT_LENGTH MAX_FORMATTED_DOUBLE_LENGTH
+
+// Adds a list of elements that are each at most max_element_length (no more than MAX_ARRAY_ELEMENT_LENGTH) bytes long.
+// Room is checked once for as many elements as are sure to fit, rather than once per element.
+static inline bool add_fixed_size_array(qjson_encode_context* const context,
+                                        const void* const elements,
+                                        const size_t count,
+                                        const size_t max_element_length,
+                                        const write_array_element write_element)
+{
+    if(!start_container(context, false)) return false;
+    const size_t indentation_length = get_indentation_length(context);
+    const size_t max_length = 1 + indentation_length + max_element_length;
+    size_t index = 0;
+    while(index < count)
+    {
+        if((size_t)(context->end - context->pos) < max_length)
+        {
+            // Not even a worst-case element fits, so format the next one aside and check for its actual length,
+            // which is all that adding it on its own would need.
+            uint8_t element[MAX_ARRAY_ELEMENT_LENGTH];
+            const size_t element_length = write_element(context, elements, index, element);
+            if(!has_room_for_bytes(context, (index > 0) + indentation_length + element_length)) return false;
+            context->pos = write_list_separator(context->pos, index == 0, indentation_length);
+            add_bytes(context, (const char*)element, element_length);
+            index++;
+            continue;
+        }
+        size_t batch_end = index + (size_t)(context->end - context->pos) / max_length;
+        if(batch_end > count)
+        {
+            batch_end = count;
+        }
+        uint8_t* pos = context->pos;
+        for(; index < batch_end; index++)
+        {
+            pos = write_list_separator(pos, index == 0, indentation_length);
+            pos += write_element(context, elements, index, pos);
+        }
+        context->pos = pos;
+    }
+    return qjson_end_container(context);
+}
+
+// The longest int64: "-9223372036854775808".
+#define MAX_INT64_LENGTH 20
+
+static int write_int64_element(const qjson_encode_context* const context, const void* const elements, const size_t index, uint8_t* dst)
+{
+    (void)context;
+    const int64_t value = ((const int64_t*)elements)[index];
+    const bool is_negative = value < 0;
+    const uint64_t magnitude = is_negative ? 0 - (uint64_t)value : (uint64_t)value;
+    const int digit_count = count_decimal_digits(magnitude);
+    *dst = '-';
+    write_decimal_digits(dst + is_negative, magnitude, digit_count);
+    return digit_count + is_negative;
+}
+
+static int write_double_element(const qjson_encode_context* const context, const void* const elements, const size_t index, uint8_t* dst)
+{
+    return format_double(((const double*)elements)[index], context->float_digits_precision, (char*)dst);
+}
+
+bool qjson_add_int64_array(qjson_encode_context* const context, const int64_t* const values, const size_t count)
+{
+    return add_fixed_size_array(context, values, count, MAX_INT64_LENGTH, write_int64_element);
+}
+
+bool qjson_add_double_array(qjson_encode_context* const context, const double* const values, const size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        // JSON has no representation for infinities or NaN.
+        if(!isfinite(values[i])) return false;
+    }
+    return add_fixed_size_array(context, values, count, MAX_FORMATTED_DOUBLE_LENGTH, write_double_element);
+}
+
+bool qjson_add_string_array(qjson_encode_context* const context, const char* const* const strings, const size_t count)
+{
+    if(!start_container(context, false)) return false;
+    const size_t indentation_length = get_indentation_length(context);
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!has_room_for_bytes(context, 2 + indentation_length)) return false;
+        context->pos = write_list_separator(context->pos, i == 0, indentation_length);
+        *context->pos++ = '"';
+        const char* const string = strings[i];
+        if(!add_substring_with_escaping(context, string, string + strlen(string))) return false;
+        if(!has_room_for_bytes(context, 1)) return false;
+        add_bytes(context, "\"", 1);
+    }
+    return qjson_end_container(context);
+}
+
 const char* qjson_end_encoding(qjson_encode_context* const context)
 {
     while(context->container_level > 0)
@@ -249,6 +669,7 @@ const char* qjson_end_encoding(qjson_encode_context* const context)
             return NULL;
         }
     }
+    if(context->sink != NULL && context->sink->flush != NULL && !flush_buffer(context)) return NULL;
     if(!has_room_for_bytes(context, 1)) return NULL;
     *context->pos = 0;
     return (const char*)context->pos;
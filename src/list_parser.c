@@ -0,0 +1,350 @@
+#include "json_parser.h"
+#include "structural_index.h"
+#include "value_scanner.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Multi-threaded parsing of the elements of one large top-level list.
+//
+// A splitter walks the structural index of the list (see structural_index.h),
+// which already excludes anything inside strings, and counts bracket depth so
+// that it only cuts at the commas between top-level elements. Each cut yields
+// a chunk of whole elements along with the index of its first element. The
+// last chunk runs on through the closing bracket to the end of the buffer.
+//
+// Splitting is pipelined: cutting the next chunk is itself a task, taken by
+// whichever thread is free, so parsing starts as soon as the first chunk is
+// cut. Threads parse chunks straight into their own callback contexts, so no
+// events are buffered or passed between threads.
+
+#define MIN_CHUNK_SIZE (64 * 1024)
+#define MAX_CHUNK_SIZE (1024 * 1024)
+#define CHUNKS_PER_THREAD 4
+#define SPLIT_WINDOW_SIZE (16 * 1024)
+
+typedef struct
+{
+    size_t offset;
+    size_t length;
+    size_t first_element_index;
+    bool is_list_tail;
+} element_chunk;
+
+typedef struct
+{
+    structural_scanner scanner;
+    uint64_t structurals[SPLIT_WINDOW_SIZE / STRUCTURAL_BLOCK_SIZE];
+    size_t next_window_offset;
+    size_t window_offset;
+    size_t block_count;
+    size_t block_index;
+    uint64_t block_bits;
+    size_t block_offset;
+    size_t depth;
+    // Number of top-level commas seen, which is the index of the element being scanned.
+    size_t element_index;
+    size_t chunk_offset;
+    size_t chunk_first_element_index;
+} list_splitter;
+
+typedef struct
+{
+    const char* data;
+    size_t length;
+    size_t chunk_size;
+    const qjson_parse_callbacks* callbacks;
+    const qjson_document_callbacks* element_callbacks;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    element_chunk* chunks;
+    size_t chunk_count;
+    size_t next_chunk_to_parse;
+    bool is_splitting;
+    bool is_split;
+    bool has_failed;
+    // Only touched by the thread that is splitting.
+    list_splitter splitter;
+} list_session;
+
+typedef struct
+{
+    list_session* session;
+    void* context;
+} list_worker;
+
+static void report_unexpected(const qjson_parse_callbacks* const callbacks,
+                              void* const context,
+                              const char* const data,
+                              const char* const end,
+                              const char* const pos)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    if(pos >= end)
+    {
+        snprintf(buff, sizeof(buff), "Unexpected end of document at offset %zu", (size_t)(end - data));
+    }
+    else
+    {
+        snprintf(buff, sizeof(buff), "Unexpected token: '%c' at offset %zu", *pos, (size_t)(pos - data));
+    }
+    callbacks->on_parse_error(context, buff);
+}
+
+static bool load_next_window(list_splitter* const splitter, const char* const data, const size_t length)
+{
+    const size_t offset = splitter->next_window_offset;
+    if(offset >= length)
+    {
+        return false;
+    }
+    size_t size = length - offset;
+    if(size > SPLIT_WINDOW_SIZE)
+    {
+        size = SPLIT_WINDOW_SIZE;
+    }
+    splitter->block_count = structural_index_window(&splitter->scanner, data + offset, size, splitter->structurals, NULL);
+    splitter->block_index = 0;
+    splitter->window_offset = offset;
+    splitter->next_window_offset = offset + size;
+    return true;
+}
+
+// Cuts the next chunk at the first top-level comma at least chunk_size bytes in.
+// Returns true if this is the last chunk, which runs to the end of the buffer.
+static bool cut_next_chunk(list_splitter* const splitter,
+                           const char* const data,
+                           const size_t length,
+                           const size_t chunk_size,
+                           element_chunk* const chunk)
+{
+    chunk->offset = splitter->chunk_offset;
+    chunk->first_element_index = splitter->chunk_first_element_index;
+    for(;;)
+    {
+        while(splitter->block_bits == 0)
+        {
+            if(splitter->block_index >= splitter->block_count && !load_next_window(splitter, data, length))
+            {
+                goto list_tail;
+            }
+            splitter->block_offset = splitter->window_offset + splitter->block_index * STRUCTURAL_BLOCK_SIZE;
+            splitter->block_bits = splitter->structurals[splitter->block_index++];
+        }
+        const size_t offset = splitter->block_offset + (size_t)__builtin_ctzll(splitter->block_bits);
+        splitter->block_bits &= splitter->block_bits - 1;
+
+        switch(data[offset])
+        {
+            case '[':
+            case '{':
+                splitter->depth++;
+                break;
+            case ']':
+            case '}':
+                if(--splitter->depth == 0)
+                {
+                    goto list_tail;
+                }
+                break;
+            case ',':
+                if(splitter->depth == 1)
+                {
+                    splitter->element_index++;
+                    if(offset - chunk->offset >= chunk_size)
+                    {
+                        chunk->length = offset - chunk->offset;
+                        chunk->is_list_tail = false;
+                        splitter->chunk_offset = offset + 1;
+                        splitter->chunk_first_element_index = splitter->element_index;
+                        return false;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+list_tail:
+    // Whatever follows (including a missing or mismatched bracket) is left to the parser to report.
+    chunk->length = length - chunk->offset;
+    chunk->is_list_tail = true;
+    return true;
+}
+
+static bool parse_chunk(const list_session* const session, const element_chunk* const chunk, void* const context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        session->callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    const bool result = parse_element_sequence(parser,
+                                               session->data + chunk->offset,
+                                               chunk->length,
+                                               chunk->offset,
+                                               chunk->first_element_index,
+                                               chunk->is_list_tail,
+                                               session->callbacks,
+                                               session->element_callbacks,
+                                               context);
+    qjson_release_thread_parser(parser);
+    return result;
+}
+
+static void run_session(list_session* const session, void* const context)
+{
+    pthread_mutex_lock(&session->mutex);
+    while(!session->has_failed)
+    {
+        if(session->next_chunk_to_parse < session->chunk_count)
+        {
+            const element_chunk chunk = session->chunks[session->next_chunk_to_parse++];
+            pthread_mutex_unlock(&session->mutex);
+            const bool is_parsed = parse_chunk(session, &chunk, context);
+            pthread_mutex_lock(&session->mutex);
+            if(!is_parsed)
+            {
+                session->has_failed = true;
+                pthread_cond_broadcast(&session->changed);
+            }
+            continue;
+        }
+        if(session->is_split)
+        {
+            break;
+        }
+
+        if(!session->is_splitting)
+        {
+            session->is_splitting = true;
+            pthread_mutex_unlock(&session->mutex);
+            element_chunk chunk;
+            const bool is_last = cut_next_chunk(&session->splitter, session->data, session->length, session->chunk_size, &chunk);
+            pthread_mutex_lock(&session->mutex);
+            session->chunks[session->chunk_count++] = chunk;
+            session->is_split = is_last;
+            session->is_splitting = false;
+            pthread_cond_broadcast(&session->changed);
+            continue;
+        }
+
+        pthread_cond_wait(&session->changed, &session->mutex);
+    }
+    pthread_mutex_unlock(&session->mutex);
+}
+
+static void* run_worker(void* const worker_ptr)
+{
+    const list_worker* const worker = (const list_worker*)worker_ptr;
+    run_session(worker->session, worker->context);
+    return NULL;
+}
+
+bool qjson_parse_list_elements(const char* const data,
+                               const size_t length,
+                               const qjson_parse_callbacks* const callbacks,
+                               const qjson_document_callbacks* const element_callbacks,
+                               void* const* const thread_contexts,
+                               int thread_count)
+{
+    if(thread_count < 1)
+    {
+        thread_count = 1;
+    }
+    void* const context = thread_contexts[0];
+    const char* const end = data + length;
+    const char* pos = skip_json_whitespace(data, end);
+    if(pos >= end || *pos != '[')
+    {
+        report_unexpected(callbacks, context, data, end, pos);
+        return false;
+    }
+    const size_t list_offset = (size_t)(pos + 1 - data);
+    pos = skip_json_whitespace(pos + 1, end);
+    if(pos < end && *pos == ']')
+    {
+        pos = skip_json_whitespace(pos + 1, end);
+        if(pos < end)
+        {
+            report_unexpected(callbacks, context, data, end, pos);
+            return false;
+        }
+        return true;
+    }
+
+    size_t chunk_size = length / ((size_t)thread_count * CHUNKS_PER_THREAD);
+    if(chunk_size < MIN_CHUNK_SIZE)
+    {
+        chunk_size = MIN_CHUNK_SIZE;
+    }
+    if(chunk_size > MAX_CHUNK_SIZE)
+    {
+        chunk_size = MAX_CHUNK_SIZE;
+    }
+    if(thread_count == 1 || length <= chunk_size)
+    {
+        // No split points are needed, so the list is not pre-scanned.
+        const element_chunk chunk = {list_offset, length - list_offset, 0, true};
+        const list_session session = {.data = data, .callbacks = callbacks, .element_callbacks = element_callbacks};
+        return parse_chunk(&session, &chunk, context);
+    }
+
+    list_session session =
+    {
+        .data = data,
+        .length = length,
+        .chunk_size = chunk_size,
+        .callbacks = callbacks,
+        .element_callbacks = element_callbacks,
+    };
+    structural_scanner_init(&session.splitter.scanner);
+    session.splitter.next_window_offset = list_offset;
+    session.splitter.depth = 1;
+    session.splitter.chunk_offset = list_offset;
+    session.chunks = malloc((length / chunk_size + 1) * sizeof(*session.chunks));
+    pthread_t* const threads = malloc((size_t)(thread_count - 1) * sizeof(*threads));
+    list_worker* const workers = malloc((size_t)(thread_count - 1) * sizeof(*workers));
+
+    bool result = false;
+    if(session.chunks == NULL || threads == NULL || workers == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+    }
+    else
+    {
+        pthread_mutex_init(&session.mutex, NULL);
+        pthread_cond_init(&session.changed, NULL);
+
+        // If some threads cannot be started, the rest of them (and at least the calling thread) do all of the work.
+        int started_count = 0;
+        while(started_count < thread_count - 1)
+        {
+            workers[started_count].session = &session;
+            workers[started_count].context = thread_contexts[started_count + 1];
+            if(pthread_create(&threads[started_count], NULL, run_worker, &workers[started_count]) != 0)
+            {
+                break;
+            }
+            started_count++;
+        }
+        run_session(&session, context);
+        while(started_count > 0)
+        {
+            pthread_join(threads[--started_count], NULL);
+        }
+
+        pthread_cond_destroy(&session.changed);
+        pthread_mutex_destroy(&session.mutex);
+        result = !session.has_failed;
+    }
+
+    free(session.chunks);
+    free(threads);
+    free(workers);
+    return result;
+}
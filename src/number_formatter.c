@@ -0,0 +1,843 @@
+#include "number_formatter.h"
+#include "number_tables.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MANTISSA_EXPLICIT_BITS 52
+#define HIDDEN_BIT ((uint64_t)1 << MANTISSA_EXPLICIT_BITS)
+#define BINARY_EXPONENT_MASK 0x7ff
+// The exponent of a double's lowest mantissa bit is its biased exponent minus this.
+#define EXPONENT_BIAS (1023 + MANTISSA_EXPLICIT_BITS)
+#define CACHED_POWER_MIN_EXPONENT -348
+#define CACHED_POWER_EXPONENT_STEP 8
+// Positional notation is used for shortest forms whose leading digit has a decimal exponent in this range.
+#define MIN_POSITIONAL_EXPONENT -6
+#define MAX_POSITIONAL_EXPONENT 20
+
+// A floating point value as f * 2^e.
+typedef struct
+{
+    uint64_t f;
+    int e;
+} diy_fp;
+
+static const uint64_t g_powers_of_10[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+// 64-bit approximations of 10^k for k = -348, -340, ..., 340, rounded to nearest, as f * 2^e.
+//
+// Generated with:
+//
+//     for k in range(-348, 341, 8):
+//         e = floor(log2(10 ** k)) - 63
+//         f = round(10 ** k / 2 ** e)
+static const struct
+{
+    uint64_t f;
+    int16_t e;
+} g_cached_powers[] =
+{
+    {0xfa8fd5a0081c0288ULL, -1220},
+    {0xbaaee17fa23ebf76ULL, -1193},
+    {0x8b16fb203055ac76ULL, -1166},
+    {0xcf42894a5dce35eaULL, -1140},
+    {0x9a6bb0aa55653b2dULL, -1113},
+    {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060},
+    {0xff77b1fcbebcdc4fULL, -1034},
+    {0xbe5691ef416bd60cULL, -1007},
+    {0x8dd01fad907ffc3cULL, -980},
+    {0xd3515c2831559a83ULL, -954},
+    {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901},
+    {0xaecc49914078536dULL, -874},
+    {0x823c12795db6ce57ULL, -847},
+    {0xc21094364dfb5637ULL, -821},
+    {0x9096ea6f3848984fULL, -794},
+    {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741},
+    {0xef340a98172aace5ULL, -715},
+    {0xb23867fb2a35b28eULL, -688},
+    {0x84c8d4dfd2c63f3bULL, -661},
+    {0xc5dd44271ad3cdbaULL, -635},
+    {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582},
+    {0xa3ab66580d5fdaf6ULL, -555},
+    {0xf3e2f893dec3f126ULL, -529},
+    {0xb5b5ada8aaff80b8ULL, -502},
+    {0x87625f056c7c4a8bULL, -475},
+    {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422},
+    {0xdff9772470297ebdULL, -396},
+    {0xa6dfbd9fb8e5b88fULL, -369},
+    {0xf8a95fcf88747d94ULL, -343},
+    {0xb94470938fa89bcfULL, -316},
+    {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263},
+    {0x993fe2c6d07b7facULL, -236},
+    {0xe45c10c42a2b3b06ULL, -210},
+    {0xaa242499697392d3ULL, -183},
+    {0xfd87b5f28300ca0eULL, -157},
+    {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103},
+    {0xd1b71758e219652cULL, -77},
+    {0x9c40000000000000ULL, -50},
+    {0xe8d4a51000000000ULL, -24},
+    {0xad78ebc5ac620000ULL, 3},
+    {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56},
+    {0x8f7e32ce7bea5c70ULL, 83},
+    {0xd5d238a4abe98068ULL, 109},
+    {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162},
+    {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216},
+    {0xc45d1df942711d9aULL, 242},
+    {0x924d692ca61be758ULL, 269},
+    {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322},
+    {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375},
+    {0x865b86925b9bc5c2ULL, 402},
+    {0xc83553c5c8965d3dULL, 428},
+    {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481},
+    {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534},
+    {0xb7dcbf5354e9beceULL, 561},
+    {0x88fcf317f22241e2ULL, 588},
+    {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641},
+    {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694},
+    {0xfb9b7cd9a4a7443cULL, 720},
+    {0xbb764c4ca7a44410ULL, 747},
+    {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800},
+    {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853},
+    {0xac2820d9623bf429ULL, 880},
+    {0x80444b5e7aa7cf85ULL, 907},
+    {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960},
+    {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013},
+    {0xeb96bf6ebadf77d9ULL, 1039},
+    {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+static inline void full_multiply(const uint64_t a, const uint64_t b, uint64_t* const high, uint64_t* const low)
+{
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 product = (unsigned __int128)a * b;
+    *low = (uint64_t)product;
+    *high = (uint64_t)(product >> 64);
+#else
+    const uint64_t a_low = (uint32_t)a;
+    const uint64_t a_high = a >> 32;
+    const uint64_t b_low = (uint32_t)b;
+    const uint64_t b_high = b >> 32;
+    const uint64_t low_low = a_low * b_low;
+    const uint64_t high_low = a_high * b_low;
+    const uint64_t low_high = a_low * b_high;
+    const uint64_t middle = (low_low >> 32) + (uint32_t)high_low + (uint32_t)low_high;
+    *low = (middle << 32) | (uint32_t)low_low;
+    *high = a_high * b_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32);
+#endif
+}
+
+// floor(log2(10^q)), valid for q in [-1233, 1233].
+static inline int floor_log2_of_power_of_ten(const int q)
+{
+    return ((152170 + 65536) * q) >> 16;
+}
+
+// floor(log10(2^e)), valid for e in [-1650, 1650].
+static inline int floor_log10_of_power_of_two(const int e)
+{
+    return (e * 78913) >> 18;
+}
+
+// Splits a finite, nonzero double (without sign) into mantissa * 2^exponent.
+static inline diy_fp split_double(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const int biased_exponent = (int)((bits >> MANTISSA_EXPLICIT_BITS) & BINARY_EXPONENT_MASK);
+    const uint64_t fraction = bits & (HIDDEN_BIT - 1);
+    if(biased_exponent == 0)
+    {
+        return (diy_fp){fraction, 1 - EXPONENT_BIAS};
+    }
+    return (diy_fp){fraction | HIDDEN_BIT, biased_exponent - EXPONENT_BIAS};
+}
+
+static inline diy_fp normalize(const diy_fp value)
+{
+    const int shift = __builtin_clzll(value.f);
+    return (diy_fp){value.f << shift, value.e - shift};
+}
+
+// Multiplies two values, rounding the product's mantissa to 64 bits.
+static inline diy_fp multiply(const diy_fp a, const diy_fp b)
+{
+    uint64_t high;
+    uint64_t low;
+    full_multiply(a.f, b.f, &high, &low);
+    return (diy_fp){high + (low >> 63), a.e + b.e + 64};
+}
+
+static char* write_digits(char* pos, const char* const digits, const int count)
+{
+    memcpy(pos, digits, count);
+    return pos + count;
+}
+
+static char* write_zeros(char* pos, const int count)
+{
+    memset(pos, '0', count);
+    return pos + count;
+}
+
+// Writes the digits in positional notation, where the first digit has the given decimal exponent.
+static char* write_positional(char* pos, const char* const digits, const int digit_count, const int exponent)
+{
+    if(exponent < 0)
+    {
+        *pos++ = '0';
+        *pos++ = '.';
+        pos = write_zeros(pos, -exponent - 1);
+        return write_digits(pos, digits, digit_count);
+    }
+
+    const int integer_digit_count = exponent + 1;
+    if(digit_count <= integer_digit_count)
+    {
+        pos = write_digits(pos, digits, digit_count);
+        return write_zeros(pos, integer_digit_count - digit_count);
+    }
+    pos = write_digits(pos, digits, integer_digit_count);
+    *pos++ = '.';
+    return write_digits(pos, digits + integer_digit_count, digit_count - integer_digit_count);
+}
+
+// Writes the digits in exponential notation, where the first digit has the given decimal exponent.
+// The exponent is written with at least min_exponent_digits digits.
+static char* write_exponential(char* pos,
+                               const char* const digits,
+                               const int digit_count,
+                               const int exponent,
+                               const int min_exponent_digits)
+{
+    *pos++ = digits[0];
+    if(digit_count > 1)
+    {
+        *pos++ = '.';
+        pos = write_digits(pos, digits + 1, digit_count - 1);
+    }
+    *pos++ = 'e';
+    *pos++ = exponent < 0 ? '-' : '+';
+    int magnitude = exponent < 0 ? -exponent : exponent;
+    if(magnitude >= 100)
+    {
+        *pos++ = (char)('0' + magnitude / 100);
+        magnitude %= 100;
+        *pos++ = (char)('0' + magnitude / 10);
+    }
+    else if(magnitude >= 10 || min_exponent_digits >= 2)
+    {
+        *pos++ = (char)('0' + magnitude / 10);
+    }
+    *pos++ = (char)('0' + magnitude % 10);
+    return pos;
+}
+
+
+// ------
+// Grisu3
+// ------
+
+// Finds the boundaries of the interval of values that round to value, normalized to the upper boundary's exponent.
+static void get_boundaries(const diy_fp value, diy_fp* const lower, diy_fp* const upper)
+{
+    *upper = normalize((diy_fp){(value.f << 1) + 1, value.e - 1});
+    // The gap below a power of two is half the gap above it.
+    diy_fp boundary = value.f == HIDDEN_BIT ? (diy_fp){(value.f << 2) - 1, value.e - 2}
+                                            : (diy_fp){(value.f << 1) - 1, value.e - 1};
+    boundary.f <<= boundary.e - upper->e;
+    boundary.e = upper->e;
+    *lower = boundary;
+}
+
+// Finds the cached power 10^-k that brings a value with binary exponent e into the range [2^-60, 2^-32).
+static diy_fp get_cached_power(const int e, int* const k)
+{
+    // Kept positive so that truncation rounds down.
+    const double estimate = (-61 - e) * 0.30102999566398114 + 347;
+    int power = (int)estimate;
+    if(estimate - power > 0.0)
+    {
+        power++;
+    }
+    const int index = (power >> 3) + 1;
+    *k = -(CACHED_POWER_MIN_EXPONENT + index * CACHED_POWER_EXPONENT_STEP);
+    return (diy_fp){g_cached_powers[index].f, g_cached_powers[index].e};
+}
+
+static inline int count_digits_32(const uint32_t value)
+{
+    int count = 1;
+    while(count < 10 && value >= g_powers_of_10[count])
+    {
+        count++;
+    }
+    return count;
+}
+
+// Divides integral by 10^(digit_count - 1), leaving the remainder in integral and returning the leading digit.
+static inline uint32_t take_leading_digit(uint32_t* const integral, const int digit_count)
+{
+    uint32_t digit;
+    switch(digit_count)
+    {
+        case 10: digit = *integral / 1000000000; *integral %= 1000000000; break;
+        case  9: digit = *integral /  100000000; *integral %=  100000000; break;
+        case  8: digit = *integral /   10000000; *integral %=   10000000; break;
+        case  7: digit = *integral /    1000000; *integral %=    1000000; break;
+        case  6: digit = *integral /     100000; *integral %=     100000; break;
+        case  5: digit = *integral /      10000; *integral %=      10000; break;
+        case  4: digit = *integral /       1000; *integral %=       1000; break;
+        case  3: digit = *integral /        100; *integral %=        100; break;
+        case  2: digit = *integral /         10; *integral %=         10; break;
+        default: digit = *integral;              *integral = 0;            break;
+    }
+    return digit;
+}
+
+// Moves the last digit down for as long as that brings the digits closer to the value, then checks that
+// the digits are sure to be inside the interval and the closest, even though every scaled value is only
+// known to within unit. Returns false if they are not.
+static bool round_weed(char* const digits,
+                       const int digit_count,
+                       const uint64_t distance_to_upper,
+                       const uint64_t unsafe_interval,
+                       uint64_t rest,
+                       const uint64_t ten_kappa,
+                       const uint64_t unit)
+{
+    const uint64_t small_distance = distance_to_upper - unit;
+    const uint64_t big_distance = distance_to_upper + unit;
+    while(rest < small_distance &&
+          unsafe_interval - rest >= ten_kappa &&
+          (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance))
+    {
+        digits[digit_count - 1]--;
+        rest += ten_kappa;
+    }
+    // Moving down once more might be closer to some value within unit of the real one.
+    if(rest < big_distance &&
+       unsafe_interval - rest >= ten_kappa &&
+       (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance))
+    {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// Generates the fewest digits that land inside the interval (lower, upper) of scaled values, whose ends are only
+// known to within one unit. Returns false if that leaves it in doubt whether the digits are the shortest and closest.
+static bool generate_digits(const diy_fp lower,
+                            const diy_fp value,
+                            const diy_fp upper,
+                            char* const digits,
+                            int* const digit_count,
+                            int* const k)
+{
+    uint64_t unit = 1;
+    // Outside of this interval is certain to read back as another double.
+    const uint64_t too_high = upper.f + unit;
+    uint64_t unsafe_interval = too_high - (lower.f - unit);
+    const int shift = -value.e;
+    const uint64_t one = (uint64_t)1 << shift;
+    uint32_t integral = (uint32_t)(too_high >> shift);
+    uint64_t fractional = too_high & (one - 1);
+    int kappa = count_digits_32(integral);
+    int count = 0;
+
+    while(kappa > 0)
+    {
+        digits[count++] = (char)('0' + take_leading_digit(&integral, kappa));
+        kappa--;
+        const uint64_t rest = ((uint64_t)integral << shift) + fractional;
+        if(rest < unsafe_interval)
+        {
+            *digit_count = count;
+            *k += kappa;
+            return round_weed(digits, count, too_high - value.f, unsafe_interval, rest, g_powers_of_10[kappa] << shift, unit);
+        }
+    }
+
+    for(;;)
+    {
+        fractional *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[count++] = (char)('0' + (fractional >> shift));
+        fractional &= one - 1;
+        kappa--;
+        if(fractional < unsafe_interval)
+        {
+            *digit_count = count;
+            *k += kappa;
+            return round_weed(digits, count, (too_high - value.f) * unit, unsafe_interval, fractional, one, unit);
+        }
+    }
+}
+
+// Finds the shortest digits that read back as value (finite, positive), such that value = digits * 10^k.
+// Returns false for the few values whose digits cannot be settled with 64-bit precision.
+static bool grisu3(const double value, char* const digits, int* const digit_count, int* const k)
+{
+    const diy_fp split = split_double(value);
+    diy_fp lower;
+    diy_fp upper;
+    get_boundaries(split, &lower, &upper);
+
+    const diy_fp cached_power = get_cached_power(upper.e, k);
+    const diy_fp scaled = multiply(normalize(split), cached_power);
+    const diy_fp scaled_upper = multiply(upper, cached_power);
+    const diy_fp scaled_lower = multiply(lower, cached_power);
+    return generate_digits(scaled_lower, scaled, scaled_upper, digits, digit_count, k);
+}
+
+
+// -----
+// Exact
+// -----
+
+// The values that the fast paths cannot settle are written exactly, as the ratio of two big integers
+// from which the digits are taken by long division (Steele & White, "How to Print Floating-Point Numbers
+// Accurately", 1990).
+
+// Enough for the largest numerator: a 55-bit mantissa times 10^325, times 10 for the next digit.
+#define BIGNUM_BLOCK_COUNT 40
+
+typedef struct
+{
+    uint32_t blocks[BIGNUM_BLOCK_COUNT];
+    int block_count;
+} bignum;
+
+static void bignum_set(bignum* const number, const uint64_t value)
+{
+    number->blocks[0] = (uint32_t)value;
+    number->blocks[1] = (uint32_t)(value >> 32);
+    number->block_count = value > UINT32_MAX ? 2 : value != 0;
+}
+
+static void bignum_multiply(bignum* const number, const uint32_t factor)
+{
+    uint64_t carry = 0;
+    for(int i = 0; i < number->block_count; i++)
+    {
+        const uint64_t product = (uint64_t)number->blocks[i] * factor + carry;
+        number->blocks[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    if(carry != 0)
+    {
+        number->blocks[number->block_count++] = (uint32_t)carry;
+    }
+}
+
+static void bignum_multiply_by_power_of_10(bignum* const number, int exponent)
+{
+    for(; exponent >= 9; exponent -= 9)
+    {
+        bignum_multiply(number, 1000000000);
+    }
+    if(exponent > 0)
+    {
+        bignum_multiply(number, (uint32_t)g_powers_of_10[exponent]);
+    }
+}
+
+static void bignum_shift_left(bignum* const number, const int shift)
+{
+    if(number->block_count == 0)
+    {
+        return;
+    }
+    const int block_shift = shift / 32;
+    const int bit_shift = shift % 32;
+    if(bit_shift != 0)
+    {
+        const int count = number->block_count;
+        number->blocks[count] = 0;
+        for(int i = count; i > 0; i--)
+        {
+            number->blocks[i] = (number->blocks[i] << bit_shift) | (number->blocks[i - 1] >> (32 - bit_shift));
+        }
+        number->blocks[0] <<= bit_shift;
+        if(number->blocks[count] != 0)
+        {
+            number->block_count++;
+        }
+    }
+    if(block_shift != 0)
+    {
+        memmove(number->blocks + block_shift, number->blocks, number->block_count * sizeof(*number->blocks));
+        memset(number->blocks, 0, block_shift * sizeof(*number->blocks));
+        number->block_count += block_shift;
+    }
+}
+
+static int bignum_compare(const bignum* const a, const bignum* const b)
+{
+    if(a->block_count != b->block_count)
+    {
+        return a->block_count < b->block_count ? -1 : 1;
+    }
+    for(int i = a->block_count - 1; i >= 0; i--)
+    {
+        if(a->blocks[i] != b->blocks[i])
+        {
+            return a->blocks[i] < b->blocks[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// Compares a + b with c.
+static int bignum_compare_sum(const bignum* const a, const bignum* const b, const bignum* const c)
+{
+    bignum sum;
+    const int count = a->block_count > b->block_count ? a->block_count : b->block_count;
+    uint64_t carry = 0;
+    for(int i = 0; i < count; i++)
+    {
+        carry += (uint64_t)(i < a->block_count ? a->blocks[i] : 0) + (i < b->block_count ? b->blocks[i] : 0);
+        sum.blocks[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    sum.block_count = count;
+    if(carry != 0)
+    {
+        sum.blocks[sum.block_count++] = (uint32_t)carry;
+    }
+    return bignum_compare(&sum, c);
+}
+
+// Subtracts b from a, which must be at least b.
+static void bignum_subtract(bignum* const a, const bignum* const b)
+{
+    int64_t borrow = 0;
+    for(int i = 0; i < a->block_count; i++)
+    {
+        borrow += (int64_t)a->blocks[i] - (i < b->block_count ? b->blocks[i] : 0);
+        a->blocks[i] = (uint32_t)borrow;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    while(a->block_count > 0 && a->blocks[a->block_count - 1] == 0)
+    {
+        a->block_count--;
+    }
+}
+
+// Divides numerator by denominator, which must give less than 10, leaving the remainder in numerator.
+static int bignum_take_digit(bignum* const numerator, const bignum* const denominator)
+{
+    int digit = 0;
+    while(bignum_compare(numerator, denominator) >= 0)
+    {
+        bignum_subtract(numerator, denominator);
+        digit++;
+    }
+    return digit;
+}
+
+// Sets numerator / denominator to value (finite, positive) / 10^exponent, where exponent is the decimal exponent
+// of value's leading digit, or one below it. The numerator is first scaled by 2^numerator_shift.
+static int set_up_ratio(const diy_fp split, const int numerator_shift, bignum* const numerator, bignum* const denominator)
+{
+    bignum_set(numerator, split.f);
+    bignum_set(denominator, 1);
+    bignum_shift_left(numerator, numerator_shift + (split.e > 0 ? split.e : 0));
+    bignum_shift_left(denominator, split.e < 0 ? -split.e : 0);
+    const int exponent = floor_log10_of_power_of_two(split.e + 63 - __builtin_clzll(split.f));
+    if(exponent > 0)
+    {
+        bignum_multiply_by_power_of_10(denominator, exponent);
+    }
+    else
+    {
+        bignum_multiply_by_power_of_10(numerator, -exponent);
+    }
+    return exponent;
+}
+
+// Finds the shortest digits that read back as value (finite, positive), such that value = digits * 10^k,
+// choosing the closest when several are as short. Returns the number of digits.
+static int exact_shortest(const double value, char* const digits, int* const k)
+{
+    const diy_fp split = split_double(value);
+    // Digits on a boundary read back as value if its mantissa is even, since reading rounds ties to even.
+    const bool is_even = (split.f & 1) == 0;
+    // The gap below a power of two is half the gap above it.
+    const bool is_lower_closer = split.f == HIDDEN_BIT && split.e > 1 - EXPONENT_BIAS;
+
+    // r / s is the value, and m_plus / s and m_minus / s are the distances to its boundaries, all scaled
+    // by 2 (or 4) to keep them whole. The value is taken one decimal place further than set_up_ratio leaves it.
+    bignum r;
+    bignum s;
+    int exponent = set_up_ratio(split, is_lower_closer ? 2 : 1, &r, &s) + 1;
+    bignum_shift_left(&s, is_lower_closer ? 2 : 1);
+    bignum_multiply(&s, 10);
+    bignum m_plus;
+    bignum m_minus;
+    bignum_set(&m_plus, is_lower_closer ? 2 : 1);
+    bignum_set(&m_minus, 1);
+    bignum_shift_left(&m_plus, split.e > 0 ? split.e : 0);
+    bignum_shift_left(&m_minus, split.e > 0 ? split.e : 0);
+    if(exponent < 1)
+    {
+        bignum_multiply_by_power_of_10(&m_plus, 1 - exponent);
+        bignum_multiply_by_power_of_10(&m_minus, 1 - exponent);
+    }
+
+    // Make sure the upper boundary is below 1, so that the first digit cannot reach 10.
+    for(;;)
+    {
+        const int comparison = bignum_compare_sum(&r, &m_plus, &s);
+        if(comparison < 0 || (comparison == 0 && !is_even))
+        {
+            break;
+        }
+        bignum_multiply(&s, 10);
+        exponent++;
+    }
+
+    int digit_count = 0;
+    for(;;)
+    {
+        bignum_multiply(&r, 10);
+        bignum_multiply(&m_plus, 10);
+        bignum_multiply(&m_minus, 10);
+        int digit = bignum_take_digit(&r, &s);
+        const int low_comparison = bignum_compare(&r, &m_minus);
+        const int high_comparison = bignum_compare_sum(&r, &m_plus, &s);
+        const bool is_low_inside = is_even ? low_comparison <= 0 : low_comparison < 0;
+        const bool is_high_inside = is_even ? high_comparison >= 0 : high_comparison > 0;
+        if(is_low_inside && is_high_inside)
+        {
+            bignum_shift_left(&r, 1);
+            const int comparison = bignum_compare(&r, &s);
+            digit += comparison > 0 || (comparison == 0 && digit % 2 != 0);
+        }
+        else if(is_high_inside)
+        {
+            digit++;
+        }
+        digits[digit_count++] = (char)('0' + digit);
+        if(is_low_inside || is_high_inside)
+        {
+            break;
+        }
+    }
+    *k = exponent - digit_count;
+    return digit_count;
+}
+
+// Writes value (finite, positive) rounded to precision significant digits, rounding exact ties to even
+// as printf does. Returns the decimal exponent of the leading digit.
+static int exact_with_precision(const double value, const int precision, char* const digits)
+{
+    const diy_fp split = split_double(value);
+    bignum r;
+    bignum s;
+    int exponent = set_up_ratio(split, 0, &r, &s);
+    bignum ten_s = s;
+    bignum_multiply(&ten_s, 10);
+    if(bignum_compare(&r, &ten_s) >= 0)
+    {
+        s = ten_s;
+        exponent++;
+    }
+
+    for(int i = 0; i < precision; i++)
+    {
+        if(i > 0)
+        {
+            bignum_multiply(&r, 10);
+        }
+        digits[i] = (char)('0' + bignum_take_digit(&r, &s));
+    }
+
+    bignum_shift_left(&r, 1);
+    const int comparison = bignum_compare(&r, &s);
+    if(comparison > 0 || (comparison == 0 && (digits[precision - 1] - '0') % 2 != 0))
+    {
+        int i = precision - 1;
+        while(i >= 0 && digits[i] == '9')
+        {
+            digits[i--] = '0';
+        }
+        if(i < 0)
+        {
+            digits[0] = '1';
+            exponent++;
+        }
+        else
+        {
+            digits[i]++;
+        }
+    }
+    return exponent;
+}
+
+
+// --------
+// Shortest
+// --------
+
+int format_double_shortest(const double value, char* const dst)
+{
+    char* pos = dst;
+    if(signbit(value))
+    {
+        *pos++ = '-';
+    }
+    if(value == 0)
+    {
+        *pos++ = '0';
+        return (int)(pos - dst);
+    }
+
+    char digits[MAX_DOUBLE_PRECISION + 3];
+    int digit_count = 0;
+    int k = 0;
+    if(!grisu3(fabs(value), digits, &digit_count, &k))
+    {
+        digit_count = exact_shortest(fabs(value), digits, &k);
+    }
+    const int exponent = digit_count + k - 1;
+    if(exponent >= MIN_POSITIONAL_EXPONENT && exponent <= MAX_POSITIONAL_EXPONENT)
+    {
+        pos = write_positional(pos, digits, digit_count, exponent);
+    }
+    else
+    {
+        pos = write_exponential(pos, digits, digit_count, exponent, 1);
+    }
+    return (int)(pos - dst);
+}
+
+
+// ---------------
+// Fixed precision
+// ---------------
+
+// Rounds mantissa * 2^exponent * 10^q to the nearest integer, which must fit in 64 bits.
+// Returns false if the product is too close to a rounding tie to decide with the table's precision.
+static bool scale_and_round(const uint64_t mantissa, const int exponent, const int q, uint64_t* const result)
+{
+    // The table holds 10^q * 2^(127 - floor(log2(10^q))) to within one unit, so the top 128 bits of the
+    // product with the table entry hold the result * 2^shift, to within two units.
+    const uint64_t* const power = g_power_of_five_128[q - NUMBER_TABLE_MIN_POWER];
+    uint64_t high;
+    uint64_t low;
+    uint64_t second_high;
+    uint64_t second_low;
+    full_multiply(mantissa, power[0], &high, &low);
+    full_multiply(mantissa, power[1], &second_high, &second_low);
+    low += second_high;
+    high += low < second_high;
+
+    const int shift = 63 - exponent - floor_log2_of_power_of_ten(q);
+    const int high_shift = shift - 64;
+    if(high_shift < 1 || high_shift > 63)
+    {
+        return false;
+    }
+    const uint64_t remainder = high & (((uint64_t)1 << high_shift) - 1);
+    const uint64_t half = (uint64_t)1 << (high_shift - 1);
+    if((remainder == half && low <= 2) || (remainder + 1 == half && low >= UINT64_MAX - 2))
+    {
+        return false;
+    }
+    *result = (high >> high_shift) + (remainder > half || (remainder == half && low > 2));
+    return true;
+}
+
+// Writes value (finite, positive) rounded to precision significant digits using the power table.
+// Returns false if the table cannot settle the rounding; otherwise sets the decimal exponent of the leading digit.
+static bool table_with_precision(const double value, const int precision, char* const digits, int* const exponent)
+{
+    const diy_fp split = normalize(split_double(value));
+    // This is at most one below the decimal exponent of the leading digit, which the loop corrects.
+    *exponent = floor_log10_of_power_of_two(split.e + 63);
+    uint64_t significand;
+    for(;;)
+    {
+        const int q = precision - 1 - *exponent;
+        if(q < NUMBER_TABLE_MIN_POWER || q > NUMBER_TABLE_MAX_POWER || !scale_and_round(split.f, split.e, q, &significand))
+        {
+            return false;
+        }
+        if(significand < g_powers_of_10[precision])
+        {
+            break;
+        }
+        (*exponent)++;
+    }
+
+    for(int i = precision - 1; i >= 0; i--)
+    {
+        digits[i] = (char)('0' + significand % 10);
+        significand /= 10;
+    }
+    return true;
+}
+
+int format_double_with_precision(const double value, const int precision, char* const dst)
+{
+    char* pos = dst;
+    if(signbit(value))
+    {
+        *pos++ = '-';
+    }
+    if(value == 0)
+    {
+        *pos++ = '0';
+        return (int)(pos - dst);
+    }
+
+    char digits[MAX_DOUBLE_PRECISION];
+    int exponent;
+    if(!table_with_precision(fabs(value), precision, digits, &exponent))
+    {
+        exponent = exact_with_precision(fabs(value), precision, digits);
+    }
+    int digit_count = precision;
+    while(digit_count > 1 && digits[digit_count - 1] == '0')
+    {
+        digit_count--;
+    }
+
+    if(exponent < -4 || exponent >= precision)
+    {
+        pos = write_exponential(pos, digits, digit_count, exponent, 2);
+    }
+    else
+    {
+        pos = write_positional(pos, digits, digit_count, exponent);
+    }
+    return (int)(pos - dst);
+}
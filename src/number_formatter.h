@@ -0,0 +1,52 @@
+#ifndef number_formatter_H
+#define number_formatter_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Locale-independent double formatting for the encoder.
+//
+// The shortest form that reads back as the same double is found with Grisu3
+// (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers", 2010), which detects the rare values it cannot settle with
+// 64-bit arithmetic. A fixed number of significant digits is produced by
+// scaling the double with the 128-bit power-of-five table that the number
+// parser uses, and rounding once. Whatever either fast path cannot settle
+// (values too close to a rounding tie, or too small for the table) is
+// written exactly with big-integer arithmetic, so printf is never involved.
+
+// Enough for any double written by either function, including the sign and the exponent.
+#define MAX_FORMATTED_DOUBLE_LENGTH 32
+
+// The most significant digits format_double_with_precision() writes. 17 digits always read back as the same double.
+#define MAX_DOUBLE_PRECISION 17
+
+/**
+ * Write the shortest decimal form of a finite double that reads back as the same double,
+ * picking the closest to the double where several are as short.
+ * The layout is that of JavaScript's Number.prototype.toString(): positional notation
+ * from 1e-6 up to 1e21, and exponential notation ("1.5e+21") outside of it.
+ *
+ * @param value The value to write. Must be finite.
+ * @param dst Receives the text, which is not null terminated. Must have room for MAX_FORMATTED_DOUBLE_LENGTH bytes.
+ * @return The number of bytes written.
+ */
+int format_double_shortest(double value, char* dst);
+
+/**
+ * Write a finite double rounded to a number of significant digits, laid out as printf's "%.*g" does.
+ * Rounding matches printf's as well, with exact ties going to even, but the locale is never consulted.
+ *
+ * @param value The value to write. Must be finite.
+ * @param precision The number of significant digits, in [1, MAX_DOUBLE_PRECISION].
+ * @param dst Receives the text, which is not null terminated. Must have room for MAX_FORMATTED_DOUBLE_LENGTH bytes.
+ * @return The number of bytes written.
+ */
+int format_double_with_precision(double value, int precision, char* dst);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // number_formatter_H
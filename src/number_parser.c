@@ -0,0 +1,694 @@
+#include "number_parser.h"
+#include "qjson/qjson.h"
+#include "number_tables.h"
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
+
+// Float conversion follows "Number Parsing at a Gigabyte per Second"
+// (Lemire, 2021). The 128-bit power-of-five table is sufficient for every
+// 19-digit mantissa (Mushtak & Lemire, 2023), so Eisel-Lemire never needs a
+// fallback of its own. Only a truncated mantissa can leave the result
+// undecided, which is resolved by comparing the full decimal against the
+// halfway point between the two candidates.
+
+#define MAX_MANTISSA_DIGITS 19
+#define MANTISSA_EXPLICIT_BITS 52
+#define MINIMUM_BINARY_EXPONENT -1023
+#define INFINITE_BINARY_POWER 0x7ff
+#define MAX_EXACT_POWER_OF_TEN 22
+#define MIN_ROUND_TO_EVEN_POWER -4
+#define MAX_ROUND_TO_EVEN_POWER 23
+#define SIGN_BIT ((uint64_t)1 << 63)
+#define HIDDEN_BIT ((uint64_t)1 << MANTISSA_EXPLICIT_BITS)
+#define INFINITY_BITS ((uint64_t)INFINITE_BINARY_POWER << MANTISSA_EXPLICIT_BITS)
+// Clamp for exponents so large that the result is already known to be zero or infinity.
+#define MAX_EXPLICIT_EXPONENT 0x10000
+
+// A halfway point between two doubles has at most 767 significant digits,
+// so any digits past this many only matter as "something nonzero follows".
+#define MAX_DECIMAL_DIGITS 800
+// Enough for both sides of the halfway comparison (at most about 2700 bits).
+#define BIGNUM_LIMBS 128
+
+static const double g_exact_powers_of_ten[MAX_EXACT_POWER_OF_TEN + 1] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const uint32_t g_small_powers_of_ten[10] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+static const uint32_t g_small_powers_of_five[14] =
+{
+    1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125,
+    9765625, 48828125, 244140625, 1220703125,
+};
+
+static inline bool is_digit(char ch)
+{
+    return (unsigned)(ch - '0') <= 9;
+}
+
+static inline number_status number_failed(json_number* const number, const char* const pos, const number_status status)
+{
+    number->end = pos;
+    number->is_float = false;
+    number->has_fraction = false;
+    number->has_exponent = false;
+    number->int_value = 0;
+    number->float_value = 0;
+    return status;
+}
+
+
+// ------
+// Digits
+// ------
+
+static inline uint64_t load_eight_bytes(const char* const pos)
+{
+    uint64_t value;
+    memcpy(&value, pos, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static inline bool is_eight_digits(const uint64_t value)
+{
+    return ((value & 0xf0f0f0f0f0f0f0f0ULL) |
+            (((value + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+// Converts eight ASCII digits (first digit in the lowest byte) in three multiplies.
+static inline uint32_t eight_digits_value(uint64_t value)
+{
+    const uint64_t mask = 0x000000ff000000ffULL;
+    const uint64_t multiplier1 = 100 + (1000000ULL << 32);
+    const uint64_t multiplier2 = 1 + (10000ULL << 32);
+    value -= 0x3030303030303030ULL;
+    value = value * 10 + (value >> 8);
+    return (uint32_t)((((value & mask) * multiplier1) + (((value >> 16) & mask) * multiplier2)) >> 32);
+}
+
+// Accumulates the run of digits at pos into *value, wrapping on overflow.
+// Returns a pointer past the last digit.
+static inline const char* accumulate_digits(const char* pos, const char* const end, uint64_t* const value)
+{
+    uint64_t accumulator = *value;
+    while(end - pos >= 8)
+    {
+        const uint64_t chunk = load_eight_bytes(pos);
+        if(!is_eight_digits(chunk))
+        {
+            break;
+        }
+        accumulator = accumulator * 100000000 + eight_digits_value(chunk);
+        pos += 8;
+    }
+    while(pos < end && is_digit(*pos))
+    {
+        accumulator = accumulator * 10 + (uint64_t)(*pos - '0');
+        pos++;
+    }
+    *value = accumulator;
+    return pos;
+}
+
+
+// ------------
+// Eisel-Lemire
+// ------------
+
+static inline void full_multiply(const uint64_t a, const uint64_t b, uint64_t* const high, uint64_t* const low)
+{
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 product = (unsigned __int128)a * b;
+    *low = (uint64_t)product;
+    *high = (uint64_t)(product >> 64);
+#else
+    const uint64_t a_low = (uint32_t)a;
+    const uint64_t a_high = a >> 32;
+    const uint64_t b_low = (uint32_t)b;
+    const uint64_t b_high = b >> 32;
+    const uint64_t low_low = a_low * b_low;
+    const uint64_t high_low = a_high * b_low;
+    const uint64_t low_high = a_low * b_high;
+    const uint64_t middle = (low_low >> 32) + (uint32_t)high_low + (uint32_t)low_high;
+    *low = (middle << 32) | (uint32_t)low_low;
+    *high = a_high * b_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32);
+#endif
+}
+
+static inline int count_leading_zeros(const uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    for(uint64_t bit = SIGN_BIT; (value & bit) == 0; bit >>= 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// floor(log2(10^q)) + 63, valid for q in [-1233, 1233].
+static inline int32_t binary_exponent_of_power_of_ten(const int32_t q)
+{
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+// Computes the correctly rounded double (without sign) of w * 10^q.
+// Returns the IEEE 754 bit pattern.
+static uint64_t eisel_lemire(const int64_t q, uint64_t w)
+{
+    if(w == 0 || q < NUMBER_TABLE_MIN_POWER)
+    {
+        return 0;
+    }
+    if(q > NUMBER_TABLE_MAX_POWER)
+    {
+        return INFINITY_BITS;
+    }
+
+    const int leading_zeros = count_leading_zeros(w);
+    w <<= leading_zeros;
+
+    const uint64_t* const power = g_power_of_five_128[q - NUMBER_TABLE_MIN_POWER];
+    uint64_t high;
+    uint64_t low;
+    full_multiply(w, power[0], &high, &low);
+    const uint64_t precision_mask = UINT64_MAX >> (MANTISSA_EXPLICIT_BITS + 3);
+    if((high & precision_mask) == precision_mask)
+    {
+        // The truncated product might be off by one in the bits that matter; refine with the low half.
+        uint64_t second_high;
+        uint64_t second_low;
+        full_multiply(w, power[1], &second_high, &second_low);
+        low += second_high;
+        if(second_high > low)
+        {
+            high++;
+        }
+    }
+
+    const int upper_bit = (int)(high >> 63);
+    const int shift = upper_bit + 64 - MANTISSA_EXPLICIT_BITS - 3;
+    uint64_t mantissa = high >> shift;
+    int32_t power2 = binary_exponent_of_power_of_ten((int32_t)q) + upper_bit - leading_zeros - MINIMUM_BINARY_EXPONENT;
+
+    if(power2 <= 0)
+    {
+        // Subnormal
+        if(-power2 + 1 >= 64)
+        {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        // Rounding up may carry into the smallest normal exponent, which the OR below takes care of.
+        power2 = mantissa < HIDDEN_BIT ? 0 : 1;
+        return mantissa | ((uint64_t)power2 << MANTISSA_EXPLICIT_BITS);
+    }
+
+    // An exact halfway case rounds to even rather than up.
+    if(low <= 1 &&
+       q >= MIN_ROUND_TO_EVEN_POWER &&
+       q <= MAX_ROUND_TO_EVEN_POWER &&
+       (mantissa & 3) == 1 &&
+       (mantissa << shift) == high)
+    {
+        mantissa &= ~(uint64_t)1;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (HIDDEN_BIT << 1))
+    {
+        mantissa = HIDDEN_BIT;
+        power2++;
+    }
+    mantissa &= ~HIDDEN_BIT;
+    if(power2 >= INFINITE_BINARY_POWER)
+    {
+        return INFINITY_BITS;
+    }
+    return mantissa | ((uint64_t)power2 << MANTISSA_EXPLICIT_BITS);
+}
+
+
+// ------------------
+// Big decimal compare
+// ------------------
+
+typedef struct
+{
+    uint32_t limbs[BIGNUM_LIMBS];
+    size_t count;
+} bignum;
+
+static void bignum_init(bignum* const number, const uint64_t value)
+{
+    number->limbs[0] = (uint32_t)value;
+    number->limbs[1] = (uint32_t)(value >> 32);
+    number->count = number->limbs[1] != 0 ? 2 : number->limbs[0] != 0 ? 1 : 0;
+}
+
+static void bignum_multiply_add(bignum* const number, const uint32_t multiplier, const uint32_t addend)
+{
+    uint64_t carry = addend;
+    for(size_t i = 0; i < number->count; i++)
+    {
+        const uint64_t product = (uint64_t)number->limbs[i] * multiplier + carry;
+        number->limbs[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    if(carry != 0)
+    {
+        number->limbs[number->count++] = (uint32_t)carry;
+    }
+}
+
+static void bignum_multiply_power_of_five(bignum* const number, int64_t exponent)
+{
+    for(; exponent >= 13; exponent -= 13)
+    {
+        bignum_multiply_add(number, g_small_powers_of_five[13], 0);
+    }
+    if(exponent > 0)
+    {
+        bignum_multiply_add(number, g_small_powers_of_five[exponent], 0);
+    }
+}
+
+static void bignum_shift_left(bignum* const number, const int64_t bits)
+{
+    if(number->count == 0)
+    {
+        return;
+    }
+    const size_t limb_shift = (size_t)(bits / 32);
+    const unsigned bit_shift = (unsigned)(bits % 32);
+    if(bit_shift != 0)
+    {
+        uint32_t carry = 0;
+        for(size_t i = 0; i < number->count; i++)
+        {
+            const uint32_t limb = number->limbs[i];
+            number->limbs[i] = (limb << bit_shift) | carry;
+            carry = limb >> (32 - bit_shift);
+        }
+        if(carry != 0)
+        {
+            number->limbs[number->count++] = carry;
+        }
+    }
+    if(limb_shift != 0)
+    {
+        memmove(number->limbs + limb_shift, number->limbs, number->count * sizeof(*number->limbs));
+        memset(number->limbs, 0, limb_shift * sizeof(*number->limbs));
+        number->count += limb_shift;
+    }
+}
+
+static int bignum_compare(const bignum* const a, const bignum* const b)
+{
+    if(a->count != b->count)
+    {
+        return a->count > b->count ? 1 : -1;
+    }
+    for(size_t i = a->count; i-- > 0;)
+    {
+        if(a->limbs[i] != b->limbs[i])
+        {
+            return a->limbs[i] > b->limbs[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+// Chooses between lower_bits and the next double up by comparing the full
+// decimal number against the halfway point between them.
+static uint64_t round_using_all_digits(const char* const digits_start,
+                                       const char* const digits_end,
+                                       const char* const fraction_start,
+                                       int64_t scale,
+                                       const uint64_t lower_bits)
+{
+    bignum decimal;
+    bignum_init(&decimal, 0);
+    size_t digit_count = 0;
+    bool is_leading_zero = true;
+    bool has_dropped_digits = false;
+    uint32_t chunk = 0;
+    int chunk_digits = 0;
+
+    for(const char* pos = digits_start; pos < digits_end; pos++)
+    {
+        if(*pos == '.')
+        {
+            continue;
+        }
+        const bool is_fraction = fraction_start != NULL && pos >= fraction_start;
+        const uint32_t digit = (uint32_t)(*pos - '0');
+        if(is_leading_zero && digit == 0)
+        {
+            scale -= is_fraction;
+            continue;
+        }
+        is_leading_zero = false;
+        if(digit_count == MAX_DECIMAL_DIGITS)
+        {
+            has_dropped_digits |= digit != 0;
+            scale += !is_fraction;
+            continue;
+        }
+        chunk = chunk * 10 + digit;
+        chunk_digits++;
+        digit_count++;
+        scale -= is_fraction;
+        if(chunk_digits == 9)
+        {
+            bignum_multiply_add(&decimal, g_small_powers_of_ten[9], chunk);
+            chunk = 0;
+            chunk_digits = 0;
+        }
+    }
+    bignum_multiply_add(&decimal, g_small_powers_of_ten[chunk_digits], chunk);
+    if(has_dropped_digits)
+    {
+        // A trailing sticky digit keeps the comparison exact without the rest of the digits.
+        bignum_multiply_add(&decimal, 10, 1);
+        scale--;
+    }
+
+    const uint64_t biased_exponent = lower_bits >> MANTISSA_EXPLICIT_BITS;
+    const uint64_t mantissa = biased_exponent == 0 ? lower_bits : (lower_bits & (HIDDEN_BIT - 1)) | HIDDEN_BIT;
+    const int64_t binary_exponent = (biased_exponent == 0 ? 1 : (int64_t)biased_exponent) + MINIMUM_BINARY_EXPONENT - MANTISSA_EXPLICIT_BITS;
+
+    // Compare decimal * 10^scale against (2 * mantissa + 1) * 2^(binary_exponent - 1).
+    bignum halfway;
+    bignum_init(&halfway, mantissa * 2 + 1);
+    if(scale >= 0)
+    {
+        bignum_multiply_power_of_five(&decimal, scale);
+    }
+    else
+    {
+        bignum_multiply_power_of_five(&halfway, -scale);
+    }
+    const int64_t binary_shift = scale - (binary_exponent - 1);
+    if(binary_shift >= 0)
+    {
+        bignum_shift_left(&decimal, binary_shift);
+    }
+    else
+    {
+        bignum_shift_left(&halfway, -binary_shift);
+    }
+
+    const int comparison = bignum_compare(&decimal, &halfway);
+    if(comparison > 0 || (comparison == 0 && (mantissa & 1) != 0))
+    {
+        return lower_bits + 1;
+    }
+    return lower_bits;
+}
+
+
+// ------
+// Parser
+// ------
+
+typedef enum
+{
+    // Integers become int64s and everything else a double.
+    CONVERT_NATIVE,
+    // Every number becomes a double, whatever its size.
+    CONVERT_TO_DOUBLE,
+    // Only the grammar is checked.
+    CONVERT_NOTHING,
+} number_conversion;
+
+// Inlined into each caller with a constant conversion, so that the unused paths drop out.
+static inline number_status convert_number(const char* const start,
+                                           const char* const end,
+                                           json_number* const number,
+                                           const number_conversion conversion)
+{
+    const char* pos = start;
+    bool is_negative = false;
+    if(pos < end && *pos == '-')
+    {
+        is_negative = true;
+        pos++;
+    }
+    if(pos >= end)
+    {
+        return number_failed(number, pos, NUMBER_STATUS_INCOMPLETE);
+    }
+    if(!is_digit(*pos))
+    {
+        return number_failed(number, pos, NUMBER_STATUS_INVALID);
+    }
+
+    const char* const integer_start = pos;
+    uint64_t mantissa = 0;
+    if(*pos == '0')
+    {
+        pos++;
+    }
+    else
+    {
+        pos = accumulate_digits(pos, end, &mantissa);
+    }
+    int64_t digit_count = pos - integer_start;
+    int64_t exponent = 0;
+    bool is_float = false;
+
+    const char* fraction_start = NULL;
+    number->has_exponent = false;
+    if(pos < end && *pos == '.')
+    {
+        is_float = true;
+        pos++;
+        if(pos >= end)
+        {
+            return number_failed(number, pos, NUMBER_STATUS_INCOMPLETE);
+        }
+        if(!is_digit(*pos))
+        {
+            return number_failed(number, pos, NUMBER_STATUS_INVALID);
+        }
+        fraction_start = pos;
+        pos = accumulate_digits(pos, end, &mantissa);
+        exponent = fraction_start - pos;
+        digit_count -= exponent;
+    }
+    const char* const digits_end = pos;
+
+    int64_t explicit_exponent = 0;
+    if(pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        is_float = true;
+        number->has_exponent = true;
+        pos++;
+        bool is_exponent_negative = false;
+        if(pos < end && (*pos == '+' || *pos == '-'))
+        {
+            is_exponent_negative = *pos == '-';
+            pos++;
+        }
+        if(pos >= end)
+        {
+            return number_failed(number, pos, NUMBER_STATUS_INCOMPLETE);
+        }
+        if(!is_digit(*pos))
+        {
+            return number_failed(number, pos, NUMBER_STATUS_INVALID);
+        }
+        while(pos < end && is_digit(*pos))
+        {
+            if(explicit_exponent < MAX_EXPLICIT_EXPONENT)
+            {
+                explicit_exponent = explicit_exponent * 10 + (*pos - '0');
+            }
+            pos++;
+        }
+        if(is_exponent_negative)
+        {
+            explicit_exponent = -explicit_exponent;
+        }
+        exponent += explicit_exponent;
+    }
+
+    number->end = pos;
+    number->is_float = is_float;
+    number->has_fraction = fraction_start != NULL;
+
+    if(conversion == CONVERT_NOTHING)
+    {
+        return NUMBER_STATUS_OK;
+    }
+    if(!is_float && conversion == CONVERT_NATIVE)
+    {
+        // JSON integers have no leading zeros, so anything past 19 digits is at least 10^19.
+        const uint64_t limit = is_negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+        if(digit_count > MAX_MANTISSA_DIGITS || mantissa > limit)
+        {
+            return NUMBER_STATUS_OUT_OF_RANGE;
+        }
+        number->int_value = is_negative ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
+        return NUMBER_STATUS_OK;
+    }
+
+    bool is_truncated = false;
+    const char* significant_start = integer_start;
+    if(digit_count > MAX_MANTISSA_DIGITS)
+    {
+        // Leading zeros aren't significant, and without them the digits may still fit.
+        while(significant_start < digits_end && (*significant_start == '0' || *significant_start == '.'))
+        {
+            digit_count -= *significant_start == '0';
+            significant_start++;
+        }
+        if(digit_count > MAX_MANTISSA_DIGITS)
+        {
+            is_truncated = true;
+            mantissa = 0;
+            exponent = explicit_exponent;
+            if(fraction_start != NULL && significant_start > fraction_start)
+            {
+                exponent -= significant_start - fraction_start;
+            }
+            int taken = 0;
+            const char* digit_pos = significant_start;
+            for(; digit_pos < digits_end && taken < MAX_MANTISSA_DIGITS; digit_pos++)
+            {
+                if(*digit_pos == '.')
+                {
+                    continue;
+                }
+                mantissa = mantissa * 10 + (uint64_t)(*digit_pos - '0');
+                taken++;
+                exponent -= fraction_start != NULL && digit_pos >= fraction_start;
+            }
+            if(fraction_start == NULL || digit_pos < fraction_start)
+            {
+                // The truncated digits are all in the integer part.
+                const char* const integer_end = fraction_start == NULL ? digits_end : fraction_start - 1;
+                exponent += integer_end - digit_pos;
+            }
+        }
+    }
+
+    double value;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // Both operands are exact, so a single IEEE operation gives the correctly rounded result.
+    if(!is_truncated &&
+       exponent >= -MAX_EXACT_POWER_OF_TEN &&
+       exponent <= MAX_EXACT_POWER_OF_TEN &&
+       mantissa <= HIDDEN_BIT << 1)
+    {
+        value = (double)mantissa;
+        if(exponent < 0)
+        {
+            value /= g_exact_powers_of_ten[-exponent];
+        }
+        else
+        {
+            value *= g_exact_powers_of_ten[exponent];
+        }
+        number->float_value = is_negative ? -value : value;
+        return NUMBER_STATUS_OK;
+    }
+#endif
+
+    uint64_t bits = eisel_lemire(exponent, mantissa);
+    if(is_truncated && eisel_lemire(exponent, mantissa + 1) != bits)
+    {
+        bits = round_using_all_digits(integer_start, digits_end, fraction_start, explicit_exponent, bits);
+    }
+    if(bits == INFINITY_BITS)
+    {
+        return NUMBER_STATUS_OUT_OF_RANGE;
+    }
+    if(is_negative)
+    {
+        bits |= SIGN_BIT;
+    }
+    memcpy(&value, &bits, sizeof(value));
+    number->float_value = value;
+    return NUMBER_STATUS_OK;
+}
+
+number_status parse_json_number(const char* const start, const char* const end, json_number* const number)
+{
+    return convert_number(start, end, number, CONVERT_NATIVE);
+}
+
+number_status scan_json_number(const char* const start, const char* const end, json_number* const number)
+{
+    return convert_number(start, end, number, CONVERT_NOTHING);
+}
+
+bool qjson_number_to_int64(const char* const start, const size_t length, int64_t* const value)
+{
+    json_number number;
+    if(parse_json_number(start, start + length, &number) != NUMBER_STATUS_OK ||
+       number.end != start + length ||
+       number.is_float)
+    {
+        return false;
+    }
+    *value = number.int_value;
+    return true;
+}
+
+bool qjson_number_to_double(const char* const start, const size_t length, double* const value)
+{
+    json_number number;
+    if(convert_number(start, start + length, &number, CONVERT_TO_DOUBLE) != NUMBER_STATUS_OK ||
+       number.end != start + length)
+    {
+        return false;
+    }
+    *value = number.float_value;
+    return true;
+}
+
+qjson_number_status qjson_parse_number(const char* const start, const char* const end, qjson_number* const number)
+{
+    json_number parsed;
+    const number_status status = parse_json_number(start, end, &parsed);
+    number->end = parsed.end;
+    number->is_float = parsed.is_float;
+    if(status == NUMBER_STATUS_OK)
+    {
+        if(parsed.is_float)
+        {
+            number->float_value = parsed.float_value;
+        }
+        else
+        {
+            number->int_value = parsed.int_value;
+        }
+    }
+    switch(status)
+    {
+        case NUMBER_STATUS_OK:          return QJSON_NUMBER_OK;
+        case NUMBER_STATUS_INCOMPLETE:  return QJSON_NUMBER_INCOMPLETE;
+        case NUMBER_STATUS_INVALID:     return QJSON_NUMBER_INVALID;
+        case NUMBER_STATUS_OUT_OF_RANGE:
+        default:                        return QJSON_NUMBER_OUT_OF_RANGE;
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef number_parser_H
+#define number_parser_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Locale-independent JSON number conversion.
+//
+// Integers are accumulated eight digits at a time using SWAR arithmetic.
+// Floats take the exact fast path when the mantissa and exponent are small
+// enough, then the Eisel-Lemire algorithm, and fall back to exact big-integer
+// comparison only for the rare inputs with more than 19 significant digits
+// that Eisel-Lemire cannot settle. Every result is correctly rounded.
+
+typedef enum
+{
+    NUMBER_STATUS_OK,
+    // The input ended partway through the number.
+    NUMBER_STATUS_INCOMPLETE,
+    // The input does not follow the JSON number grammar.
+    NUMBER_STATUS_INVALID,
+    // An integer does not fit in an int64, or a float overflows a double.
+    NUMBER_STATUS_OUT_OF_RANGE,
+} number_status;
+
+typedef struct
+{
+    // Points past the number on success, or at the offending character on failure.
+    const char* end;
+    bool is_float;
+    bool has_fraction;
+    bool has_exponent;
+    int64_t int_value;
+    double float_value;
+} json_number;
+
+/**
+ * Parse the JSON number at the start of [start, end).
+ * Parsing stops at the first character that cannot continue the number; that
+ * character is not checked.
+ *
+ * A number without a fraction or an exponent is an integer, and must fit in an int64.
+ * Anything else is a float. Floats too small for a double become zero.
+ *
+ * @param start The start of the number.
+ * @param end The end of the available input.
+ * @param number Receives the result.
+ * @return The status of the conversion.
+ */
+number_status parse_json_number(const char* start, const char* end, json_number* number);
+
+/**
+ * Check the JSON number at the start of [start, end) against the grammar without converting it.
+ * Only end, is_float, has_fraction and has_exponent are set.
+ *
+ * @param start The start of the number.
+ * @param end The end of the available input.
+ * @param number Receives the result.
+ * @return The status of the check, which is never NUMBER_STATUS_OUT_OF_RANGE.
+ */
+number_status scan_json_number(const char* start, const char* end, json_number* number);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // number_parser_H
@@ -0,0 +1,543 @@
+#include "json_parser.h"
+#include "string_decoder.h"
+#include "value_scanner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Path-filtered parsing.
+//
+// The document is walked with the value scanner (see value_scanner.h), and
+// only the containers on the way to a selected path are actually entered.
+// Every other value is skipped without being converted or unescaped. Each
+// selected value is handed to the regular parser as a document of its own,
+// which validates it and fires its callbacks.
+//
+// The paths that are still live at a given depth are tracked as a bitmask of
+// path indices, which is why a filter holds at most 64 paths. Containers on
+// the way to a selection are announced lazily, once the first selected value
+// inside them is found, so that containers without any selections stay silent.
+
+#define NOT_AN_INDEX ((size_t)-1)
+#define KEY_BUFFER_SIZE 256
+
+typedef struct
+{
+    // Unescaped key. NULL for the wildcard segment.
+    char* key;
+    size_t key_length;
+    // The list index that the key spells out, or NOT_AN_INDEX.
+    size_t index;
+} path_segment;
+
+typedef struct
+{
+    path_segment* segments;
+    size_t segment_count;
+} filter_path;
+
+struct qjson_path_filter
+{
+    filter_path paths[QJSON_MAX_FILTER_PATHS];
+    size_t path_count;
+};
+
+typedef uint64_t path_mask;
+
+// A container on the way to a selected path, which is announced only once something inside it is selected.
+typedef struct path_frame
+{
+    struct path_frame* parent;
+    // The raw key of this container in its parent map, or NULL if the parent is a list.
+    const char* key;
+    const char* key_end;
+    bool is_map;
+    bool is_announced;
+} path_frame;
+
+typedef struct
+{
+    const qjson_path_filter* filter;
+    const qjson_parse_callbacks* callbacks;
+    void* context;
+    qjson_parser* parser;
+    const char* data;
+    const char* end;
+} filter_walk;
+
+static size_t parse_index(const char* const key, const size_t length)
+{
+    if(length == 0 || length > 18 || (key[0] == '0' && length > 1))
+    {
+        return NOT_AN_INDEX;
+    }
+    size_t index = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        if(key[i] < '0' || key[i] > '9')
+        {
+            return NOT_AN_INDEX;
+        }
+        index = index * 10 + (size_t)(key[i] - '0');
+    }
+    return index;
+}
+
+// Decodes one JSON Pointer segment, turning ~0 into ~ and ~1 into /.
+static bool compile_segment(const char* const start, const char* const end, path_segment* const segment)
+{
+    if(end - start == 1 && *start == '*')
+    {
+        segment->key = NULL;
+        segment->key_length = 0;
+        segment->index = NOT_AN_INDEX;
+        return true;
+    }
+    char* const key = malloc((size_t)(end - start) + 1);
+    if(key == NULL)
+    {
+        return false;
+    }
+    size_t length = 0;
+    for(const char* pos = start; pos < end; pos++)
+    {
+        if(*pos != '~')
+        {
+            key[length++] = *pos;
+            continue;
+        }
+        if(pos + 1 >= end || (pos[1] != '0' && pos[1] != '1'))
+        {
+            free(key);
+            return false;
+        }
+        pos++;
+        key[length++] = *pos == '0' ? '~' : '/';
+    }
+    key[length] = 0;
+    segment->key = key;
+    segment->key_length = length;
+    segment->index = parse_index(key, length);
+    return true;
+}
+
+static bool compile_path(const char* const pointer, filter_path* const path)
+{
+    path->segments = NULL;
+    path->segment_count = 0;
+    if(*pointer == 0)
+    {
+        return true;
+    }
+    if(*pointer != '/')
+    {
+        return false;
+    }
+
+    size_t segment_count = 0;
+    for(const char* pos = pointer; *pos != 0; pos++)
+    {
+        segment_count += *pos == '/';
+    }
+    path->segments = malloc(segment_count * sizeof(*path->segments));
+    if(path->segments == NULL)
+    {
+        return false;
+    }
+
+    const char* start = pointer + 1;
+    for(;;)
+    {
+        const char* end = strchr(start, '/');
+        if(end == NULL)
+        {
+            end = start + strlen(start);
+        }
+        if(!compile_segment(start, end, &path->segments[path->segment_count]))
+        {
+            return false;
+        }
+        path->segment_count++;
+        if(*end == 0)
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+}
+
+qjson_path_filter* qjson_new_path_filter(const char* const* const paths, const size_t path_count)
+{
+    if(path_count > QJSON_MAX_FILTER_PATHS)
+    {
+        return NULL;
+    }
+    qjson_path_filter* const filter = calloc(1, sizeof(*filter));
+    if(filter == NULL)
+    {
+        return NULL;
+    }
+    for(size_t i = 0; i < path_count; i++)
+    {
+        // Count the path before compiling it, so that a partly compiled path is freed too.
+        filter->path_count++;
+        if(!compile_path(paths[i], &filter->paths[i]))
+        {
+            qjson_free_path_filter(filter);
+            return NULL;
+        }
+    }
+    return filter;
+}
+
+void qjson_free_path_filter(qjson_path_filter* const filter)
+{
+    if(filter == NULL)
+    {
+        return;
+    }
+    for(size_t i = 0; i < filter->path_count; i++)
+    {
+        filter_path* const path = &filter->paths[i];
+        for(size_t j = 0; j < path->segment_count; j++)
+        {
+            free(path->segments[j].key);
+        }
+        free(path->segments);
+    }
+    free(filter);
+}
+
+static void report_unexpected(const filter_walk* const walk, const char* const pos)
+{
+    char buff[ERROR_MESSAGE_SIZE];
+    if(pos >= walk->end)
+    {
+        snprintf(buff, sizeof(buff), "Unexpected end of document at offset %zu", (size_t)(walk->end - walk->data));
+    }
+    else
+    {
+        snprintf(buff, sizeof(buff), "Unexpected token: '%c' at offset %zu", *pos, (size_t)(pos - walk->data));
+    }
+    walk->callbacks->on_parse_error(walk->context, buff);
+}
+
+// Reports the value at pos, which could not be skipped, as malformed.
+static void report_unterminated(const filter_walk* const walk, const char* const pos)
+{
+    const bool is_unterminated = pos < walk->end && (*pos == '[' || *pos == '{' || *pos == '"');
+    report_unexpected(walk, is_unterminated ? walk->end : pos);
+}
+
+static bool deliver_key(const filter_walk* const walk, const char* const key, const char* const key_end)
+{
+    const size_t raw_length = key_end - key;
+    char inline_buffer[KEY_BUFFER_SIZE];
+    char* const buffer = raw_length < sizeof(inline_buffer) ? inline_buffer : malloc(raw_length + 1);
+    if(buffer == NULL)
+    {
+        walk->callbacks->on_parse_error(walk->context, "Out of memory");
+        return false;
+    }
+    char* decoded_end = NULL;
+    const char* error_pos = NULL;
+    const string_decode_status status = decode_json_string(key, key_end, buffer, &decoded_end, &error_pos);
+    if(status == STRING_DECODE_OK)
+    {
+        *decoded_end = 0;
+        walk->callbacks->on_string(walk->context, buffer);
+    }
+    else
+    {
+        char message[ERROR_MESSAGE_SIZE];
+        snprintf(message, sizeof(message), "Bad encoding: %s at offset %zu",
+                 status == STRING_DECODE_BAD_ESCAPE        ? "invalid escape sequence" :
+                 status == STRING_DECODE_CONTROL_CHARACTER ? "unescaped control character" :
+                                                             "invalid UTF-8",
+                 (size_t)(error_pos - walk->data));
+        walk->callbacks->on_parse_error(walk->context, message);
+    }
+    if(buffer != inline_buffer)
+    {
+        free(buffer);
+    }
+    return status == STRING_DECODE_OK;
+}
+
+// Announces every container on the way to frame that has not been announced yet.
+static bool announce_frame(const filter_walk* const walk, path_frame* const frame)
+{
+    if(frame == NULL || frame->is_announced)
+    {
+        return true;
+    }
+    if(!announce_frame(walk, frame->parent))
+    {
+        return false;
+    }
+    if(frame->key != NULL && !deliver_key(walk, frame->key, frame->key_end))
+    {
+        return false;
+    }
+    if(frame->is_map)
+    {
+        walk->callbacks->on_map_start(walk->context);
+    }
+    else
+    {
+        walk->callbacks->on_list_start(walk->context);
+    }
+    frame->is_announced = true;
+    return true;
+}
+
+// Returns the paths in mask whose segment at depth matches a map key or list index.
+static path_mask match_entry(const qjson_path_filter* const filter,
+                             const path_mask mask,
+                             const size_t depth,
+                             const char* const key,
+                             const char* const key_end,
+                             const size_t index)
+{
+    path_mask matches = 0;
+    for(path_mask bits = mask; bits != 0; bits &= bits - 1)
+    {
+        const int path_index = __builtin_ctzll(bits);
+        const path_segment* const segment = &filter->paths[path_index].segments[depth];
+        const bool is_match = segment->key == NULL ||
+                              (key != NULL
+                               ? json_key_equals(key, key_end, segment->key, segment->key_length)
+                               : segment->index == index);
+        if(is_match)
+        {
+            matches |= 1ULL << path_index;
+        }
+    }
+    return matches;
+}
+
+// Returns true if a path in mask ends at depth, which selects the whole value there.
+static bool is_selected(const qjson_path_filter* const filter, const path_mask mask, const size_t depth)
+{
+    for(path_mask bits = mask; bits != 0; bits &= bits - 1)
+    {
+        if(filter->paths[__builtin_ctzll(bits)].segment_count == depth)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* walk_value(const filter_walk* walk,
+                              const char* pos,
+                              path_mask mask,
+                              size_t depth,
+                              path_frame* parent,
+                              const char* key,
+                              const char* key_end);
+
+// Walks the container at pos, whose paths in mask continue past depth.
+// Returns a pointer past the container, or NULL on error.
+static const char* walk_container(const filter_walk* const walk,
+                                  const char* pos,
+                                  const path_mask mask,
+                                  const size_t depth,
+                                  path_frame* const parent,
+                                  const char* const key,
+                                  const char* const key_end)
+{
+    path_frame frame = {parent, key, key_end, *pos == '{', false};
+    const char closing = frame.is_map ? '}' : ']';
+    const char* const end = walk->end;
+
+    pos = skip_json_whitespace(pos + 1, end);
+    if(pos < end && *pos == closing)
+    {
+        return pos + 1;
+    }
+    for(size_t index = 0;; index++)
+    {
+        const char* entry_key = NULL;
+        const char* entry_key_end = NULL;
+        if(frame.is_map)
+        {
+            if(pos >= end || *pos != '"')
+            {
+                report_unexpected(walk, pos);
+                return NULL;
+            }
+            entry_key = pos + 1;
+            entry_key_end = find_json_string_end(entry_key, end);
+            if(entry_key_end == NULL)
+            {
+                report_unexpected(walk, end);
+                return NULL;
+            }
+            pos = skip_json_whitespace(entry_key_end + 1, end);
+            if(pos >= end || *pos != ':')
+            {
+                report_unexpected(walk, pos);
+                return NULL;
+            }
+            pos = skip_json_whitespace(pos + 1, end);
+        }
+
+        const path_mask entry_mask = match_entry(walk->filter, mask, depth, entry_key, entry_key_end, index);
+        if(entry_mask != 0)
+        {
+            pos = walk_value(walk, pos, entry_mask, depth + 1, &frame, entry_key, entry_key_end);
+        }
+        else
+        {
+            const char* const value_end = skip_json_value(pos, end);
+            if(value_end == NULL)
+            {
+                report_unterminated(walk, pos);
+            }
+            pos = value_end;
+        }
+        if(pos == NULL)
+        {
+            return NULL;
+        }
+
+        pos = skip_json_whitespace(pos, end);
+        if(pos < end && *pos == ',')
+        {
+            pos = skip_json_whitespace(pos + 1, end);
+            continue;
+        }
+        if(pos < end && *pos == closing)
+        {
+            break;
+        }
+        report_unexpected(walk, pos);
+        return NULL;
+    }
+
+    if(frame.is_announced)
+    {
+        if(frame.is_map)
+        {
+            walk->callbacks->on_map_end(walk->context);
+        }
+        else
+        {
+            walk->callbacks->on_list_end(walk->context);
+        }
+    }
+    return pos + 1;
+}
+
+// Walks the value at pos, which is reached by the paths in mask.
+// Returns a pointer past the value, or NULL on error.
+static const char* walk_value(const filter_walk* const walk,
+                              const char* const pos,
+                              const path_mask mask,
+                              const size_t depth,
+                              path_frame* const parent,
+                              const char* const key,
+                              const char* const key_end)
+{
+    if(pos >= walk->end)
+    {
+        report_unexpected(walk, pos);
+        return NULL;
+    }
+    if(!is_selected(walk->filter, mask, depth))
+    {
+        if(*pos == '{' || *pos == '[')
+        {
+            return walk_container(walk, pos, mask, depth, parent, key, key_end);
+        }
+        // The paths lead further down, but there is nothing below a scalar.
+        const char* const value_end = skip_json_value(pos, walk->end);
+        if(value_end == NULL)
+        {
+            report_unterminated(walk, pos);
+        }
+        return value_end;
+    }
+
+    const char* const value_end = skip_json_value(pos, walk->end);
+    if(value_end == NULL)
+    {
+        report_unterminated(walk, pos);
+        return NULL;
+    }
+    if(!announce_frame(walk, parent))
+    {
+        return NULL;
+    }
+    if(key != NULL && !deliver_key(walk, key, key_end))
+    {
+        return NULL;
+    }
+    if(!parse_document_sequence(walk->parser,
+                                pos,
+                                value_end - pos,
+                                pos - walk->data,
+                                walk->callbacks,
+                                NULL,
+                                walk->context))
+    {
+        return NULL;
+    }
+    return value_end;
+}
+
+bool qjson_parse_buffer_filtered(const char* const data,
+                                 const size_t length,
+                                 const qjson_path_filter* const filter,
+                                 const qjson_parse_callbacks* const callbacks,
+                                 void* const context)
+{
+    qjson_parser* const parser = qjson_acquire_thread_parser();
+    if(parser == NULL)
+    {
+        callbacks->on_parse_error(context, "Out of memory");
+        return false;
+    }
+    const filter_walk walk =
+    {
+        .filter = filter,
+        .callbacks = callbacks,
+        .context = context,
+        .parser = parser,
+        .data = data,
+        .end = data + length,
+    };
+    const path_mask all_paths = filter->path_count == QJSON_MAX_FILTER_PATHS
+                                ? ~(path_mask)0
+                                : ((path_mask)1 << filter->path_count) - 1;
+
+    const char* pos = skip_json_whitespace(data, walk.end);
+    if(all_paths == 0)
+    {
+        // Nothing is selected, but the document must still be well formed at the top level.
+        const char* const value_end = skip_json_value(pos, walk.end);
+        if(value_end == NULL)
+        {
+            report_unterminated(&walk, pos);
+        }
+        pos = value_end;
+    }
+    else
+    {
+        pos = walk_value(&walk, pos, all_paths, 0, NULL, NULL, NULL);
+    }
+    qjson_release_thread_parser(parser);
+    if(pos == NULL)
+    {
+        return false;
+    }
+
+    pos = skip_json_whitespace(pos, walk.end);
+    if(pos < walk.end)
+    {
+        report_unexpected(&walk, pos);
+        return false;
+    }
+    return true;
+}
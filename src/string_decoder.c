@@ -0,0 +1,581 @@
+#include "string_decoder.h"
+#include "structural_index.h"
+#include "qjson/qjson.h"
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define HAS_X86_KERNELS 1
+    #include <immintrin.h>
+#else
+    #define HAS_X86_KERNELS 0
+#endif
+
+// Strings shorter than this are decoded by the scalar kernel without dispatching.
+#define MIN_VECTOR_STRING_LENGTH 16
+#define HIGH_BITS 0x8080808080808080ULL
+#define LOW_BITS 0x0101010101010101ULL
+// The lowest byte that may appear unescaped in a string.
+#define FIRST_PLAIN_CHARACTER 0x20
+
+// UTF-8 validator states. Each byte moves the validator to a new state;
+// the AFTER_ states constrain the second byte of sequences that would
+// otherwise be overlong, surrogates, or above U+10FFFF.
+typedef enum
+{
+    UTF8_ACCEPT,
+    UTF8_CONTINUE_1,
+    UTF8_CONTINUE_2,
+    UTF8_CONTINUE_3,
+    UTF8_AFTER_E0,
+    UTF8_AFTER_ED,
+    UTF8_AFTER_F0,
+    UTF8_AFTER_F4,
+    UTF8_REJECT,
+} utf8_state;
+
+typedef struct
+{
+    const char* src;
+    char* dst;
+    utf8_state state;
+    // Where the multibyte sequence being validated began.
+    const char* sequence_start;
+    const char* error_pos;
+    string_decode_status status;
+} string_decoder;
+
+// Hex digits have bit 0x10 set and their value in the low nibble; anything else is 0.
+static const uint8_t g_hex_digits[256] =
+{
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['a'] = 0x1a, ['b'] = 0x1b, ['c'] = 0x1c, ['d'] = 0x1d, ['e'] = 0x1e, ['f'] = 0x1f,
+    ['A'] = 0x1a, ['B'] = 0x1b, ['C'] = 0x1c, ['D'] = 0x1d, ['E'] = 0x1e, ['F'] = 0x1f,
+};
+
+// The character each single-character escape stands for, or 0 if the escape is not one.
+static const char g_escaped_characters[256] =
+{
+    ['"'] = '"', ['\\'] = '\\', ['/'] = '/',
+    ['b'] = '\b', ['f'] = '\f', ['n'] = '\n', ['r'] = '\r', ['t'] = '\t',
+};
+
+static inline utf8_state next_utf8_state(const utf8_state state, const uint8_t byte)
+{
+    const bool is_continuation = (byte & 0xc0) == 0x80;
+    switch(state)
+    {
+        case UTF8_ACCEPT:
+            if(byte < 0x80) return UTF8_ACCEPT;
+            if(byte < 0xc2) return UTF8_REJECT;
+            if(byte < 0xe0) return UTF8_CONTINUE_1;
+            if(byte == 0xe0) return UTF8_AFTER_E0;
+            if(byte == 0xed) return UTF8_AFTER_ED;
+            if(byte < 0xf0) return UTF8_CONTINUE_2;
+            if(byte == 0xf0) return UTF8_AFTER_F0;
+            if(byte < 0xf4) return UTF8_CONTINUE_3;
+            if(byte == 0xf4) return UTF8_AFTER_F4;
+            return UTF8_REJECT;
+        case UTF8_CONTINUE_1: return is_continuation ? UTF8_ACCEPT : UTF8_REJECT;
+        case UTF8_CONTINUE_2: return is_continuation ? UTF8_CONTINUE_1 : UTF8_REJECT;
+        case UTF8_CONTINUE_3: return is_continuation ? UTF8_CONTINUE_2 : UTF8_REJECT;
+        case UTF8_AFTER_E0: return byte >= 0xa0 && byte <= 0xbf ? UTF8_CONTINUE_1 : UTF8_REJECT;
+        case UTF8_AFTER_ED: return byte >= 0x80 && byte <= 0x9f ? UTF8_CONTINUE_1 : UTF8_REJECT;
+        case UTF8_AFTER_F0: return byte >= 0x90 && byte <= 0xbf ? UTF8_CONTINUE_2 : UTF8_REJECT;
+        case UTF8_AFTER_F4: return byte >= 0x80 && byte <= 0x8f ? UTF8_CONTINUE_2 : UTF8_REJECT;
+        default: return UTF8_REJECT;
+    }
+}
+
+static inline int decode_hex4(const char* const pos)
+{
+    const uint8_t a = g_hex_digits[(uint8_t)pos[0]];
+    const uint8_t b = g_hex_digits[(uint8_t)pos[1]];
+    const uint8_t c = g_hex_digits[(uint8_t)pos[2]];
+    const uint8_t d = g_hex_digits[(uint8_t)pos[3]];
+    if((a & b & c & d & 0x10) == 0)
+    {
+        return -1;
+    }
+    return ((a & 0x0f) << 12) | ((b & 0x0f) << 8) | ((c & 0x0f) << 4) | (d & 0x0f);
+}
+
+static inline char* encode_utf8(char* dst, const uint32_t codepoint)
+{
+    if(codepoint <= 0x7f)
+    {
+        *dst++ = (char)codepoint;
+    }
+    else if(codepoint <= 0x7ff)
+    {
+        *dst++ = (char)((codepoint >> 6) | 0xc0);
+        *dst++ = (char)((codepoint & 0x3f) | 0x80);
+    }
+    else if(codepoint <= 0xffff)
+    {
+        *dst++ = (char)((codepoint >> 12) | 0xe0);
+        *dst++ = (char)(((codepoint >> 6) & 0x3f) | 0x80);
+        *dst++ = (char)((codepoint & 0x3f) | 0x80);
+    }
+    else
+    {
+        *dst++ = (char)((codepoint >> 18) | 0xf0);
+        *dst++ = (char)(((codepoint >> 12) & 0x3f) | 0x80);
+        *dst++ = (char)(((codepoint >> 6) & 0x3f) | 0x80);
+        *dst++ = (char)((codepoint & 0x3f) | 0x80);
+    }
+    return dst;
+}
+
+static inline bool escape_failed(string_decoder* const decoder)
+{
+    decoder->status = STRING_DECODE_BAD_ESCAPE;
+    decoder->error_pos = decoder->src;
+    return false;
+}
+
+// Decodes the escape sequence at decoder->src, which must point to a backslash.
+// Returns false if the escape sequence is invalid.
+static inline bool decode_escape(string_decoder* const decoder, const char* const src_end)
+{
+    const char* src = decoder->src;
+    if(src_end - src < 2)
+    {
+        return escape_failed(decoder);
+    }
+    const char replacement = g_escaped_characters[(uint8_t)src[1]];
+    if(replacement != 0)
+    {
+        *decoder->dst++ = replacement;
+        decoder->src = src + 2;
+        return true;
+    }
+    if(src[1] != 'u' || src_end - src < 6)
+    {
+        return escape_failed(decoder);
+    }
+    int codepoint = decode_hex4(src + 2);
+    if(codepoint < 0 || (codepoint >= 0xdc00 && codepoint <= 0xdfff))
+    {
+        return escape_failed(decoder);
+    }
+    src += 6;
+    if(codepoint >= 0xd800 && codepoint <= 0xdbff)
+    {
+        if(src_end - src < 6 || src[0] != '\\' || src[1] != 'u')
+        {
+            return escape_failed(decoder);
+        }
+        const int low_surrogate = decode_hex4(src + 2);
+        if(low_surrogate < 0xdc00 || low_surrogate > 0xdfff)
+        {
+            return escape_failed(decoder);
+        }
+        src += 6;
+        codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low_surrogate - 0xdc00);
+    }
+    decoder->dst = encode_utf8(decoder->dst, (uint32_t)codepoint);
+    decoder->src = src;
+    return true;
+}
+
+// Decodes a byte at a time until src reaches limit (an escape sequence may carry it past).
+// Returns false on error.
+static bool decode_bytes(string_decoder* const decoder, const char* const limit, const char* const src_end)
+{
+    while(decoder->src < limit)
+    {
+        const uint8_t byte = (uint8_t)*decoder->src;
+        // A backslash inside a multibyte sequence goes to the validator, which rejects it.
+        if(byte == '\\' && decoder->state == UTF8_ACCEPT)
+        {
+            if(!decode_escape(decoder, src_end))
+            {
+                return false;
+            }
+            continue;
+        }
+        if(decoder->state == UTF8_ACCEPT)
+        {
+            if(byte < FIRST_PLAIN_CHARACTER)
+            {
+                decoder->status = STRING_DECODE_CONTROL_CHARACTER;
+                decoder->error_pos = decoder->src;
+                return false;
+            }
+            decoder->sequence_start = decoder->src;
+        }
+        decoder->state = next_utf8_state(decoder->state, byte);
+        if(decoder->state == UTF8_REJECT)
+        {
+            decoder->status = STRING_DECODE_BAD_UTF8;
+            decoder->error_pos = decoder->src;
+            return false;
+        }
+        *decoder->dst++ = (char)byte;
+        decoder->src++;
+    }
+    return true;
+}
+
+// Copies runs of eight plain printable ASCII bytes at once, and everything else a byte at a time.
+static bool decode_scalar(string_decoder* const decoder, const char* const src_end)
+{
+    while(decoder->src < src_end)
+    {
+        if(decoder->state == UTF8_ACCEPT)
+        {
+            // Local copies, since stores through dst could otherwise alias the decoder.
+            const char* src = decoder->src;
+            char* dst = decoder->dst;
+            while(src_end - src >= 8)
+            {
+                uint64_t chunk;
+                memcpy(&chunk, src, sizeof(chunk));
+                const uint64_t backslashes = chunk ^ (LOW_BITS * '\\');
+                const bool has_backslash = ((backslashes - LOW_BITS) & ~backslashes & HIGH_BITS) != 0;
+                const bool has_control = ((chunk - LOW_BITS * FIRST_PLAIN_CHARACTER) & ~chunk & HIGH_BITS) != 0;
+                if((chunk & HIGH_BITS) != 0 || has_backslash || has_control)
+                {
+                    break;
+                }
+                // Going through a register keeps this safe when decoding in place.
+                memcpy(dst, &chunk, sizeof(chunk));
+                src += 8;
+                dst += 8;
+            }
+            decoder->src = src;
+            decoder->dst = dst;
+            if(src >= src_end)
+            {
+                break;
+            }
+        }
+        const char* limit = decoder->src + 8;
+        if(limit > src_end)
+        {
+            limit = src_end;
+        }
+        if(!decode_bytes(decoder, limit, src_end))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static string_decode_status finish_decode(string_decoder* const decoder,
+                                          const char* const src_end,
+                                          char** const dst_end,
+                                          const char** const error_pos)
+{
+    if(decoder->status == STRING_DECODE_OK && decode_scalar(decoder, src_end) && decoder->state != UTF8_ACCEPT)
+    {
+        decoder->status = STRING_DECODE_BAD_UTF8;
+        decoder->error_pos = decoder->sequence_start;
+    }
+    if(decoder->status != STRING_DECODE_OK)
+    {
+        *error_pos = decoder->error_pos;
+        return decoder->status;
+    }
+    *dst_end = decoder->dst;
+    return STRING_DECODE_OK;
+}
+
+#if HAS_X86_KERNELS
+
+// SSE2 has no byte shuffle, so only printable ASCII vectors are handled in bulk.
+__attribute__((target("sse2")))
+static bool decode_sse2(string_decoder* const decoder, const char* const src_end)
+{
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i first_plain = _mm_set1_epi8(FIRST_PLAIN_CHARACTER);
+    const char* src = decoder->src;
+    char* dst = decoder->dst;
+    while(src_end - src >= 16)
+    {
+        const __m128i input = _mm_loadu_si128((const __m128i*)src);
+        // A signed comparison catches control characters and everything outside of ASCII at once.
+        const unsigned non_ascii = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(input, first_plain));
+        const unsigned backslashes = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(input, backslash));
+        if((non_ascii | backslashes) == 0 && decoder->state == UTF8_ACCEPT)
+        {
+            _mm_storeu_si128((__m128i*)dst, input);
+            src += 16;
+            dst += 16;
+            continue;
+        }
+        decoder->src = src;
+        decoder->dst = dst;
+        if(non_ascii != 0 || decoder->state != UTF8_ACCEPT)
+        {
+            if(!decode_bytes(decoder, src + 16, src_end))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            const int run_length = __builtin_ctz(backslashes);
+            memmove(dst, src, run_length);
+            decoder->src += run_length;
+            decoder->dst += run_length;
+            if(!decode_escape(decoder, src_end))
+            {
+                return false;
+            }
+        }
+        src = decoder->src;
+        dst = decoder->dst;
+    }
+    decoder->src = src;
+    decoder->dst = dst;
+    return true;
+}
+
+// Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+// Each byte is checked against the high and low nibbles of the byte before it
+// and its own high nibble; the three lookups AND to nonzero for any error in a
+// two-byte window. Three- and four-byte sequences are checked by requiring a
+// continuation exactly where the lead byte two or three back says there must be one.
+#define UTF8_TOO_SHORT    0x01 // 11______ 0_______ or 11______ 11______
+#define UTF8_TOO_LONG     0x02 // 0_______ 10______
+#define UTF8_OVERLONG_3   0x04 // 11100000 100_____
+#define UTF8_TOO_LARGE    0x08 // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+#define UTF8_SURROGATE    0x10 // 11101101 101_____
+#define UTF8_OVERLONG_2   0x20 // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 0x40 // 11110101+ 1000____
+#define UTF8_OVERLONG_4   0x40 // 11110000 1000____
+#define UTF8_TWO_CONTS    0x80 // 10______ 10______
+#define UTF8_CARRY        (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#define UTF8_TABLE_BYTE_1_HIGH \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+    UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+#define UTF8_TABLE_BYTE_1_LOW \
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, \
+    UTF8_CARRY | UTF8_OVERLONG_2, \
+    UTF8_CARRY, \
+    UTF8_CARRY, \
+    UTF8_CARRY | UTF8_TOO_LARGE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, \
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+#define UTF8_TABLE_BYTE_2_HIGH \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+typedef struct
+{
+    __m256i error;
+    __m256i prev_input;
+    // Nonzero where the previous vector ended partway through a sequence.
+    __m256i prev_incomplete;
+} utf8_checker_avx2;
+
+// The input shifted back by n bytes, with the end of the previous vector shifted in.
+#define PREVIOUS_BYTES_AVX2(input, prev_input, n) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev_input), (input), 0x21), 16 - (n))
+
+__attribute__((target("avx2")))
+static inline __m256i high_nibbles_avx2(const __m256i bytes)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0f));
+}
+
+__attribute__((target("avx2")))
+static inline void check_utf8_avx2(utf8_checker_avx2* const checker, const __m256i input)
+{
+    if(_mm256_movemask_epi8(input) == 0)
+    {
+        checker->error = _mm256_or_si256(checker->error, checker->prev_incomplete);
+        checker->prev_incomplete = _mm256_setzero_si256();
+        checker->prev_input = input;
+        return;
+    }
+
+    const __m256i byte_1_high_table = _mm256_setr_epi8(UTF8_TABLE_BYTE_1_HIGH, UTF8_TABLE_BYTE_1_HIGH);
+    const __m256i byte_1_low_table = _mm256_setr_epi8(UTF8_TABLE_BYTE_1_LOW, UTF8_TABLE_BYTE_1_LOW);
+    const __m256i byte_2_high_table = _mm256_setr_epi8(UTF8_TABLE_BYTE_2_HIGH, UTF8_TABLE_BYTE_2_HIGH);
+
+    const __m256i prev1 = PREVIOUS_BYTES_AVX2(input, checker->prev_input, 1);
+    const __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, high_nibbles_avx2(prev1));
+    const __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)));
+    const __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, high_nibbles_avx2(input));
+    const __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    const __m256i prev2 = PREVIOUS_BYTES_AVX2(input, checker->prev_input, 2);
+    const __m256i prev3 = PREVIOUS_BYTES_AVX2(input, checker->prev_input, 3);
+    // Only 111_____ two back or 1111____ three back leave the top bit set.
+    const __m256i is_third_byte = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xe0 - 0x80)));
+    const __m256i is_fourth_byte = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xf0 - 0x80)));
+    const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte),
+                                                          _mm256_set1_epi8((char)0x80));
+    checker->error = _mm256_or_si256(checker->error, _mm256_xor_si256(must_be_continuation, special_cases));
+
+    const __m256i max_complete = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+    checker->prev_incomplete = _mm256_subs_epu8(input, max_complete);
+    checker->prev_input = input;
+}
+
+// Sets the scalar validator state to where the vector validator left off
+// by replaying any partial character at the end of the last vector checked.
+// The bytes come from the register because decoding in place may have overwritten the input.
+__attribute__((target("avx2")))
+static void resume_after_vectors_avx2(string_decoder* const decoder, const __m256i prev_input)
+{
+    uint8_t bytes[32];
+    _mm256_storeu_si256((__m256i*)bytes, prev_input);
+    int continuations = 0;
+    while(continuations < 3 && (bytes[31 - continuations] & 0xc0) == 0x80)
+    {
+        continuations++;
+    }
+    decoder->state = UTF8_ACCEPT;
+    if(continuations < 3 && bytes[31 - continuations] >= 0xc0)
+    {
+        for(int i = 31 - continuations; i < 32; i++)
+        {
+            decoder->state = next_utf8_state(decoder->state, bytes[i]);
+        }
+        decoder->sequence_start = decoder->src - (continuations + 1);
+    }
+}
+
+__attribute__((target("avx2")))
+static bool decode_avx2(string_decoder* const decoder, const char* const src_end)
+{
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i last_control = _mm256_set1_epi8(FIRST_PLAIN_CHARACTER - 1);
+    utf8_checker_avx2 checker =
+    {
+        .error = _mm256_setzero_si256(),
+        .prev_input = _mm256_setzero_si256(),
+        .prev_incomplete = _mm256_setzero_si256(),
+    };
+
+    const char* src = decoder->src;
+    char* dst = decoder->dst;
+    while(src_end - src >= 32)
+    {
+        const __m256i input = _mm256_loadu_si256((const __m256i*)src);
+        const __m256i prev_input = checker.prev_input;
+        check_utf8_avx2(&checker, input);
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(input, last_control), input);
+        if(!_mm256_testz_si256(checker.error, checker.error) || !_mm256_testz_si256(controls, controls))
+        {
+            // The first error is in this vector or just before it; let the scalar validator pinpoint it.
+            decoder->src = src;
+            decoder->dst = dst;
+            resume_after_vectors_avx2(decoder, prev_input);
+            return true;
+        }
+        const unsigned backslashes = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, backslash));
+        if(backslashes == 0)
+        {
+            _mm256_storeu_si256((__m256i*)dst, input);
+            src += 32;
+            dst += 32;
+            continue;
+        }
+        const int run_length = __builtin_ctz(backslashes);
+        memmove(dst, src, run_length);
+        decoder->src = src + run_length;
+        decoder->dst = dst + run_length;
+        if(!decode_escape(decoder, src_end))
+        {
+            return false;
+        }
+        src = decoder->src;
+        dst = decoder->dst;
+        // The escape sequence is ASCII, so the next vector starts on a character boundary.
+        checker.prev_input = _mm256_setzero_si256();
+        checker.prev_incomplete = _mm256_setzero_si256();
+    }
+    decoder->src = src;
+    decoder->dst = dst;
+    resume_after_vectors_avx2(decoder, checker.prev_input);
+    return true;
+}
+
+#endif // HAS_X86_KERNELS
+
+string_decode_status decode_json_string(const char* const src,
+                                        const char* const src_end,
+                                        char* const dst,
+                                        char** const dst_end,
+                                        const char** const error_pos)
+{
+    string_decoder decoder =
+    {
+        .src = src,
+        .dst = dst,
+        .state = UTF8_ACCEPT,
+        .sequence_start = src,
+        .error_pos = NULL,
+        .status = STRING_DECODE_OK,
+    };
+
+#if HAS_X86_KERNELS
+    if(src_end - src >= MIN_VECTOR_STRING_LENGTH)
+    {
+        switch(structural_index_get_simd_level())
+        {
+            case SIMD_LEVEL_AVX2:
+            case SIMD_LEVEL_AVX512:
+                decode_avx2(&decoder, src_end);
+                break;
+            case SIMD_LEVEL_SSE2:
+                decode_sse2(&decoder, src_end);
+                break;
+            default:
+                break;
+        }
+    }
+#endif
+    return finish_decode(&decoder, src_end, dst_end, error_pos);
+}
+
+qjson_string_status qjson_decode_string(const char* const start,
+                                        const char* const end,
+                                        char* const dst,
+                                        size_t* const length,
+                                        const char** const error_pos)
+{
+    char* dst_end = NULL;
+    switch(decode_json_string(start, end, dst, &dst_end, error_pos))
+    {
+        case STRING_DECODE_OK:
+            *length = (size_t)(dst_end - dst);
+            return QJSON_STRING_OK;
+        case STRING_DECODE_BAD_ESCAPE:
+            return QJSON_STRING_BAD_ESCAPE;
+        case STRING_DECODE_CONTROL_CHARACTER:
+            return QJSON_STRING_CONTROL_CHARACTER;
+        case STRING_DECODE_BAD_UTF8:
+        default:
+            return QJSON_STRING_BAD_UTF8;
+    }
+}
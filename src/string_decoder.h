@@ -0,0 +1,48 @@
+#ifndef string_decoder_H
+#define string_decoder_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+
+// Decodes the contents of JSON strings: escape-free runs are copied a vector
+// at a time, escape sequences (including surrogate pairs) are decoded with
+// table lookups, and the raw bytes are validated as UTF-8 in the same pass.
+// Control characters (below 0x20) must be escaped, as RFC 8259 requires.
+//
+// The instruction set follows the level chosen for the structural indexer
+// (see structural_index.h). Escape sequences are pure ASCII, so validating
+// the raw input is equivalent to validating the decoded output.
+
+typedef enum
+{
+    STRING_DECODE_OK,
+    STRING_DECODE_BAD_ESCAPE,
+    STRING_DECODE_BAD_UTF8,
+    STRING_DECODE_CONTROL_CHARACTER,
+} string_decode_status;
+
+/**
+ * Decode the contents of a JSON string (without the surrounding quotes).
+ * The output is never longer than the input, and may be written over it (dst == src).
+ *
+ * @param src The start of the string contents.
+ * @param src_end The end of the string contents.
+ * @param dst Receives the decoded string. Must have room for src_end - src bytes.
+ * @param dst_end Receives a pointer past the last decoded byte on success.
+ * @param error_pos Receives the offending escape sequence, UTF-8 sequence or control character on failure.
+ * @return The status of the decode.
+ */
+string_decode_status decode_json_string(const char* src,
+                                        const char* src_end,
+                                        char* dst,
+                                        char** dst_end,
+                                        const char** error_pos);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // string_decoder_H
@@ -0,0 +1,117 @@
+#include "string_encoder.h"
+#include "structural_index.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define HAS_X86_KERNELS 1
+    #include <immintrin.h>
+#else
+    #define HAS_X86_KERNELS 0
+#endif
+
+// Strings shorter than this are searched by the scalar kernel without dispatching.
+#define MIN_VECTOR_STRING_LENGTH 16
+#define HIGH_BITS 0x8080808080808080ULL
+#define LOW_BITS 0x0101010101010101ULL
+// Bytes below this are control characters.
+#define FIRST_PRINTABLE 0x20
+
+static inline bool must_escape(const char ch)
+{
+    return (uint8_t)ch < FIRST_PRINTABLE || ch == '"' || ch == '\\';
+}
+
+// Returns nonzero if any byte of chunk is zero.
+static inline uint64_t has_zero_byte(const uint64_t chunk)
+{
+    return (chunk - LOW_BITS) & ~chunk & HIGH_BITS;
+}
+
+static const char* find_scalar(const char* src, const char* const src_end)
+{
+    while(src_end - src >= 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, src, sizeof(chunk));
+        // Bytes below 0x20 borrow when 0x20 is subtracted; bytes with the high bit set are masked out by ~chunk.
+        const uint64_t controls = (chunk - LOW_BITS * FIRST_PRINTABLE) & ~chunk & HIGH_BITS;
+        if((controls | has_zero_byte(chunk ^ (LOW_BITS * '"')) | has_zero_byte(chunk ^ (LOW_BITS * '\\'))) != 0)
+        {
+            break;
+        }
+        src += 8;
+    }
+    while(src < src_end && !must_escape(*src))
+    {
+        src++;
+    }
+    return src;
+}
+
+#if HAS_X86_KERNELS
+
+__attribute__((target("sse2")))
+static const char* find_sse2(const char* src, const char* const src_end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i last_control = _mm_set1_epi8(FIRST_PRINTABLE - 1);
+    while(src_end - src >= 16)
+    {
+        const __m128i input = _mm_loadu_si128((const __m128i*)src);
+        const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(input, last_control), input);
+        const __m128i specials = _mm_or_si128(_mm_cmpeq_epi8(input, quote), _mm_cmpeq_epi8(input, backslash));
+        const unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(controls, specials));
+        if(mask != 0)
+        {
+            return src + __builtin_ctz(mask);
+        }
+        src += 16;
+    }
+    return find_scalar(src, src_end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_avx2(const char* src, const char* const src_end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i last_control = _mm256_set1_epi8(FIRST_PRINTABLE - 1);
+    while(src_end - src >= 32)
+    {
+        const __m256i input = _mm256_loadu_si256((const __m256i*)src);
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(input, last_control), input);
+        const __m256i specials = _mm256_or_si256(_mm256_cmpeq_epi8(input, quote), _mm256_cmpeq_epi8(input, backslash));
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(controls, specials));
+        if(mask != 0)
+        {
+            return src + __builtin_ctz(mask);
+        }
+        src += 32;
+    }
+    return find_sse2(src, src_end);
+}
+
+#endif // HAS_X86_KERNELS
+
+const char* find_byte_to_escape(const char* const src, const char* const src_end)
+{
+#if HAS_X86_KERNELS
+    if(src_end - src >= MIN_VECTOR_STRING_LENGTH)
+    {
+        switch(structural_index_get_simd_level())
+        {
+            case SIMD_LEVEL_AVX2:
+            case SIMD_LEVEL_AVX512:
+                return find_avx2(src, src_end);
+            case SIMD_LEVEL_SSE2:
+                return find_sse2(src, src_end);
+            default:
+                break;
+        }
+    }
+#endif
+    return find_scalar(src, src_end);
+}
@@ -0,0 +1,28 @@
+#ifndef string_encoder_H
+#define string_encoder_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Finds the bytes of a string that the encoder has to escape: quotes,
+// backslashes and control characters. Everything between them is copied
+// as it is, so the search runs a vector at a time.
+//
+// The instruction set follows the level chosen for the structural indexer
+// (see structural_index.h).
+
+/**
+ * Find the first byte in [src, src_end) that must be escaped in a JSON string.
+ *
+ * @param src The start of the string.
+ * @param src_end The end of the string.
+ * @return A pointer to the byte, or src_end if there is none.
+ */
+const char* find_byte_to_escape(const char* src, const char* src_end);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // string_encoder_H
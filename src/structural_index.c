@@ -0,0 +1,347 @@
+#include "structural_index.h"
+#include <pthread.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define HAS_X86_KERNELS 1
+    #include <immintrin.h>
+#else
+    #define HAS_X86_KERNELS 0
+#endif
+
+typedef struct
+{
+    uint64_t whitespace;
+    uint64_t operators;
+    uint64_t quotes;
+    uint64_t backslashes;
+} block_classes;
+
+typedef size_t (*index_window_function)(structural_scanner* scanner,
+                                        const uint8_t* data,
+                                        size_t length,
+                                        uint64_t* structurals,
+                                        uint64_t* backslashes);
+
+enum
+{
+    CLASS_WHITESPACE = 0x01,
+    CLASS_OPERATOR   = 0x02,
+    CLASS_QUOTE      = 0x04,
+    CLASS_BACKSLASH  = 0x08,
+};
+
+static const uint8_t g_char_classes[256] =
+{
+    [' '] = CLASS_WHITESPACE, ['\t'] = CLASS_WHITESPACE, ['\r'] = CLASS_WHITESPACE, ['\n'] = CLASS_WHITESPACE,
+    ['{'] = CLASS_OPERATOR, ['}'] = CLASS_OPERATOR, ['['] = CLASS_OPERATOR, [']'] = CLASS_OPERATOR,
+    [','] = CLASS_OPERATOR, [':'] = CLASS_OPERATOR,
+    ['"'] = CLASS_QUOTE,
+    ['\\'] = CLASS_BACKSLASH,
+};
+
+void structural_scanner_init(structural_scanner* const scanner)
+{
+    scanner->prev_escaped = 0;
+    scanner->prev_in_string = 0;
+    scanner->prev_scalar = 0;
+}
+
+// Finds the characters that are escaped by a preceding odd-length run of backslashes.
+static inline uint64_t find_escaped(uint64_t backslashes, uint64_t* const prev_escaped)
+{
+    if(backslashes == 0 && *prev_escaped == 0)
+    {
+        return 0;
+    }
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    backslashes &= ~*prev_escaped;
+    const uint64_t follows_escape = (backslashes << 1) | *prev_escaped;
+    const uint64_t odd_sequence_starts = backslashes & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = 0;
+    *prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslashes, &sequences_starting_on_even_bits);
+    const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// Sets every bit from an opening quote up to (but not including) its closing quote.
+static inline uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static inline uint64_t find_structurals(structural_scanner* const scanner, const block_classes* const classes)
+{
+    const uint64_t escaped = find_escaped(classes->backslashes, &scanner->prev_escaped);
+    const uint64_t quotes = classes->quotes & ~escaped;
+    const uint64_t in_string = prefix_xor(quotes) ^ scanner->prev_in_string;
+    scanner->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    const uint64_t scalars = ~(classes->operators | classes->whitespace | quotes | in_string);
+    const uint64_t follows_scalar = (scalars << 1) | scanner->prev_scalar;
+    scanner->prev_scalar = scalars >> 63;
+
+    return (classes->operators & ~in_string) | quotes | (scalars & ~follows_scalar);
+}
+
+static inline void classify_block_scalar(const uint8_t* const block, block_classes* const classes)
+{
+    uint64_t whitespace = 0;
+    uint64_t operators = 0;
+    uint64_t quotes = 0;
+    uint64_t backslashes = 0;
+    for(int i = 0; i < STRUCTURAL_BLOCK_SIZE; i++)
+    {
+        const uint64_t bit = 1ULL << i;
+        const uint8_t char_class = g_char_classes[block[i]];
+        whitespace |= (char_class & CLASS_WHITESPACE) ? bit : 0;
+        operators |= (char_class & CLASS_OPERATOR) ? bit : 0;
+        quotes |= (char_class & CLASS_QUOTE) ? bit : 0;
+        backslashes |= (char_class & CLASS_BACKSLASH) ? bit : 0;
+    }
+    classes->whitespace = whitespace;
+    classes->operators = operators;
+    classes->quotes = quotes;
+    classes->backslashes = backslashes;
+}
+
+// Generates a window indexer around a block classifier so that the classifier
+// and the bit manipulation can be inlined together under one target.
+#define DEFINE_INDEX_WINDOW(NAME, CLASSIFY_BLOCK, ATTRIBUTES) \
+ATTRIBUTES static size_t NAME(structural_scanner* const scanner, \
+                              const uint8_t* const data, \
+                              const size_t length, \
+                              uint64_t* const structurals, \
+                              uint64_t* const backslashes) \
+{ \
+    block_classes classes; \
+    size_t block = 0; \
+    size_t offset = 0; \
+    for(; offset + STRUCTURAL_BLOCK_SIZE <= length; offset += STRUCTURAL_BLOCK_SIZE, block++) \
+    { \
+        CLASSIFY_BLOCK(data + offset, &classes); \
+        structurals[block] = find_structurals(scanner, &classes); \
+        if(backslashes != NULL) \
+        { \
+            backslashes[block] = classes.backslashes; \
+        } \
+    } \
+    if(offset < length) \
+    { \
+        uint8_t padded[STRUCTURAL_BLOCK_SIZE]; \
+        memset(padded, ' ', sizeof(padded)); \
+        memcpy(padded, data + offset, length - offset); \
+        CLASSIFY_BLOCK(padded, &classes); \
+        structurals[block] = find_structurals(scanner, &classes); \
+        if(backslashes != NULL) \
+        { \
+            backslashes[block] = classes.backslashes; \
+        } \
+        block++; \
+    } \
+    return block; \
+}
+
+DEFINE_INDEX_WINDOW(index_window_scalar, classify_block_scalar, )
+
+#if HAS_X86_KERNELS
+
+__attribute__((target("sse2")))
+static inline uint64_t movemask_sse2(const __m128i bytes)
+{
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(bytes);
+}
+
+__attribute__((target("sse2")))
+static inline void classify_block_sse2(const uint8_t* const block, block_classes* const classes)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    uint64_t whitespace = 0;
+    uint64_t operators = 0;
+    uint64_t quotes = 0;
+    uint64_t backslashes = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i * 16));
+        // '[' and ']' differ from '{' and '}' only in bit 0x20.
+        const __m128i folded = _mm_or_si128(bytes, case_bit);
+        const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(bytes, lf), _mm_cmpeq_epi8(bytes, cr)));
+        const __m128i ops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open_brace), _mm_cmpeq_epi8(folded, close_brace)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, colon)));
+        whitespace |= movemask_sse2(ws) << (i * 16);
+        operators |= movemask_sse2(ops) << (i * 16);
+        quotes |= movemask_sse2(_mm_cmpeq_epi8(bytes, quote)) << (i * 16);
+        backslashes |= movemask_sse2(_mm_cmpeq_epi8(bytes, backslash)) << (i * 16);
+    }
+    classes->whitespace = whitespace;
+    classes->operators = operators;
+    classes->quotes = quotes;
+    classes->backslashes = backslashes;
+}
+
+// Nibble lookup tables for the shuffle-based classifiers. A byte's class is
+// the AND of its low-nibble and high-nibble entries:
+//   0x01: ' '            0x04: ','           0x10: '[' ']' '{' '}'
+//   0x02: '\t' '\n' '\r' 0x08: ':'
+#define CLASS_TABLE_LOW_NIBBLE \
+    0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x0a, 0x10, 0x04, 0x12, 0, 0
+#define CLASS_TABLE_HIGH_NIBBLE \
+    0x02, 0, 0x05, 0x08, 0, 0x10, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0
+#define CLASS_WHITESPACE_BITS 0x03
+#define CLASS_OPERATOR_BITS 0x1c
+
+__attribute__((target("avx2")))
+static inline void classify_block_avx2(const uint8_t* const block, block_classes* const classes)
+{
+    const __m256i low_table = _mm256_setr_epi8(CLASS_TABLE_LOW_NIBBLE, CLASS_TABLE_LOW_NIBBLE);
+    const __m256i high_table = _mm256_setr_epi8(CLASS_TABLE_HIGH_NIBBLE, CLASS_TABLE_HIGH_NIBBLE);
+    const __m256i low_nibble_mask = _mm256_set1_epi8(0x0f);
+    const __m256i whitespace_bits = _mm256_set1_epi8(CLASS_WHITESPACE_BITS);
+    const __m256i operator_bits = _mm256_set1_epi8(CLASS_OPERATOR_BITS);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    uint64_t whitespace = 0;
+    uint64_t operators = 0;
+    uint64_t quotes = 0;
+    uint64_t backslashes = 0;
+    for(int i = 0; i < 2; i++)
+    {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i*)(block + i * 32));
+        const __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(bytes, low_nibble_mask));
+        const __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble_mask));
+        const __m256i char_class = _mm256_and_si256(low, high);
+        const __m256i ws = _mm256_cmpeq_epi8(_mm256_and_si256(char_class, whitespace_bits), zero);
+        const __m256i ops = _mm256_cmpeq_epi8(_mm256_and_si256(char_class, operator_bits), zero);
+        whitespace |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(ws) << (i * 32);
+        operators |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(ops) << (i * 32);
+        quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)) << (i * 32);
+        backslashes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, backslash)) << (i * 32);
+    }
+    classes->whitespace = whitespace;
+    classes->operators = operators;
+    classes->quotes = quotes;
+    classes->backslashes = backslashes;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void classify_block_avx512(const uint8_t* const block, block_classes* const classes)
+{
+    const __m512i low_table = _mm512_broadcast_i32x4(_mm_setr_epi8(CLASS_TABLE_LOW_NIBBLE));
+    const __m512i high_table = _mm512_broadcast_i32x4(_mm_setr_epi8(CLASS_TABLE_HIGH_NIBBLE));
+    const __m512i low_nibble_mask = _mm512_set1_epi8(0x0f);
+
+    const __m512i bytes = _mm512_loadu_si512((const void*)block);
+    const __m512i low = _mm512_shuffle_epi8(low_table, _mm512_and_si512(bytes, low_nibble_mask));
+    const __m512i high = _mm512_shuffle_epi8(high_table, _mm512_and_si512(_mm512_srli_epi16(bytes, 4), low_nibble_mask));
+    const __m512i char_class = _mm512_and_si512(low, high);
+    classes->whitespace = _mm512_test_epi8_mask(char_class, _mm512_set1_epi8(CLASS_WHITESPACE_BITS));
+    classes->operators = _mm512_test_epi8_mask(char_class, _mm512_set1_epi8(CLASS_OPERATOR_BITS));
+    classes->quotes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('"'));
+    classes->backslashes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\\'));
+}
+
+DEFINE_INDEX_WINDOW(index_window_sse2, classify_block_sse2, __attribute__((target("sse2"))))
+DEFINE_INDEX_WINDOW(index_window_avx2, classify_block_avx2, __attribute__((target("avx2"))))
+DEFINE_INDEX_WINDOW(index_window_avx512, classify_block_avx512, __attribute__((target("avx512f,avx512bw"))))
+
+#endif // HAS_X86_KERNELS
+
+static bool is_simd_level_supported(const simd_level level)
+{
+    switch(level)
+    {
+        case SIMD_LEVEL_SCALAR:
+            return true;
+#if HAS_X86_KERNELS
+        case SIMD_LEVEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case SIMD_LEVEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case SIMD_LEVEL_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+        default:
+            return false;
+    }
+}
+
+static simd_level g_simd_level = SIMD_LEVEL_SCALAR;
+static index_window_function g_index_window = index_window_scalar;
+static pthread_once_t g_simd_level_once = PTHREAD_ONCE_INIT;
+
+static void apply_simd_level(const simd_level level)
+{
+    g_simd_level = level;
+    switch(level)
+    {
+#if HAS_X86_KERNELS
+        case SIMD_LEVEL_SSE2:   g_index_window = index_window_sse2; break;
+        case SIMD_LEVEL_AVX2:   g_index_window = index_window_avx2; break;
+        case SIMD_LEVEL_AVX512: g_index_window = index_window_avx512; break;
+#endif
+        default:                g_index_window = index_window_scalar; break;
+    }
+}
+
+static void detect_simd_level(void)
+{
+#if HAS_X86_KERNELS
+    __builtin_cpu_init();
+#endif
+    for(int level = SIMD_LEVEL_AVX512; level > SIMD_LEVEL_SCALAR; level--)
+    {
+        if(is_simd_level_supported((simd_level)level))
+        {
+            apply_simd_level((simd_level)level);
+            return;
+        }
+    }
+    apply_simd_level(SIMD_LEVEL_SCALAR);
+}
+
+simd_level structural_index_get_simd_level(void)
+{
+    pthread_once(&g_simd_level_once, detect_simd_level);
+    return g_simd_level;
+}
+
+bool structural_index_set_simd_level(const simd_level level)
+{
+    pthread_once(&g_simd_level_once, detect_simd_level);
+    if(!is_simd_level_supported(level))
+    {
+        return false;
+    }
+    apply_simd_level(level);
+    return true;
+}
+
+size_t structural_index_window(structural_scanner* const scanner,
+                               const char* const data,
+                               const size_t length,
+                               uint64_t* const structurals,
+                               uint64_t* const backslashes)
+{
+    pthread_once(&g_simd_level_once, detect_simd_level);
+    return g_index_window(scanner, (const uint8_t*)data, length, structurals, backslashes);
+}
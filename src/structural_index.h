@@ -0,0 +1,72 @@
+#ifndef structural_index_H
+#define structural_index_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stage 1 of the parser: classifies the input 64 bytes at a time and builds a
+// bitmap marking every structural character outside of strings, every
+// unescaped quote, and the first byte of every scalar (number or literal).
+// The parser uses the bitmap to jump over whitespace and string contents
+// rather than stepping through them a byte at a time.
+
+#define STRUCTURAL_BLOCK_SIZE 64
+
+typedef enum
+{
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2,
+    SIMD_LEVEL_AVX512,
+} simd_level;
+
+// Scanner state carried from one block to the next.
+typedef struct
+{
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;
+    uint64_t prev_scalar;
+} structural_scanner;
+
+void structural_scanner_init(structural_scanner* scanner);
+
+/**
+ * Index the next run of input, continuing from the scanner's current state.
+ * Bit n of mask word i corresponds to byte i * STRUCTURAL_BLOCK_SIZE + n of the input.
+ *
+ * @param scanner The scanner state, which must have been fed all preceding input.
+ * @param data The start of the input.
+ * @param length The number of bytes to index. Must be a multiple of STRUCTURAL_BLOCK_SIZE unless this is the end of the input.
+ * @param structurals Receives one mask word per block with the structural positions set.
+ * @param backslashes Receives one mask word per block with the position of every backslash set. May be NULL.
+ * @return The number of mask words written.
+ */
+size_t structural_index_window(structural_scanner* scanner,
+                               const char* data,
+                               size_t length,
+                               uint64_t* structurals,
+                               uint64_t* backslashes);
+
+/**
+ * Get the instruction set that stage 1 is using.
+ * The best level supported by the CPU is chosen on first use.
+ */
+simd_level structural_index_get_simd_level(void);
+
+/**
+ * Force stage 1 to use a particular instruction set (intended for testing).
+ *
+ * @return false if the CPU does not support the requested level.
+ */
+bool structural_index_set_simd_level(simd_level level);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // structural_index_H
@@ -0,0 +1,427 @@
+#include "json_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Tape representation of a parsed document.
+//
+// A document is a single array of 64-bit words, written front to back as the
+// parser delivers events. Each value starts with a word holding a tag in its
+// top byte and a 56-bit payload:
+//
+//   null, true, false   1 word, no payload.
+//   int, float          Tag word, then the raw 64-bit value.
+//   string              Tag word with the length, then the null terminated
+//                       bytes, padded with zeros to a whole number of words.
+//   list, map           Tag word holding the distance to the matching end
+//                       word, then the entries, then an end word holding the
+//                       number of elements (or key-value pairs).
+//
+// The root value is followed by a zero word, which marks the end of the tape.
+//
+// Since the size of every value can be read from its first word, walking a
+// container never looks outside of it, and skipping one is a single load.
+
+#define TAG_SHIFT 56
+#define PAYLOAD_MASK ((1ULL << TAG_SHIFT) - 1)
+#define INITIAL_TAPE_CAPACITY 256
+#define INITIAL_CONTAINER_CAPACITY 16
+
+typedef enum
+{
+    TAG_TAPE_END = 0,
+    TAG_NULL = 'n',
+    TAG_TRUE = 't',
+    TAG_FALSE = 'f',
+    TAG_INT = 'l',
+    TAG_FLOAT = 'd',
+    TAG_STRING = '"',
+    TAG_LIST_START = '[',
+    TAG_LIST_END = ']',
+    TAG_MAP_START = '{',
+    TAG_MAP_END = '}',
+} tape_tag;
+
+typedef struct
+{
+    size_t start;
+    size_t count;
+} open_container;
+
+struct qjson_document
+{
+    uint64_t* tape;
+    size_t tape_length;
+    size_t tape_capacity;
+    open_container* containers;
+    size_t container_count;
+    size_t container_capacity;
+    bool is_out_of_memory;
+    bool has_error;
+    char error_message[ERROR_MESSAGE_SIZE];
+};
+
+static inline uint64_t make_word(const tape_tag tag, const uint64_t payload)
+{
+    return ((uint64_t)tag << TAG_SHIFT) | payload;
+}
+
+static inline tape_tag get_tag(const uint64_t word)
+{
+    return (tape_tag)(word >> TAG_SHIFT);
+}
+
+static inline size_t get_payload(const uint64_t word)
+{
+    return (size_t)(word & PAYLOAD_MASK);
+}
+
+static inline size_t string_word_count(const size_t length)
+{
+    // Room for the null terminator.
+    return length / sizeof(uint64_t) + 1;
+}
+
+// Returns room for count more words at the end of the tape, or NULL if memory could not be allocated.
+static uint64_t* reserve_words(qjson_document* const document, const size_t count)
+{
+    const size_t required = document->tape_length + count;
+    if(required > document->tape_capacity)
+    {
+        if(document->is_out_of_memory)
+        {
+            return NULL;
+        }
+        size_t new_capacity = document->tape_capacity > 0 ? document->tape_capacity * 2 : INITIAL_TAPE_CAPACITY;
+        if(new_capacity < required)
+        {
+            new_capacity = required;
+        }
+        uint64_t* const new_tape = realloc(document->tape, new_capacity * sizeof(*new_tape));
+        if(new_tape == NULL)
+        {
+            document->is_out_of_memory = true;
+            return NULL;
+        }
+        document->tape = new_tape;
+        document->tape_capacity = new_capacity;
+    }
+    uint64_t* const words = document->tape + document->tape_length;
+    document->tape_length = required;
+    return words;
+}
+
+static inline void count_entry(qjson_document* const document)
+{
+    if(document->container_count > 0)
+    {
+        document->containers[document->container_count - 1].count++;
+    }
+}
+
+static void add_word(qjson_document* const document, const uint64_t word)
+{
+    uint64_t* const words = reserve_words(document, 1);
+    if(words != NULL)
+    {
+        words[0] = word;
+        count_entry(document);
+    }
+}
+
+static void add_word_pair(qjson_document* const document, const uint64_t first, const uint64_t second)
+{
+    uint64_t* const words = reserve_words(document, 2);
+    if(words != NULL)
+    {
+        words[0] = first;
+        words[1] = second;
+        count_entry(document);
+    }
+}
+
+static void on_parse_error(void* const context, const char* const message)
+{
+    qjson_document* const document = (qjson_document*)context;
+    document->has_error = true;
+    strncpy(document->error_message, message, sizeof(document->error_message) - 1);
+    document->error_message[sizeof(document->error_message) - 1] = 0;
+}
+
+static void on_null(void* const context)
+{
+    add_word((qjson_document*)context, make_word(TAG_NULL, 0));
+}
+
+static void on_boolean(void* const context, const bool value)
+{
+    add_word((qjson_document*)context, make_word(value ? TAG_TRUE : TAG_FALSE, 0));
+}
+
+static void on_int(void* const context, const int64_t value)
+{
+    add_word_pair((qjson_document*)context, make_word(TAG_INT, 0), (uint64_t)value);
+}
+
+static void on_float(void* const context, const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    add_word_pair((qjson_document*)context, make_word(TAG_FLOAT, 0), bits);
+}
+
+static void on_string(void* const context, const char* const value)
+{
+    qjson_document* const document = (qjson_document*)context;
+    const size_t length = strlen(value);
+    const size_t word_count = string_word_count(length);
+    uint64_t* const words = reserve_words(document, 1 + word_count);
+    if(words != NULL)
+    {
+        words[0] = make_word(TAG_STRING, length);
+        // Zero the last word first, which pads the string and terminates it.
+        words[word_count] = 0;
+        memcpy(words + 1, value, length);
+        count_entry(document);
+    }
+}
+
+static void start_container(qjson_document* const document, const tape_tag tag)
+{
+    if(document->container_count >= document->container_capacity)
+    {
+        size_t new_capacity = document->container_capacity > 0 ? document->container_capacity * 2 : INITIAL_CONTAINER_CAPACITY;
+        open_container* const new_containers = realloc(document->containers, new_capacity * sizeof(*new_containers));
+        if(new_containers == NULL)
+        {
+            document->is_out_of_memory = true;
+            return;
+        }
+        document->containers = new_containers;
+        document->container_capacity = new_capacity;
+    }
+    count_entry(document);
+    open_container* const container = &document->containers[document->container_count++];
+    container->start = document->tape_length;
+    container->count = 0;
+    // The payload is filled in when the container ends.
+    if(reserve_words(document, 1) != NULL)
+    {
+        document->tape[container->start] = make_word(tag, 0);
+    }
+}
+
+static void end_container(qjson_document* const document, const tape_tag tag)
+{
+    if(document->is_out_of_memory)
+    {
+        return;
+    }
+    const open_container container = document->containers[--document->container_count];
+    const size_t entry_count = tag == TAG_MAP_END ? container.count / 2 : container.count;
+    uint64_t* const words = reserve_words(document, 1);
+    if(words != NULL)
+    {
+        words[0] = make_word(tag, entry_count);
+        document->tape[container.start] |= (uint64_t)(words - (document->tape + container.start));
+    }
+}
+
+static void on_list_start(void* const context)
+{
+    start_container((qjson_document*)context, TAG_LIST_START);
+}
+
+static void on_list_end(void* const context)
+{
+    end_container((qjson_document*)context, TAG_LIST_END);
+}
+
+static void on_map_start(void* const context)
+{
+    start_container((qjson_document*)context, TAG_MAP_START);
+}
+
+static void on_map_end(void* const context)
+{
+    end_container((qjson_document*)context, TAG_MAP_END);
+}
+
+static const qjson_parse_callbacks g_tape_callbacks =
+{
+    .on_parse_error = on_parse_error,
+    .on_null        = on_null,
+    .on_boolean     = on_boolean,
+    .on_int         = on_int,
+    .on_float       = on_float,
+    .on_string      = on_string,
+    .on_list_start  = on_list_start,
+    .on_list_end    = on_list_end,
+    .on_map_start   = on_map_start,
+    .on_map_end     = on_map_end,
+};
+
+qjson_document* qjson_new_document(void)
+{
+    return calloc(1, sizeof(qjson_document));
+}
+
+void qjson_free_document(qjson_document* const document)
+{
+    if(document != NULL)
+    {
+        free(document->tape);
+        free(document->containers);
+        free(document);
+    }
+}
+
+bool qjson_parse_into_document(qjson_document* const document, const char* const data, const size_t length)
+{
+    document->tape_length = 0;
+    document->container_count = 0;
+    document->is_out_of_memory = false;
+    document->has_error = false;
+
+    if(qjson_parse_buffer(data, length, &g_tape_callbacks, document))
+    {
+        add_word(document, make_word(TAG_TAPE_END, 0));
+    }
+    if(document->is_out_of_memory && !document->has_error)
+    {
+        on_parse_error(document, "Out of memory");
+    }
+    return !document->has_error;
+}
+
+const char* qjson_document_error(const qjson_document* const document)
+{
+    return document->has_error ? document->error_message : NULL;
+}
+
+qjson_value qjson_document_root(const qjson_document* const document)
+{
+    qjson_value value = {NULL};
+    if(!document->has_error && document->tape_length > 0)
+    {
+        value.word = document->tape;
+    }
+    return value;
+}
+
+qjson_type qjson_value_type(const qjson_value value)
+{
+    if(value.word == NULL)
+    {
+        return QJSON_TYPE_NONE;
+    }
+    switch(get_tag(*value.word))
+    {
+        case TAG_NULL:       return QJSON_TYPE_NULL;
+        case TAG_TRUE:
+        case TAG_FALSE:      return QJSON_TYPE_BOOLEAN;
+        case TAG_INT:        return QJSON_TYPE_INT;
+        case TAG_FLOAT:      return QJSON_TYPE_FLOAT;
+        case TAG_STRING:     return QJSON_TYPE_STRING;
+        case TAG_LIST_START: return QJSON_TYPE_LIST;
+        case TAG_MAP_START:  return QJSON_TYPE_MAP;
+        default:             return QJSON_TYPE_NONE;
+    }
+}
+
+bool qjson_value_boolean(const qjson_value value)
+{
+    return get_tag(*value.word) == TAG_TRUE;
+}
+
+int64_t qjson_value_int(const qjson_value value)
+{
+    return (int64_t)value.word[1];
+}
+
+double qjson_value_float(const qjson_value value)
+{
+    double result;
+    memcpy(&result, &value.word[1], sizeof(result));
+    return result;
+}
+
+const char* qjson_value_string(const qjson_value value, size_t* const length)
+{
+    if(length != NULL)
+    {
+        *length = get_payload(*value.word);
+    }
+    return (const char*)(value.word + 1);
+}
+
+static inline const uint64_t* container_end(const qjson_value value)
+{
+    return value.word + get_payload(*value.word);
+}
+
+size_t qjson_value_count(const qjson_value value)
+{
+    return get_payload(*container_end(value));
+}
+
+qjson_value qjson_value_first(const qjson_value value)
+{
+    qjson_value first = {NULL};
+    const qjson_type type = qjson_value_type(value);
+    if((type == QJSON_TYPE_LIST || type == QJSON_TYPE_MAP) && value.word + 1 != container_end(value))
+    {
+        first.word = value.word + 1;
+    }
+    return first;
+}
+
+qjson_value qjson_value_next(const qjson_value value)
+{
+    qjson_value next = {NULL};
+    if(value.word == NULL)
+    {
+        return next;
+    }
+    const uint64_t word = *value.word;
+    switch(get_tag(word))
+    {
+        case TAG_INT:
+        case TAG_FLOAT:
+            next.word = value.word + 2;
+            break;
+        case TAG_STRING:
+            next.word = value.word + 1 + string_word_count(get_payload(word));
+            break;
+        case TAG_LIST_START:
+        case TAG_MAP_START:
+            next.word = container_end(value) + 1;
+            break;
+        case TAG_NULL:
+        case TAG_TRUE:
+        case TAG_FALSE:
+            next.word = value.word + 1;
+            break;
+        default:
+            return next;
+    }
+    const tape_tag next_tag = get_tag(*next.word);
+    if(next_tag == TAG_LIST_END || next_tag == TAG_MAP_END || next_tag == TAG_TAPE_END)
+    {
+        next.word = NULL;
+    }
+    return next;
+}
+
+qjson_value qjson_value_field(const qjson_value value, const char* const key)
+{
+    const size_t key_length = strlen(key);
+    for(qjson_value entry = qjson_value_first(value); entry.word != NULL; entry = qjson_value_next(qjson_value_next(entry)))
+    {
+        if(get_payload(*entry.word) == key_length && memcmp(entry.word + 1, key, key_length) == 0)
+        {
+            return qjson_value_next(entry);
+        }
+    }
+    const qjson_value missing = {NULL};
+    return missing;
+}
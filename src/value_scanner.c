@@ -0,0 +1,162 @@
+#include "value_scanner.h"
+#include "string_decoder.h"
+#include "structural_index.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Windows start small, since most skipped containers are short, and grow up to the size of the mask buffer.
+#define FIRST_SKIP_WINDOW_SIZE STRUCTURAL_BLOCK_SIZE
+#define MAX_SKIP_WINDOW_SIZE (64 * STRUCTURAL_BLOCK_SIZE)
+#define KEY_BUFFER_SIZE 256
+
+static const uint8_t g_is_whitespace[256] =
+{
+    [' '] = 1, ['\t'] = 1, ['\r'] = 1, ['\n'] = 1,
+};
+
+// Characters that end a scalar.
+static const uint8_t g_is_delimiter[256] =
+{
+    [' '] = 1, ['\t'] = 1, ['\r'] = 1, ['\n'] = 1,
+    [','] = 1, [':'] = 1, [']'] = 1, ['}'] = 1,
+    ['['] = 1, ['{'] = 1, ['"'] = 1,
+};
+
+const char* skip_json_whitespace(const char* pos, const char* const end)
+{
+    while(pos < end && g_is_whitespace[(uint8_t)*pos])
+    {
+        pos++;
+    }
+    return pos;
+}
+
+bool is_json_value_end(const char* const pos, const char* const end)
+{
+    return pos >= end || g_is_delimiter[(uint8_t)*pos];
+}
+
+const char* find_json_string_end(const char* pos, const char* const end)
+{
+    while(pos < end)
+    {
+        const char ch = *pos;
+        if(ch == '"')
+        {
+            return pos;
+        }
+        pos += ch == '\\' ? 2 : 1;
+    }
+    return NULL;
+}
+
+// Returns a pointer past the bracket that closes the container opening at pos, or NULL if there is none.
+static const char* skip_container(const char* const pos, const char* const end)
+{
+    uint64_t structurals[MAX_SKIP_WINDOW_SIZE / STRUCTURAL_BLOCK_SIZE];
+    structural_scanner scanner;
+    structural_scanner_init(&scanner);
+    int depth = 0;
+    const char* window = pos;
+    size_t window_size = FIRST_SKIP_WINDOW_SIZE;
+
+    while(window < end)
+    {
+        const size_t length = (size_t)(end - window) < window_size ? (size_t)(end - window) : window_size;
+        const size_t block_count = structural_index_window(&scanner, window, length, structurals, NULL);
+        for(size_t block = 0; block < block_count; block++)
+        {
+            for(uint64_t bits = structurals[block]; bits != 0; bits &= bits - 1)
+            {
+                const char* const structural = window + block * STRUCTURAL_BLOCK_SIZE + __builtin_ctzll(bits);
+                switch(*structural)
+                {
+                    case '[':
+                    case '{':
+                        depth++;
+                        break;
+                    case ']':
+                    case '}':
+                        if(--depth == 0)
+                        {
+                            return structural + 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        window += length;
+        if(window_size < MAX_SKIP_WINDOW_SIZE)
+        {
+            window_size *= 4;
+        }
+    }
+    return NULL;
+}
+
+const char* skip_json_value(const char* const pos, const char* const end)
+{
+    if(pos >= end)
+    {
+        return NULL;
+    }
+    switch(*pos)
+    {
+        case '[':
+        case '{':
+            return skip_container(pos, end);
+        case '"':
+        {
+            const char* const string_end = find_json_string_end(pos + 1, end);
+            return string_end != NULL ? string_end + 1 : NULL;
+        }
+        case ',':
+        case ':':
+        case ']':
+        case '}':
+            return NULL;
+        default:
+        {
+            const char* scalar_end = pos + 1;
+            while(!is_json_value_end(scalar_end, end))
+            {
+                scalar_end++;
+            }
+            return scalar_end;
+        }
+    }
+}
+
+bool json_key_equals(const char* const start, const char* const end, const char* const key, const size_t key_length)
+{
+    const size_t raw_length = end - start;
+    if(memchr(start, '\\', raw_length) == NULL)
+    {
+        return raw_length == key_length && memcmp(start, key, key_length) == 0;
+    }
+    // Unescaping never makes a string longer.
+    if(raw_length < key_length)
+    {
+        return false;
+    }
+
+    char inline_buffer[KEY_BUFFER_SIZE];
+    char* const buffer = raw_length <= sizeof(inline_buffer) ? inline_buffer : malloc(raw_length);
+    if(buffer == NULL)
+    {
+        return false;
+    }
+    char* decoded_end = NULL;
+    const char* error_pos = NULL;
+    const bool is_match = decode_json_string(start, end, buffer, &decoded_end, &error_pos) == STRING_DECODE_OK &&
+                          (size_t)(decoded_end - buffer) == key_length &&
+                          memcmp(buffer, key, key_length) == 0;
+    if(buffer != inline_buffer)
+    {
+        free(buffer);
+    }
+    return is_match;
+}
@@ -0,0 +1,60 @@
+#ifndef value_scanner_H
+#define value_scanner_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lightweight scanning of unparsed JSON values.
+//
+// These functions find where values end without parsing them: scalars are
+// stepped over up to their delimiters, strings up to their closing quote, and
+// containers by counting brackets in the structural index (see
+// structural_index.h), which already excludes brackets inside strings.
+// Nothing is validated beyond what is needed to find the end.
+
+/**
+ * Skip JSON whitespace.
+ *
+ * @return The first non-whitespace character at or after pos, or end.
+ */
+const char* skip_json_whitespace(const char* pos, const char* end);
+
+/**
+ * Check whether pos is where a scalar must end: at a delimiter or the end of the input.
+ */
+bool is_json_value_end(const char* pos, const char* end);
+
+/**
+ * Find the closing quote of the string whose contents begin at pos.
+ *
+ * @return The closing quote, or NULL if the string is unterminated.
+ */
+const char* find_json_string_end(const char* pos, const char* end);
+
+/**
+ * Skip over the value starting at pos.
+ *
+ * @return A pointer past the value, or NULL if pos is not at a value or the value is unterminated.
+ */
+const char* skip_json_value(const char* pos, const char* end);
+
+/**
+ * Compare the raw (still escaped) contents of a string with an unescaped key.
+ *
+ * @param start The start of the string contents.
+ * @param end The closing quote.
+ * @param key The key to compare with.
+ * @param key_length The length of the key.
+ * @return true if the string decodes to the key.
+ */
+bool json_key_equals(const char* start, const char* end, const char* key, size_t key_length);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // value_scanner_H
@@ -1,5 +1,6 @@
 #include "parse_test_helpers.h"
 #include "managed_allocator.h"
+#include <inttypes.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <stdio.h>
@@ -140,3 +141,88 @@ qjson_parse_callbacks parse_new_callbacks()
         callbacks.on_map_end = on_map_end;
 	return callbacks;	
 }
+
+
+qjson_action text_recorder_add(void* recorder, const char* text)
+{
+    const text_recorder* const target = (const text_recorder*)recorder;
+    return target->on_text(target->context, text);
+}
+
+void* text_recorder_get_context(void* recorder)
+{
+    return ((text_recorder*)recorder)->context;
+}
+
+static void record_parse_error(void* context, const char* message)
+{
+    const text_recorder* const recorder = (const text_recorder*)context;
+    recorder->on_parse_error(recorder->context, message);
+}
+
+static qjson_action record_null(void* context)                { return text_recorder_add(context, "n "); }
+static qjson_action record_boolean(void* context, bool value) { return text_recorder_add(context, value ? "t " : "f "); }
+static qjson_action record_list_start(void* context)          { return text_recorder_add(context, "[ "); }
+static qjson_action record_list_end(void* context)            { return text_recorder_add(context, "] "); }
+static qjson_action record_map_start(void* context)           { return text_recorder_add(context, "{ "); }
+static qjson_action record_map_end(void* context)             { return text_recorder_add(context, "} "); }
+
+static qjson_action record_int(void* context, int64_t value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%" PRId64 " ", value);
+    return text_recorder_add(context, text);
+}
+
+static qjson_action record_float(void* context, double value)
+{
+    // Room for the largest double in %f notation.
+    char text[400];
+    snprintf(text, sizeof(text), "%f ", value);
+    return text_recorder_add(context, text);
+}
+
+static qjson_action record_string(void* context, const char* str)
+{
+    const size_t length = strlen(str);
+    char* const text = (char*)malloc(length + 4);
+    text[0] = '"';
+    memcpy(text + 1, str, length);
+    memcpy(text + 1 + length, "\" ", 3);
+    const qjson_action action = text_recorder_add(context, text);
+    free(text);
+    return action;
+}
+
+// The plain callbacks have no action to return.
+static void on_null_text(void* context)                    { record_null(context); }
+static void on_boolean_text(void* context, bool value)     { record_boolean(context, value); }
+static void on_int_text(void* context, int64_t value)      { record_int(context, value); }
+static void on_float_text(void* context, double value)     { record_float(context, value); }
+static void on_string_text(void* context, const char* str) { record_string(context, str); }
+static void on_list_start_text(void* context)              { record_list_start(context); }
+static void on_list_end_text(void* context)                { record_list_end(context); }
+static void on_map_start_text(void* context)               { record_map_start(context); }
+static void on_map_end_text(void* context)                 { record_map_end(context); }
+
+qjson_parse_callbacks text_recorder_new_callbacks()
+{
+    qjson_parse_callbacks callbacks =
+    {
+        record_parse_error, on_null_text, on_boolean_text, on_int_text, on_float_text, on_string_text,
+        on_list_start_text, on_list_end_text, on_map_start_text, on_map_end_text,
+    };
+    return callbacks;
+}
+
+qjson_action_callbacks text_recorder_new_action_callbacks()
+{
+    qjson_action_callbacks callbacks =
+    {
+        QJSON_ACTION_CALLBACKS_VERSION,
+        record_parse_error, record_null, record_boolean, record_int, record_float, record_string,
+        record_list_start, record_list_end, record_map_start, record_map_end,
+        NULL, NULL, NULL,
+    };
+    return callbacks;
+}
@@ -45,6 +45,24 @@ void parse_add_bool(parse_test_context* context, bool value);
 
 qjson_parse_callbacks parse_new_callbacks();
 
+// Renders events as text, each followed by a space: n, t, f, numbers, "strings", and brackets.
+// The parse context given to the parser must point to a text_recorder.
+typedef struct
+{
+    // Receives each rendered event, and returns the action to take (ignored by plain callbacks).
+    qjson_action (*on_text)        (void* context, const char* text);
+    void         (*on_parse_error) (void* context, const char* message);
+    // Passed to on_text and on_parse_error.
+    void* context;
+} text_recorder;
+
+qjson_parse_callbacks text_recorder_new_callbacks();
+qjson_action_callbacks text_recorder_new_action_callbacks();
+// Hands text to a recorder, for callbacks that render events of their own. recorder is the parse context.
+qjson_action text_recorder_add(void* recorder, const char* text);
+// Gets the context of the recorder that is the parse context.
+void* text_recorder_get_context(void* recorder);
+
 
 #ifdef __cplusplus 
 }
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <string>
+
+// Collects the delivered events as text, and answers the event with the given index with an action.
+struct actions_context
+{
+    std::string events;
+    std::string error;
+    int event_count = 0;
+    int action_event = -1;
+    qjson_action action = QJSON_CONTINUE;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    actions_context* actions = (actions_context*)context;
+    actions->events += text;
+    return actions->event_count++ == actions->action_event ? actions->action : QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((actions_context*)context)->error = message; }
+
+static const qjson_action_callbacks g_callbacks = text_recorder_new_action_callbacks();
+
+static actions_context parse(const std::string& json, int action_event, qjson_action action, bool expect_success = true)
+{
+    actions_context context;
+    context.action_event = action_event;
+    context.action = action;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    EXPECT_EQ(expect_success, qjson_parse_buffer_with_actions(json.data(), json.size(), &g_callbacks, &recorder)) << context.error;
+    return context;
+}
+
+static actions_context parse_in_chunks(const std::string& json, size_t chunk_size, int action_event, qjson_action action)
+{
+    actions_context context;
+    context.action_event = action_event;
+    context.action = action;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_parser* parser = qjson_new_parser(NULL, NULL);
+    qjson_reset_parser_with_actions(parser, &g_callbacks, &recorder);
+    for(size_t offset = 0; offset < json.size(); offset += chunk_size)
+    {
+        size_t length = std::min(chunk_size, json.size() - offset);
+        EXPECT_TRUE(qjson_feed_parser(parser, json.data() + offset, length)) << context.error;
+    }
+    EXPECT_TRUE(qjson_finish_parser(parser)) << context.error;
+    qjson_free_parser(parser);
+    return context;
+}
+
+TEST(QJson_Actions, continue)
+{
+    ASSERT_EQ("{ \"a\" [ 1 t n ] } ", parse("{\"a\": [1, true, null]}", -1, QJSON_CONTINUE).events);
+}
+
+TEST(QJson_Actions, stop)
+{
+    ASSERT_EQ("{ \"a\" 1 ", parse("{\"a\": 1, \"b\": 2}", 2, QJSON_STOP).events);
+    // Nothing after the stop is looked at, including malformed input.
+    ASSERT_EQ("[ 1 ", parse("[1, 2, 3 !!!", 1, QJSON_STOP).events);
+}
+
+TEST(QJson_Actions, skip_at_container_start)
+{
+    ASSERT_EQ("{ \"a\" [ ] \"b\" 2 } ", parse("{\"a\": [1, [2, {\"x\": 3}], \"]\"], \"b\": 2}", 2, QJSON_SKIP_CONTAINER).events);
+    ASSERT_EQ("[ { } 4 ] ", parse("[{\"a\": {\"b\": \"}}\\\"}\"}}, 4]", 1, QJSON_SKIP_CONTAINER).events);
+}
+
+TEST(QJson_Actions, skip_rest_of_container)
+{
+    ASSERT_EQ("[ [ 1 ] 4 ] ", parse("[[1, 2, 3], 4]", 2, QJSON_SKIP_CONTAINER).events);
+    // Skipping at a map key skips its value too.
+    ASSERT_EQ("{ \"a\" } ", parse("{\"a\": {\"b\": 1}, \"c\": 2}", 1, QJSON_SKIP_CONTAINER).events);
+    // Skipping at the end of a container skips the rest of its parent.
+    ASSERT_EQ("[ [ 1 ] ] ", parse("[[1], 2, 3]", 3, QJSON_SKIP_CONTAINER).events);
+}
+
+TEST(QJson_Actions, skip_at_top_level)
+{
+    ASSERT_EQ("[ 1 ] ", parse("[1]", 2, QJSON_SKIP_CONTAINER).events);
+    ASSERT_EQ("5 ", parse(" 5 ", 0, QJSON_SKIP_CONTAINER).events);
+}
+
+TEST(QJson_Actions, skipped_values_are_not_converted)
+{
+    ASSERT_EQ("[ ] ", parse("[1e999999, \"\\q\", tru]", 0, QJSON_SKIP_CONTAINER).events);
+}
+
+TEST(QJson_Actions, skip_large_container)
+{
+    std::string json = "{\"skip\": [";
+    for(int i = 0; i < 1000; i++)
+    {
+        json += "{\"s\": \"[{\\\"]}\", \"n\": [1, 2.5, null]}, ";
+    }
+    json += "0], \"keep\": true}";
+    ASSERT_EQ("{ \"skip\" [ ] \"keep\" t } ", parse(json, 2, QJSON_SKIP_CONTAINER).events);
+
+    for(size_t chunk_size: {1, 3, 7, 64, 1000})
+    {
+        ASSERT_EQ("{ \"skip\" [ ] \"keep\" t } ", parse_in_chunks(json, chunk_size, 2, QJSON_SKIP_CONTAINER).events)
+            << "chunk size " << chunk_size;
+    }
+}
+
+TEST(QJson_Actions, stop_in_chunks)
+{
+    ASSERT_EQ("[ \"a\" ", parse_in_chunks("[\"a\", \"b\", \"c\"]", 2, 1, QJSON_STOP).events);
+}
+
+TEST(QJson_Actions, errors)
+{
+    ASSERT_EQ("Unexpected end of document at offset 12", parse("[[1, [2, 3]]", 1, QJSON_SKIP_CONTAINER, false).error);
+    ASSERT_EQ("Bad encoding: unterminated string at offset 5", parse("[[1, \"]]", 1, QJSON_SKIP_CONTAINER, false).error);
+    ASSERT_EQ("Unexpected token: '}' at offset 10", parse("[1, [2, 3]}", 1, QJSON_SKIP_CONTAINER, false).error);
+    ASSERT_EQ("Unexpected token: 'x' at offset 4", parse("[1] x", 0, QJSON_SKIP_CONTAINER, false).error);
+}
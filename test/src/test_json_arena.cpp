@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <map>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Collects the delivered events as text.
+struct arena_context
+{
+    std::string events;
+    std::string error;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    ((arena_context*)context)->events += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((arena_context*)context)->error = message; }
+
+static const qjson_parse_callbacks g_callbacks = text_recorder_new_callbacks();
+
+static arena_context parse_in_arena(const std::string& json, size_t arena_size, bool expect_success = true)
+{
+    arena_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    std::vector<char> arena(arena_size);
+    EXPECT_EQ(expect_success, qjson_parse_buffer_in_arena(json.data(), json.size(), &g_callbacks, &recorder, arena.data(), arena.size()))
+        << context.error;
+    return context;
+}
+
+static std::string nested_lists(int depth)
+{
+    return std::string(depth, '[') + std::string(depth, ']');
+}
+
+static std::string expected_nested_lists(int depth)
+{
+    std::string expected;
+    for(int i = 0; i < depth; i++)
+    {
+        expected += "[ ";
+    }
+    for(int i = 0; i < depth; i++)
+    {
+        expected += "] ";
+    }
+    return expected;
+}
+
+// Hands out malloc'd blocks, keeping track of which ones are still live.
+struct counting_allocator
+{
+    std::map<void*, size_t> live;
+    size_t allocation_count = 0;
+};
+
+static void* counting_allocate(void* context, size_t size)
+{
+    counting_allocator* allocator = (counting_allocator*)context;
+    void* memory = malloc(size);
+    allocator->live[memory] = size;
+    allocator->allocation_count++;
+    return memory;
+}
+
+static void counting_free(void* context, void* memory)
+{
+    counting_allocator* allocator = (counting_allocator*)context;
+    EXPECT_EQ(1u, allocator->live.erase(memory));
+    free(memory);
+}
+
+TEST(QJson_Arena, small_document)
+{
+    ASSERT_EQ("{ \"a\" [ 1 2.500000 \"x\" n t ] } ", parse_in_arena("{\"a\": [1, 2.5, \"x\", null, true]}", 4096).events);
+}
+
+TEST(QJson_Arena, growth)
+{
+    // Deep nesting grows the container stack, and long strings grow the scratch buffer.
+    std::string long_string(5000, 'y');
+    std::string json = "[" + nested_lists(1000) + ", \"" + long_string + "\\n\", " + std::to_string(1LL << 40) + "]";
+    std::string expected = "[ " + expected_nested_lists(1000) + "\"" + long_string + "\n\" " + std::to_string(1LL << 40) + " ] ";
+    ASSERT_EQ(expected, parse_in_arena(json, 64 * 1024).events);
+}
+
+TEST(QJson_Arena, too_small)
+{
+    arena_context context = parse_in_arena(nested_lists(2000), 4096, false);
+    ASSERT_EQ("Arena too small", context.error);
+    ASSERT_EQ("Arena too small", parse_in_arena("[\"" + std::string(5000, 'z') + "\"]", 4096, false).error);
+    // Not even the parser fits.
+    ASSERT_EQ("Arena too small", parse_in_arena("1", 64, false).error);
+
+    std::vector<char> arena(64);
+    ASSERT_TRUE(qjson_new_parser_in_arena(arena.data(), arena.size(), &g_callbacks, NULL) == NULL);
+}
+
+TEST(QJson_Arena, unaligned_region)
+{
+    std::vector<char> arena(8192 + 1);
+    arena_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    std::string json = "{\"a\": [1, [2, [3]]]}";
+    ASSERT_TRUE(qjson_parse_buffer_in_arena(json.data(), json.size(), &g_callbacks, &recorder, arena.data() + 1, 8192));
+    ASSERT_EQ("{ \"a\" [ 1 [ 2 [ 3 ] ] ] } ", context.events);
+}
+
+TEST(QJson_Arena, streaming)
+{
+    std::vector<char> arena(16 * 1024);
+    arena_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_parser* parser = qjson_new_parser_in_arena(arena.data(), arena.size(), &g_callbacks, &recorder);
+    ASSERT_TRUE(parser != NULL);
+    std::string json = "{\"key\": \"a long string split across chunks\", \"n\": 12345.5}";
+    for(size_t i = 0; i < json.size(); i += 3)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + i, std::min((size_t)3, json.size() - i))) << context.error;
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser)) << context.error;
+    ASSERT_EQ("{ \"key\" \"a long string split across chunks\" \"n\" 12345.500000 } ", context.events);
+
+    // A reset parser reuses what it already has in the arena.
+    context.events.clear();
+    qjson_reset_parser(parser, &g_callbacks, &recorder);
+    for(size_t i = 0; i < json.size(); i += 3)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + i, std::min((size_t)3, json.size() - i))) << context.error;
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser)) << context.error;
+    ASSERT_EQ("{ \"key\" \"a long string split across chunks\" \"n\" 12345.500000 } ", context.events);
+    qjson_free_parser(parser);
+}
+
+TEST(QJson_Arena, allocator)
+{
+    counting_allocator allocator;
+    qjson_allocator table = {counting_allocate, counting_free, &allocator};
+    arena_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_parser* parser = qjson_new_parser_with_allocator(&table, &g_callbacks, &recorder);
+    ASSERT_TRUE(parser != NULL);
+    std::string json = nested_lists(500);
+    for(size_t i = 0; i < json.size(); i += 100)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + i, std::min((size_t)100, json.size() - i)));
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    ASSERT_EQ(expected_nested_lists(500), context.events);
+    ASSERT_GT(allocator.allocation_count, 1u);
+    qjson_free_parser(parser);
+    ASSERT_EQ(0u, allocator.live.size());
+}
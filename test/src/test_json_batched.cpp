@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include <string>
+#include <vector>
+
+// Renders the batched events as text, prefixing each with its depth.
+struct batched_context
+{
+    std::string events;
+    std::string error;
+    int batch_count = 0;
+    size_t largest_batch = 0;
+    const char* data = nullptr;
+    size_t data_length = 0;
+    size_t strings_in_data = 0;
+};
+
+static void on_parse_error(void* context, const char* message)
+{
+    batched_context* batched = (batched_context*)context;
+    batched->events += "! ";
+    batched->error = message;
+}
+
+static void on_events(void* context, const qjson_event* events, size_t count)
+{
+    batched_context* batched = (batched_context*)context;
+    EXPECT_GT(count, 0u);
+    batched->batch_count++;
+    batched->largest_batch = std::max(batched->largest_batch, count);
+    for(size_t i = 0; i < count; i++)
+    {
+        const qjson_event& event = events[i];
+        std::string text = std::to_string(event.depth) + ":";
+        switch(event.type)
+        {
+            case QJSON_EVENT_NULL:       text += "n"; break;
+            case QJSON_EVENT_FALSE:      text += "f"; break;
+            case QJSON_EVENT_TRUE:       text += "t"; break;
+            case QJSON_EVENT_INT:        text += std::to_string(event.int_value); break;
+            case QJSON_EVENT_FLOAT:      text += std::to_string(event.float_value); break;
+            case QJSON_EVENT_STRING:     text += "\"" + std::string(event.string, event.string_length) + "\""; break;
+            case QJSON_EVENT_MAP_KEY:    text += "#" + std::string(event.string, event.string_length); break;
+            case QJSON_EVENT_LIST_START: text += "["; break;
+            case QJSON_EVENT_LIST_END:   text += "]"; break;
+            case QJSON_EVENT_MAP_START:  text += "{"; break;
+            case QJSON_EVENT_MAP_END:    text += "}"; break;
+        }
+        batched->events += text + " ";
+        if((event.type == QJSON_EVENT_STRING || event.type == QJSON_EVENT_MAP_KEY) &&
+           event.string >= batched->data && event.string < batched->data + batched->data_length)
+        {
+            batched->strings_in_data++;
+        }
+    }
+}
+
+static const qjson_event_callbacks g_callbacks =
+{
+    on_parse_error, on_events,
+};
+
+static batched_context parse_batched(const std::string& json, size_t event_capacity, bool expect_success = true)
+{
+    batched_context context;
+    context.data = json.data();
+    context.data_length = json.size();
+    std::vector<qjson_event> events(event_capacity);
+    EXPECT_EQ(expect_success, qjson_parse_buffer_batched(json.data(), json.size(), &g_callbacks, events.data(), events.size(), &context))
+        << context.error;
+    return context;
+}
+
+static batched_context parse_batched_in_chunks(const std::string& json, size_t chunk_size, size_t event_capacity)
+{
+    batched_context context;
+    std::vector<qjson_event> events(event_capacity);
+    qjson_parser* parser = qjson_new_parser(NULL, NULL);
+    qjson_reset_parser_batched(parser, &g_callbacks, events.data(), events.size(), &context);
+    for(size_t offset = 0; offset < json.size(); offset += chunk_size)
+    {
+        size_t length = std::min(chunk_size, json.size() - offset);
+        EXPECT_TRUE(qjson_feed_parser(parser, json.data() + offset, length)) << context.error;
+    }
+    EXPECT_TRUE(qjson_finish_parser(parser)) << context.error;
+    qjson_free_parser(parser);
+    return context;
+}
+
+static const char* g_document = "{\"a\": [1, -2.5, true, false, null], \"b\\u0063\": {\"d\": \"e\\ne\"}, \"f\": []}";
+static const char* g_expected = "0:{ 1:#a 1:[ 2:1 2:-2.500000 2:t 2:f 2:n 1:] 1:#bc 1:{ 2:#d 2:\"e\ne\" 1:} 1:#f 1:[ 1:] 0:} ";
+
+TEST(QJson_Batched, events)
+{
+    batched_context context = parse_batched(g_document, 256);
+    ASSERT_EQ(g_expected, context.events);
+    ASSERT_EQ(1, context.batch_count);
+    // The strings without escapes point into the document.
+    ASSERT_EQ(3u, context.strings_in_data);
+}
+
+TEST(QJson_Batched, top_level_scalars)
+{
+    ASSERT_EQ("0:5 ", parse_batched(" 5 ", 4).events);
+    ASSERT_EQ("0:\"x\" ", parse_batched("\"x\"", 4).events);
+}
+
+TEST(QJson_Batched, small_batches)
+{
+    for(size_t capacity: {1, 2, 3, 7})
+    {
+        batched_context context = parse_batched(g_document, capacity);
+        ASSERT_EQ(g_expected, context.events) << "capacity " << capacity;
+        ASSERT_EQ(capacity, context.largest_batch);
+        ASSERT_EQ((int)((18 + capacity - 1) / capacity), context.batch_count);
+    }
+}
+
+TEST(QJson_Batched, many_escaped_strings)
+{
+    // Enough unescaped strings to fill the event string area several times over, and one longer than it.
+    std::string json = "[";
+    std::string expected = "0:[ ";
+    for(int i = 0; i < 2000; i++)
+    {
+        json += "\"string\\t" + std::to_string(i) + "\", ";
+        expected += "1:\"string\t" + std::to_string(i) + "\" ";
+    }
+    std::string long_string(10000, 'x');
+    json += "\"\\\"" + long_string + "\"]";
+    expected += "1:\"\"" + long_string + "\" 0:] ";
+
+    batched_context context = parse_batched(json, 100000);
+    ASSERT_EQ(expected, context.events);
+    ASSERT_GT(context.batch_count, 1);
+}
+
+TEST(QJson_Batched, in_chunks)
+{
+    for(size_t chunk_size: {1, 3, 16})
+    {
+        ASSERT_EQ(g_expected, parse_batched_in_chunks(g_document, chunk_size, 4).events) << "chunk size " << chunk_size;
+    }
+}
+
+TEST(QJson_Batched, errors)
+{
+    batched_context context = parse_batched("[1, {\"a\": x}]", 256, false);
+    ASSERT_EQ("0:[ 1:1 1:{ 2:#a ! ", context.events);
+    ASSERT_EQ("Unexpected token: 'x' at offset 10", context.error);
+    ASSERT_EQ("Unexpected end of document at offset 4", parse_batched("[1, ", 256, false).error);
+    ASSERT_EQ("Bad encoding: invalid escape sequence at offset 2", parse_batched("[\"\\q\"]", 256, false).error);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include <string.h>
+#include <string>
+
+static qjson_cursor new_cursor(const char* json)
+{
+    return qjson_new_cursor(json, strlen(json));
+}
+
+static std::string get_string(const qjson_cursor& cursor)
+{
+    char buffer[100];
+    size_t length = 0;
+    EXPECT_TRUE(qjson_cursor_get_string(&cursor, buffer, sizeof(buffer), &length));
+    return std::string(buffer, length);
+}
+
+TEST(QJson_Cursor, scalars)
+{
+    std::string json = " [null, true, false, -42, 1.5e2, \"a\\tb\\u00e9\", 7] ";
+    qjson_cursor cursor = new_cursor(json.c_str());
+    ASSERT_EQ(QJSON_TYPE_LIST, qjson_cursor_type(&cursor));
+    ASSERT_TRUE(qjson_cursor_enter(&cursor));
+
+    bool boolean = false;
+    int64_t integer = 0;
+    double number = 0;
+    ASSERT_EQ(QJSON_TYPE_NULL, qjson_cursor_type(&cursor));
+    ASSERT_FALSE(qjson_cursor_get_boolean(&cursor, &boolean));
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_EQ(QJSON_TYPE_BOOLEAN, qjson_cursor_type(&cursor));
+    ASSERT_TRUE(qjson_cursor_get_boolean(&cursor, &boolean));
+    ASSERT_TRUE(boolean);
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_TRUE(qjson_cursor_get_boolean(&cursor, &boolean));
+    ASSERT_FALSE(boolean);
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_EQ(QJSON_TYPE_INT, qjson_cursor_type(&cursor));
+    ASSERT_TRUE(qjson_cursor_get_int64(&cursor, &integer));
+    ASSERT_EQ(-42, integer);
+    ASSERT_TRUE(qjson_cursor_get_double(&cursor, &number));
+    ASSERT_EQ(-42.0, number);
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_EQ(QJSON_TYPE_FLOAT, qjson_cursor_type(&cursor));
+    ASSERT_FALSE(qjson_cursor_get_int64(&cursor, &integer));
+    ASSERT_TRUE(qjson_cursor_get_double(&cursor, &number));
+    ASSERT_EQ(150.0, number);
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_EQ(QJSON_TYPE_STRING, qjson_cursor_type(&cursor));
+    ASSERT_EQ("a\tb\xc3\xa9", get_string(cursor));
+    ASSERT_FALSE(qjson_cursor_get_double(&cursor, &number));
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_TRUE(qjson_cursor_get_int64(&cursor, &integer));
+    ASSERT_EQ(7, integer);
+    qjson_cursor last = cursor;
+    ASSERT_FALSE(qjson_cursor_next(&cursor));
+    ASSERT_EQ(last.pos, cursor.pos);
+}
+
+TEST(QJson_Cursor, find_field)
+{
+    std::string json = "{\"skip\": {\"a\": [1, {\"id\": 0}, \"]}\\\"\"], \"b\": \"{[\"},"
+                       " \"empty\": [],"
+                       " \"esc\\u0061ped\": 3,"
+                       " \"user\": {\"name\": \"bob\", \"id\": 12345}}";
+    qjson_cursor root = new_cursor(json.c_str());
+
+    qjson_cursor user = root;
+    ASSERT_TRUE(qjson_cursor_find_field(&user, "user"));
+    qjson_cursor id = user;
+    ASSERT_TRUE(qjson_cursor_find_field(&id, "id"));
+    int64_t value = 0;
+    ASSERT_TRUE(qjson_cursor_get_int64(&id, &value));
+    ASSERT_EQ(12345, value);
+    qjson_cursor name = user;
+    ASSERT_TRUE(qjson_cursor_find_field(&name, "name"));
+    ASSERT_EQ("bob", get_string(name));
+
+    qjson_cursor escaped = root;
+    ASSERT_TRUE(qjson_cursor_find_field(&escaped, "escaped"));
+    ASSERT_TRUE(qjson_cursor_get_int64(&escaped, &value));
+    ASSERT_EQ(3, value);
+
+    qjson_cursor empty = root;
+    ASSERT_TRUE(qjson_cursor_find_field(&empty, "empty"));
+    ASSERT_EQ(QJSON_TYPE_LIST, qjson_cursor_type(&empty));
+    ASSERT_FALSE(qjson_cursor_enter(&empty));
+
+    qjson_cursor missing = root;
+    ASSERT_FALSE(qjson_cursor_find_field(&missing, "id"));
+    ASSERT_EQ(root.pos, missing.pos);
+    ASSERT_FALSE(qjson_cursor_find_field(&id, "id"));
+}
+
+TEST(QJson_Cursor, skip_large_container)
+{
+    std::string big = "[";
+    for(int i = 0; i < 5000; i++)
+    {
+        big += "{\"k\": [\"]]]\", \"\\\\\", " + std::to_string(i) + "]},";
+    }
+    big += "\"}\"]";
+    std::string json = "{\"big\": " + big + ", \"after\": true}";
+    qjson_cursor cursor = new_cursor(json.c_str());
+    ASSERT_TRUE(qjson_cursor_find_field(&cursor, "after"));
+    bool value = false;
+    ASSERT_TRUE(qjson_cursor_get_boolean(&cursor, &value));
+    ASSERT_TRUE(value);
+}
+
+TEST(QJson_Cursor, malformed)
+{
+    int64_t integer = 0;
+    bool boolean = false;
+    char buffer[4];
+    size_t length = 0;
+
+    qjson_cursor cursor = new_cursor("[1, [2, 3");
+    ASSERT_TRUE(qjson_cursor_enter(&cursor));
+    ASSERT_TRUE(qjson_cursor_next(&cursor));
+    ASSERT_FALSE(qjson_cursor_next(&cursor));
+
+    cursor = new_cursor("12x");
+    ASSERT_FALSE(qjson_cursor_get_int64(&cursor, &integer));
+    cursor = new_cursor("99999999999999999999");
+    ASSERT_FALSE(qjson_cursor_get_int64(&cursor, &integer));
+    cursor = new_cursor("truex");
+    ASSERT_FALSE(qjson_cursor_get_boolean(&cursor, &boolean));
+    cursor = new_cursor("\"abc");
+    ASSERT_FALSE(qjson_cursor_get_string(&cursor, buffer, sizeof(buffer), &length));
+    cursor = new_cursor("\"\\x\"");
+    ASSERT_FALSE(qjson_cursor_get_string(&cursor, buffer, sizeof(buffer), &length));
+    cursor = new_cursor("\"abcdef\"");
+    ASSERT_FALSE(qjson_cursor_get_string(&cursor, buffer, sizeof(buffer), &length));
+    ASSERT_EQ(7u, length);
+    cursor = new_cursor("");
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_cursor_type(&cursor));
+    ASSERT_FALSE(qjson_cursor_enter(&cursor));
+    ASSERT_FALSE(qjson_cursor_next(&cursor));
+}
@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Renders each document's events as text, so that documents can be compared regardless of delivery order.
+struct documents_context
+{
+    std::mutex mutex;
+    std::vector<std::string> documents;
+    std::vector<int> delivery_order;
+    std::string error;
+    int open_documents = 0;
+    int max_open_documents = 0;
+};
+
+static thread_local std::string* t_current_document;
+
+static qjson_action on_text(void* context, const char* text)
+{
+    (void)context;
+    *t_current_document += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message)
+{
+    documents_context* documents = (documents_context*)context;
+    std::lock_guard<std::mutex> lock(documents->mutex);
+    documents->error = message;
+    // The failed document is never ended.
+    delete t_current_document;
+    t_current_document = nullptr;
+}
+
+static void on_document_start(void* context, size_t document_index)
+{
+    documents_context* documents = (documents_context*)text_recorder_get_context(context);
+    std::lock_guard<std::mutex> lock(documents->mutex);
+    if(documents->documents.size() <= document_index)
+    {
+        documents->documents.resize(document_index + 1);
+    }
+    documents->delivery_order.push_back((int)document_index);
+    documents->open_documents++;
+    if(documents->open_documents > documents->max_open_documents)
+    {
+        documents->max_open_documents = documents->open_documents;
+    }
+    t_current_document = new std::string();
+}
+
+static void on_document_end(void* context, size_t document_index)
+{
+    documents_context* documents = (documents_context*)text_recorder_get_context(context);
+    std::lock_guard<std::mutex> lock(documents->mutex);
+    documents->documents[document_index] = *t_current_document;
+    documents->open_documents--;
+    delete t_current_document;
+    t_current_document = nullptr;
+}
+
+static const qjson_parse_callbacks g_callbacks = text_recorder_new_callbacks();
+
+static const qjson_document_callbacks g_document_callbacks =
+{
+    on_document_start, on_document_end,
+};
+
+static bool parse_documents(documents_context* context, const std::string& input, int thread_count, qjson_document_order order)
+{
+    text_recorder recorder = {on_text, on_parse_error, context};
+    return qjson_parse_documents(input.data(), input.size(), &g_callbacks, &g_document_callbacks, &recorder, thread_count, order);
+}
+
+static std::string make_record(int index)
+{
+    return "{\"id\": " + std::to_string(index) +
+           ", \"name\": \"record " + std::to_string(index) + "\\n\"" +
+           ", \"tags\": [true, false, null, " + std::to_string(index * 0.5) + "]}";
+}
+
+static std::string expected_record(int index)
+{
+    return "{ \"id\" " + std::to_string(index) +
+           " \"name\" \"record " + std::to_string(index) + "\n\"" +
+           " \"tags\" [ t f n " + std::to_string(index * 0.5) + " ] } ";
+}
+
+static std::string make_lines(int record_count)
+{
+    std::string input;
+    for(int i = 0; i < record_count; i++)
+    {
+        input += make_record(i) + "\n";
+    }
+    return input;
+}
+
+static void expect_all_records(documents_context* context, int record_count)
+{
+    ASSERT_EQ("", context->error);
+    ASSERT_EQ((size_t)record_count, context->documents.size());
+    ASSERT_EQ((size_t)record_count, context->delivery_order.size());
+    for(int i = 0; i < record_count; i++)
+    {
+        ASSERT_EQ(expected_record(i), context->documents[i]) << "document " << i;
+    }
+}
+
+TEST(QJson_Documents, small_input)
+{
+    documents_context context;
+    ASSERT_TRUE(parse_documents(&context, "1 \"a\"\n[2]{\"b\":3}\n\n  null", 4, QJSON_DOCUMENTS_IN_ORDER));
+    ASSERT_EQ(5u, context.documents.size());
+    ASSERT_EQ("1 ", context.documents[0]);
+    ASSERT_EQ("\"a\" ", context.documents[1]);
+    ASSERT_EQ("[ 2 ] ", context.documents[2]);
+    ASSERT_EQ("{ \"b\" 3 } ", context.documents[3]);
+    ASSERT_EQ("n ", context.documents[4]);
+}
+
+TEST(QJson_Documents, empty_input)
+{
+    documents_context context;
+    ASSERT_TRUE(parse_documents(&context, "", 4, QJSON_DOCUMENTS_IN_ORDER));
+    ASSERT_TRUE(parse_documents(&context, " \n\n ", 4, QJSON_DOCUMENTS_IN_ORDER));
+    ASSERT_EQ(0u, context.documents.size());
+}
+
+TEST(QJson_Documents, pretty_printed_single_thread)
+{
+    documents_context context;
+    ASSERT_TRUE(parse_documents(&context, "{\n  \"a\": [\n    1\n  ]\n}\n{\n}\n", 1, QJSON_DOCUMENTS_IN_ORDER));
+    ASSERT_EQ(2u, context.documents.size());
+    ASSERT_EQ("{ \"a\" [ 1 ] } ", context.documents[0]);
+    ASSERT_EQ("{ } ", context.documents[1]);
+}
+
+TEST(QJson_Documents, pretty_printed_multi_thread)
+{
+    // Well over the minimum chunk size, so the documents are split across chunks between lines.
+    const int record_count = 20000;
+    std::string input;
+    for(int i = 0; i < record_count; i++)
+    {
+        input += "{\n  \"id\": " + std::to_string(i) +
+                 ",\n  \"name\": \"record " + std::to_string(i) + "\\n\"" +
+                 ",\n  \"tags\": [\n    true,\n    false,\n    null,\n    " + std::to_string(i * 0.5) + "\n  ]\n}\n";
+    }
+    ASSERT_GT(input.size(), 4u * 64 * 1024);
+    for(int thread_count: {1, 4})
+    {
+        documents_context context;
+        ASSERT_TRUE(parse_documents(&context, input, thread_count, QJSON_DOCUMENTS_IN_ORDER)) << context.error;
+        expect_all_records(&context, record_count);
+    }
+}
+
+TEST(QJson_Documents, ordered)
+{
+    const int record_count = 20000;
+    std::string input = make_lines(record_count);
+    for(int thread_count: {1, 2, 4, 7})
+    {
+        documents_context context;
+        ASSERT_TRUE(parse_documents(&context, input, thread_count, QJSON_DOCUMENTS_IN_ORDER));
+        expect_all_records(&context, record_count);
+        ASSERT_EQ(1, context.max_open_documents);
+        for(int i = 0; i < record_count; i++)
+        {
+            ASSERT_EQ(i, context.delivery_order[i]);
+        }
+    }
+}
+
+TEST(QJson_Documents, unordered)
+{
+    const int record_count = 20000;
+    std::string input = make_lines(record_count);
+    for(int thread_count: {0, 2, 4, 7})
+    {
+        documents_context context;
+        ASSERT_TRUE(parse_documents(&context, input, thread_count, QJSON_DOCUMENTS_ANY_ORDER));
+        expect_all_records(&context, record_count);
+    }
+}
+
+TEST(QJson_Documents, failure)
+{
+    const int record_count = 20000;
+    const int bad_record = 14000;
+    std::string input;
+    for(int i = 0; i < record_count; i++)
+    {
+        input += (i == bad_record ? "{\"id\": [}" : make_record(i)) + "\n";
+    }
+    const size_t bad_offset = input.find("[}") + 1;
+
+    for(qjson_document_order order: {QJSON_DOCUMENTS_IN_ORDER, QJSON_DOCUMENTS_ANY_ORDER})
+    {
+        for(int thread_count: {1, 4})
+        {
+            documents_context context;
+            ASSERT_FALSE(parse_documents(&context, input, thread_count, order));
+            ASSERT_EQ("Unexpected token: '}' at offset " + std::to_string(bad_offset), context.error);
+            ASSERT_EQ((size_t)bad_record + 1, context.delivery_order.size());
+            for(int i = 0; i < bad_record; i++)
+            {
+                ASSERT_EQ(expected_record(i), context.documents[i]) << "document " << i;
+            }
+        }
+    }
+}
+
+TEST(QJson_Documents, truncated_last_document)
+{
+    std::string input = make_lines(20000) + "[1, 2";
+    for(int thread_count: {1, 4})
+    {
+        documents_context context;
+        ASSERT_FALSE(parse_documents(&context, input, thread_count, QJSON_DOCUMENTS_IN_ORDER));
+        ASSERT_EQ("Unexpected end of document at offset " + std::to_string(input.size()), context.error);
+        ASSERT_EQ(20001u, context.delivery_order.size());
+    }
+}
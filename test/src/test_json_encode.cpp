@@ -1,5 +1,12 @@
 #include <gtest/gtest.h>
 #include <qjson/qjson.h>
+#include <algorithm>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
 #define DEFINE_ENCODE_TEST(NAME, EXPECTED, ...) \
 TEST(QJson_Encode, NAME) \
@@ -58,12 +65,43 @@ DEFINE_ENCODE_TEST(true, "true", { ASSERT_TRUE(qjson_add_boolean(&context, true)
 DEFINE_ENCODE_TEST(int_1000, "1000", { ASSERT_TRUE(qjson_add_integer(&context, 1000)); })
 DEFINE_ENCODE_TEST(int_9223372036854775807, "9223372036854775807", { ASSERT_TRUE(qjson_add_integer(&context, 9223372036854775807L)); })
 DEFINE_ENCODE_TEST(int_n9223372036854775807, "-9223372036854775807", { ASSERT_TRUE(qjson_add_integer(&context, -9223372036854775807L)); })
+DEFINE_ENCODE_TEST(int_n9223372036854775808, "-9223372036854775808", { ASSERT_TRUE(qjson_add_integer(&context, INT64_MIN)); })
+DEFINE_ENCODE_TEST(int_0, "0", { ASSERT_TRUE(qjson_add_integer(&context, 0)); })
+DEFINE_ENCODE_TEST(uint64_18446744073709551615, "18446744073709551615", { ASSERT_TRUE(qjson_add_uint64(&context, UINT64_MAX)); })
+DEFINE_ENCODE_TEST(int32_n2147483648, "-2147483648", { ASSERT_TRUE(qjson_add_int32(&context, INT32_MIN)); })
+DEFINE_ENCODE_TEST(uint32_4294967295, "4294967295", { ASSERT_TRUE(qjson_add_uint32(&context, UINT32_MAX)); })
 DEFINE_ENCODE_TEST(float_1_1, "1.1", { ASSERT_TRUE(qjson_add_float(&context, 1.1)); })
 DEFINE_ENCODE_TEST(float_924_5122045, "924.5122045", { ASSERT_TRUE(qjson_add_float(&context, 924.5122045)); })
 DEFINE_ENCODE_TEST(string, "\"a string\"", { ASSERT_TRUE(qjson_add_string(&context, "a string")); })
 DEFINE_ENCODE_TEST(escaped, "\"q\\\"s\\\\b\\bf\\fn\\nr\\rt\\t\"", { ASSERT_TRUE(qjson_add_string(&context, "q\"s\\b\bf\fn\nr\rt\t")); })
+DEFINE_ENCODE_TEST(escaped_control, "\"\\u0000a\\u0001\\u001f\x7f\xc3\xa9\"",
+{
+    // Control characters without a short escape are written as \u00XX. DEL and non-ASCII bytes pass through.
+    const char string[] = "\0a\x01\x1f\x7f\xc3\xa9";
+    ASSERT_TRUE(qjson_add_substring(&context, string, string + sizeof(string) - 1));
+})
 
 DEFINE_ENCODE_FLOAT_TEST(float_limit_10, 10, "1.012345679", { ASSERT_TRUE(qjson_add_float(&context, 1.0123456789)); })
+DEFINE_ENCODE_FLOAT_TEST(float_limit_3_exponent, 3, "1.23e+20", { ASSERT_TRUE(qjson_add_float(&context, 1.23456e20)); })
+DEFINE_ENCODE_FLOAT_TEST(float_limit_3_small, 3, "0.000123", { ASSERT_TRUE(qjson_add_float(&context, 0.000123456)); })
+DEFINE_ENCODE_FLOAT_TEST(float_limit_3_carry, 3, "1e+03", { ASSERT_TRUE(qjson_add_float(&context, 999.9)); })
+DEFINE_ENCODE_FLOAT_TEST(float_limit_3_tie, 3, "0.125", { ASSERT_TRUE(qjson_add_float(&context, 0.125)); })
+DEFINE_ENCODE_FLOAT_TEST(float_limit_2_tie, 2, "0.12", { ASSERT_TRUE(qjson_add_float(&context, 0.125)); })
+DEFINE_ENCODE_FLOAT_TEST(float_negative_zero, 15, "-0", { ASSERT_TRUE(qjson_add_float(&context, -0.0)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_0_1, QJSON_FLOAT_PRECISION_SHORTEST, "0.1", { ASSERT_TRUE(qjson_add_float(&context, 0.1)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_sum, QJSON_FLOAT_PRECISION_SHORTEST, "0.30000000000000004", { ASSERT_TRUE(qjson_add_float(&context, 0.1 + 0.2)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_1e20, QJSON_FLOAT_PRECISION_SHORTEST, "100000000000000000000", { ASSERT_TRUE(qjson_add_float(&context, 1e20)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_1e21, QJSON_FLOAT_PRECISION_SHORTEST, "1e+21", { ASSERT_TRUE(qjson_add_float(&context, 1e21)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_1e_6, QJSON_FLOAT_PRECISION_SHORTEST, "0.000001", { ASSERT_TRUE(qjson_add_float(&context, 1e-6)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_1_5e_7, QJSON_FLOAT_PRECISION_SHORTEST, "-1.5e-7", { ASSERT_TRUE(qjson_add_float(&context, -1.5e-7)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_max, QJSON_FLOAT_PRECISION_SHORTEST, "1.7976931348623157e+308", { ASSERT_TRUE(qjson_add_float(&context, 1.7976931348623157e308)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_min, QJSON_FLOAT_PRECISION_SHORTEST, "5e-324", { ASSERT_TRUE(qjson_add_float(&context, 5e-324)); })
+DEFINE_ENCODE_FLOAT_TEST(float_shortest_integer, QJSON_FLOAT_PRECISION_SHORTEST, "[1234,-0]",
+{
+    ASSERT_TRUE(qjson_start_list(&context));
+    ASSERT_TRUE(qjson_add_float(&context, 1234.0));
+    ASSERT_TRUE(qjson_add_float(&context, -0.0));
+})
 
 DEFINE_ENCODE_TEST(substring, "\"a string\"",
 {
@@ -162,11 +200,23 @@ DEFINE_ENCODE_FAIL_TEST(fail_int_size_1,1,
     ASSERT_FALSE(qjson_add_integer(&context, 10));
 })
 
+DEFINE_ENCODE_FAIL_TEST(fail_uint64_size_19,19,
+{
+    ASSERT_FALSE(qjson_add_uint64(&context, 10000000000000000000ULL));
+})
+
 DEFINE_ENCODE_FAIL_TEST(fail_float_size_1,1,
 {
     ASSERT_FALSE(qjson_add_float(&context, 0.1));
 })
 
+DEFINE_ENCODE_FAIL_TEST(fail_float_not_finite,100,
+{
+    ASSERT_FALSE(qjson_add_float(&context, INFINITY));
+    ASSERT_FALSE(qjson_add_float(&context, -INFINITY));
+    ASSERT_FALSE(qjson_add_float(&context, NAN));
+})
+
 DEFINE_ENCODE_FAIL_TEST(fail_string_size_10,10,
 {
     ASSERT_FALSE(qjson_add_string(&context, "this is a test"));
@@ -295,3 +345,525 @@ DEFINE_ENCODE_INDENTATION_TEST(indent_map_list, 4, "{\n    \"number\": 1,\n    \
     ASSERT_TRUE(qjson_end_container(&context));
     ASSERT_NE(nullptr, qjson_end_encoding(&context));
 })
+
+// Collects flushed output.
+struct flushed_output
+{
+    std::string text;
+    int flush_count = 0;
+    int fail_after = -1;
+};
+
+static bool flush_to_string(void* context, const uint8_t* data, size_t length)
+{
+    flushed_output* output = (flushed_output*)context;
+    if(output->flush_count == output->fail_after)
+    {
+        return false;
+    }
+    EXPECT_GT(length, 0u);
+    output->text.append((const char*)data, length);
+    output->flush_count++;
+    return true;
+}
+
+static uint8_t* grow_with_realloc(void* context, uint8_t* memory, size_t size)
+{
+    (*(int*)context)++;
+    return (uint8_t*)realloc(memory, size);
+}
+
+static bool encode_large_document(qjson_encode_context* context)
+{
+    if(!qjson_start_map(context)) return false;
+    for(int i = 0; i < 200; i++)
+    {
+        std::string key = "key " + std::to_string(i);
+        if(!qjson_add_string(context, key.c_str())) return false;
+        if(!qjson_start_list(context)) return false;
+        if(!qjson_add_integer(context, i)) return false;
+        if(!qjson_add_float(context, i + 0.5)) return false;
+        if(!qjson_add_string(context, "a string that is longer than the sink's buffer\n")) return false;
+        if(!qjson_end_container(context)) return false;
+    }
+    return qjson_end_encoding(context) != nullptr;
+}
+
+static std::string expected_large_document(int indent_spaces)
+{
+    std::vector<uint8_t> buff(100000);
+    qjson_encode_context context = qjson_new_encode_context_with_config(buff.data(), buff.data() + buff.size(),
+                                                                        indent_spaces, DEFAULT_FLOAT_DIGITS_PRECISION);
+    EXPECT_TRUE(encode_large_document(&context));
+    return std::string((const char*)buff.data());
+}
+
+TEST(QJson_Encode, flush_sink)
+{
+    for(int indent_spaces: {0, 2})
+    {
+        flushed_output output;
+        qjson_encode_sink sink = {flush_to_string, NULL, &output};
+        uint8_t buff[32];
+        qjson_encode_context context = qjson_new_encode_context_with_sink(buff, buff + sizeof(buff), indent_spaces,
+                                                                          DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+        ASSERT_TRUE(encode_large_document(&context));
+        ASSERT_EQ(expected_large_document(indent_spaces), output.text);
+        ASSERT_GT(output.flush_count, 100);
+    }
+}
+
+TEST(QJson_Encode, flush_sink_failure)
+{
+    flushed_output output;
+    output.fail_after = 3;
+    qjson_encode_sink sink = {flush_to_string, NULL, &output};
+    uint8_t buff[32];
+    qjson_encode_context context = qjson_new_encode_context_with_sink(buff, buff + sizeof(buff), 0,
+                                                                      DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+    ASSERT_FALSE(encode_large_document(&context));
+    ASSERT_EQ(3, output.flush_count);
+}
+
+TEST(QJson_Encode, grow_sink)
+{
+    int grow_count = 0;
+    qjson_encode_sink sink = {NULL, grow_with_realloc, &grow_count};
+    uint8_t* memory = (uint8_t*)malloc(16);
+    qjson_encode_context context = qjson_new_encode_context_with_sink(memory, memory + 16, 0,
+                                                                      DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+    ASSERT_TRUE(encode_large_document(&context));
+    std::string expected = expected_large_document(0);
+    ASSERT_EQ(expected.size(), (size_t)(context.pos - context.start));
+    ASSERT_EQ(expected, std::string((const char*)context.start));
+    // The buffer doubles, so it only grows a logarithmic number of times.
+    ASSERT_LT(grow_count, 20);
+    free(context.start);
+}
+
+TEST(QJson_Encode, grow_sink_from_nothing)
+{
+    int grow_count = 0;
+    qjson_encode_sink sink = {NULL, grow_with_realloc, &grow_count};
+    qjson_encode_context context = qjson_new_encode_context_with_sink(NULL, NULL, 0, DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+    ASSERT_TRUE(qjson_add_string(&context, "x"));
+    ASSERT_NE(nullptr, qjson_end_encoding(&context));
+    ASSERT_STREQ("\"x\"", (const char*)context.start);
+    free(context.start);
+}
+
+TEST(QJson_Encode, long_string_through_sink)
+{
+    // Runs longer than the sink's buffer go straight through, with escapes in between.
+    std::string string;
+    for(int i = 0; i < 20; i++)
+    {
+        string += std::string(i * 7, 'x') + "\"\x02" + std::string(100, 'y') + "\n";
+    }
+    std::vector<uint8_t> buff(100000);
+    qjson_encode_context expected_context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    ASSERT_TRUE(qjson_add_substring(&expected_context, string.data(), string.data() + string.size()));
+    ASSERT_NE(nullptr, qjson_end_encoding(&expected_context));
+
+    flushed_output output;
+    qjson_encode_sink sink = {flush_to_string, NULL, &output};
+    uint8_t small_buff[32];
+    qjson_encode_context context = qjson_new_encode_context_with_sink(small_buff, small_buff + sizeof(small_buff), 0,
+                                                                      DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+    ASSERT_TRUE(qjson_add_substring(&context, string.data(), string.data() + string.size()));
+    ASSERT_NE(nullptr, qjson_end_encoding(&context));
+    ASSERT_EQ(std::string((const char*)buff.data()), output.text);
+}
+
+// Opens depth containers, alternating lists and maps, and closes them all.
+static bool encode_nested(qjson_encode_context* context, int depth)
+{
+    for(int i = 0; i < depth; i++)
+    {
+        if(i % 2 == 0 ? !qjson_start_list(context) : !qjson_start_map(context)) return false;
+        if(i % 2 != 0 && !qjson_add_string(context, "k")) return false;
+    }
+    if(depth % 2 == 0 && !qjson_add_null(context)) return false;
+    return qjson_end_encoding(context) != nullptr;
+}
+
+static std::string expected_nested(int depth)
+{
+    std::string opening;
+    std::string closing;
+    for(int i = 0; i < depth; i++)
+    {
+        opening += i % 2 == 0 ? "[" : "{\"k\":";
+        closing = (i % 2 == 0 ? "]" : "}") + closing;
+    }
+    return opening + (depth % 2 == 0 ? "null" : "") + closing;
+}
+
+static void* allocate_with_malloc(void* context, size_t size)
+{
+    (*(int*)context)++;
+    return malloc(size);
+}
+
+static void free_with_free(void* context, void* memory)
+{
+    (*(int*)context)--;
+    free(memory);
+}
+
+TEST(QJson_Encode, inline_depth)
+{
+    std::vector<uint8_t> buff(1000);
+    qjson_encode_context context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    ASSERT_TRUE(encode_nested(&context, QJSON_ENCODE_INLINE_DEPTH));
+    ASSERT_EQ(expected_nested(QJSON_ENCODE_INLINE_DEPTH), std::string((const char*)buff.data()));
+
+    context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    ASSERT_FALSE(encode_nested(&context, QJSON_ENCODE_INLINE_DEPTH + 1));
+    ASSERT_EQ(QJSON_ENCODE_INLINE_DEPTH, context.container_level);
+
+    // The context stays small enough to keep many of them around.
+    ASSERT_LE(sizeof(qjson_encode_context), 128u);
+}
+
+TEST(QJson_Encode, caller_container_storage)
+{
+    std::vector<uint8_t> buff(10000);
+    uint64_t words[2];
+    const int max_depth = QJSON_ENCODE_INLINE_DEPTH + 128;
+    qjson_encode_context context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    qjson_set_encode_container_storage(&context, words, 2, NULL);
+    ASSERT_TRUE(encode_nested(&context, max_depth));
+    ASSERT_EQ(expected_nested(max_depth), std::string((const char*)buff.data()));
+
+    context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    qjson_set_encode_container_storage(&context, words, 2, NULL);
+    ASSERT_FALSE(encode_nested(&context, max_depth + 1));
+}
+
+TEST(QJson_Encode, allocated_container_storage)
+{
+    const int depth = 5000;
+    int live_allocations = 0;
+    qjson_allocator allocator = {allocate_with_malloc, free_with_free, &live_allocations};
+    int grow_count = 0;
+    qjson_encode_sink sink = {NULL, grow_with_realloc, &grow_count};
+    uint64_t words[1];
+    qjson_encode_context context = qjson_new_encode_context_with_sink(NULL, NULL, 0, DEFAULT_FLOAT_DIGITS_PRECISION, &sink);
+    // Starts out in the caller's storage, then moves to allocated storage.
+    qjson_set_encode_container_storage(&context, words, 1, &allocator);
+    ASSERT_TRUE(encode_nested(&context, depth));
+    ASSERT_EQ(expected_nested(depth), std::string((const char*)context.start));
+    ASSERT_EQ(1, live_allocations);
+    qjson_release_encode_context(&context);
+    ASSERT_EQ(0, live_allocations);
+    free(context.start);
+}
+
+// Hands out blocks from a fixed buffer and never takes them back.
+struct bump_arena
+{
+    alignas(16) uint8_t memory[4096];
+    size_t used;
+};
+
+static void* allocate_from_arena(void* context, size_t size)
+{
+    bump_arena* arena = (bump_arena*)context;
+    size = (size + 15) & ~(size_t)15;
+    if(size > sizeof(arena->memory) - arena->used) return nullptr;
+    void* block = arena->memory + arena->used;
+    arena->used += size;
+    return block;
+}
+
+TEST(QJson_Encode, container_storage_without_free)
+{
+    const int depth = QJSON_ENCODE_INLINE_DEPTH + 200;
+    bump_arena arena = {};
+    qjson_allocator allocator = {allocate_from_arena, NULL, &arena};
+    std::vector<uint8_t> buff(10000);
+    qjson_encode_context context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    qjson_set_encode_container_storage(&context, NULL, 0, &allocator);
+    ASSERT_TRUE(encode_nested(&context, depth));
+    ASSERT_EQ(expected_nested(depth), std::string((const char*)buff.data()));
+    ASSERT_LT(0u, arena.used);
+    qjson_release_encode_context(&context);
+    ASSERT_EQ(nullptr, context.container_overflow);
+}
+
+TEST(QJson_Encode, container_storage_with_malloc)
+{
+    const int depth = QJSON_ENCODE_INLINE_DEPTH + 200;
+    qjson_allocator allocator = {NULL, NULL, NULL};
+    std::vector<uint8_t> buff(10000);
+    qjson_encode_context context = qjson_new_encode_context(buff.data(), buff.data() + buff.size());
+    qjson_set_encode_container_storage(&context, NULL, 0, &allocator);
+    ASSERT_TRUE(encode_nested(&context, depth));
+    ASSERT_EQ(expected_nested(depth), std::string((const char*)buff.data()));
+    qjson_release_encode_context(&context);
+    ASSERT_EQ(nullptr, context.container_overflow);
+}
+
+DEFINE_ENCODE_TEST(empty_list_then_value, "[[],1]",
+{
+    ASSERT_TRUE(qjson_start_list(&context));
+    ASSERT_TRUE(qjson_start_list(&context));
+    ASSERT_TRUE(qjson_end_container(&context));
+    ASSERT_TRUE(qjson_add_integer(&context, 1));
+})
+
+// Encodes the arrays with the bulk functions, and again one value at a time, into a map.
+static void assert_arrays_match(int indent_spaces, int float_digits_precision, const std::vector<int64_t>& ints,
+                                const std::vector<double>& doubles, const std::vector<const char*>& strings)
+{
+    std::vector<uint8_t> expected_buff(1000000);
+    qjson_encode_context expected = qjson_new_encode_context_with_config(expected_buff.data(),
+                                                                         expected_buff.data() + expected_buff.size(),
+                                                                         indent_spaces, float_digits_precision);
+    ASSERT_TRUE(qjson_start_map(&expected));
+    ASSERT_TRUE(qjson_add_string(&expected, "i"));
+    ASSERT_TRUE(qjson_start_list(&expected));
+    for(int64_t value: ints)
+    {
+        ASSERT_TRUE(qjson_add_integer(&expected, value));
+    }
+    ASSERT_TRUE(qjson_end_container(&expected));
+    ASSERT_TRUE(qjson_add_string(&expected, "d"));
+    ASSERT_TRUE(qjson_start_list(&expected));
+    for(double value: doubles)
+    {
+        ASSERT_TRUE(qjson_add_float(&expected, value));
+    }
+    ASSERT_TRUE(qjson_end_container(&expected));
+    ASSERT_TRUE(qjson_add_string(&expected, "s"));
+    ASSERT_TRUE(qjson_start_list(&expected));
+    for(const char* value: strings)
+    {
+        ASSERT_TRUE(qjson_add_string(&expected, value));
+    }
+    ASSERT_TRUE(qjson_end_container(&expected));
+    ASSERT_NE(nullptr, qjson_end_encoding(&expected));
+
+    // Through a small flushing buffer, so that the arrays span many flushes.
+    flushed_output output;
+    qjson_encode_sink sink = {flush_to_string, NULL, &output};
+    uint8_t buff[64];
+    qjson_encode_context context = qjson_new_encode_context_with_sink(buff, buff + sizeof(buff), indent_spaces,
+                                                                      float_digits_precision, &sink);
+    ASSERT_TRUE(qjson_start_map(&context));
+    ASSERT_TRUE(qjson_add_string(&context, "i"));
+    ASSERT_TRUE(qjson_add_int64_array(&context, ints.data(), ints.size()));
+    ASSERT_TRUE(qjson_add_string(&context, "d"));
+    ASSERT_TRUE(qjson_add_double_array(&context, doubles.data(), doubles.size()));
+    ASSERT_TRUE(qjson_add_string(&context, "s"));
+    ASSERT_TRUE(qjson_add_string_array(&context, strings.data(), strings.size()));
+    ASSERT_NE(nullptr, qjson_end_encoding(&context));
+    ASSERT_EQ(std::string((const char*)expected_buff.data()), output.text);
+}
+
+TEST(QJson_Encode, arrays)
+{
+    std::vector<int64_t> ints = {0, -1, INT64_MIN, INT64_MAX, 42};
+    std::vector<double> doubles = {0.0, -1.5, 1e300, 5e-324, 0.1};
+    std::vector<const char*> strings = {"", "a", "quote\"", "a string that is longer than the sink's buffer, with a \x01 in the middle of it"};
+    srand(1);
+    for(int i = 0; i < 1000; i++)
+    {
+        ints.push_back(((int64_t)rand() << 32 | rand()) >> (rand() % 64));
+        doubles.push_back((double)rand() / rand() * (rand() % 2 ? 1e-10 : 1e10));
+    }
+    for(int indent_spaces: {0, 3})
+    {
+        for(int precision: {DEFAULT_FLOAT_DIGITS_PRECISION, QJSON_FLOAT_PRECISION_SHORTEST})
+        {
+            assert_arrays_match(indent_spaces, precision, ints, doubles, strings);
+            assert_arrays_match(indent_spaces, precision, {}, {}, {});
+        }
+    }
+}
+
+TEST(QJson_Encode, arrays_in_tight_buffers)
+{
+    // Bulk and per-value encoding succeed and fail at exactly the same buffer sizes.
+    const int64_t ints[] = {1, 2, -30, 400};
+    const double doubles[] = {0.5, 1e300, -2.0};
+    for(int indent_spaces: {0, 2})
+    {
+        for(size_t size = 1; size < 80; size++)
+        {
+            std::vector<uint8_t> expected_buff(size);
+            qjson_encode_context expected = qjson_new_encode_context_with_config(expected_buff.data(),
+                                                                                 expected_buff.data() + size, indent_spaces,
+                                                                                 DEFAULT_FLOAT_DIGITS_PRECISION);
+            bool expected_success = qjson_start_list(&expected);
+            expected_success = expected_success && qjson_start_list(&expected);
+            for(int64_t value: ints)
+            {
+                expected_success = expected_success && qjson_add_integer(&expected, value);
+            }
+            expected_success = expected_success && qjson_end_container(&expected);
+            expected_success = expected_success && qjson_start_list(&expected);
+            for(double value: doubles)
+            {
+                expected_success = expected_success && qjson_add_float(&expected, value);
+            }
+            expected_success = expected_success && qjson_end_encoding(&expected) != nullptr;
+
+            std::vector<uint8_t> buff(size);
+            qjson_encode_context context = qjson_new_encode_context_with_config(buff.data(), buff.data() + size, indent_spaces,
+                                                                                DEFAULT_FLOAT_DIGITS_PRECISION);
+            bool success = qjson_start_list(&context);
+            success = success && qjson_add_int64_array(&context, ints, 4);
+            success = success && qjson_add_double_array(&context, doubles, 3);
+            success = success && qjson_end_encoding(&context) != nullptr;
+
+            ASSERT_EQ(expected_success, success) << "size " << size << ", indent " << indent_spaces;
+            if(success)
+            {
+                ASSERT_STREQ((const char*)expected_buff.data(), (const char*)buff.data());
+            }
+        }
+    }
+}
+
+DEFINE_ENCODE_TEST(array_in_list, "[[1,2],[],[\"x\"],3]",
+{
+    const int64_t ints[] = {1, 2};
+    const char* strings[] = {"x"};
+    ASSERT_TRUE(qjson_start_list(&context));
+    ASSERT_TRUE(qjson_add_int64_array(&context, ints, 2));
+    ASSERT_TRUE(qjson_add_double_array(&context, NULL, 0));
+    ASSERT_TRUE(qjson_add_string_array(&context, strings, 1));
+    ASSERT_TRUE(qjson_add_integer(&context, 3));
+})
+
+DEFINE_ENCODE_FAIL_TEST(fail_array_bad_double,100,
+{
+    const double values[] = {1.0, INFINITY};
+    ASSERT_FALSE(qjson_add_double_array(&context, values, 2));
+    ASSERT_EQ(context.start, context.pos);
+})
+
+DEFINE_ENCODE_FAIL_TEST(fail_array_as_map_key,100,
+{
+    const int64_t values[] = {1};
+    ASSERT_TRUE(qjson_start_map(&context));
+    ASSERT_FALSE(qjson_add_int64_array(&context, values, 1));
+})
+
+DEFINE_ENCODE_FAIL_TEST(fail_array_too_big,20,
+{
+    const int64_t values[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    ASSERT_FALSE(qjson_add_int64_array(&context, values, 12));
+})
+
+TEST(QJson_Encode, integer_digit_boundaries)
+{
+    std::vector<uint64_t> values = {0, UINT64_MAX};
+    for(uint64_t power = 1; power <= 1000000000000000000ULL; power *= 10)
+    {
+        values.push_back(power - 1);
+        values.push_back(power);
+        values.push_back(power * 10 - 1);
+    }
+    for(uint64_t value: values)
+    {
+        uint8_t buff[100];
+        qjson_encode_context context = qjson_new_encode_context(buff, buff + sizeof(buff));
+        ASSERT_TRUE(qjson_start_list(&context));
+        ASSERT_TRUE(qjson_add_uint64(&context, value));
+        ASSERT_TRUE(qjson_add_integer(&context, -(int64_t)(value >> 1)));
+        ASSERT_NE(nullptr, qjson_end_encoding(&context));
+        ASSERT_EQ("[" + std::to_string(value) + "," + std::to_string(-(int64_t)(value >> 1)) + "]", std::string((const char*)buff));
+    }
+}
+
+static std::string encode_float(double value, int precision)
+{
+    uint8_t buff[100];
+    qjson_encode_context context = qjson_new_encode_context_with_config(buff, buff + sizeof(buff), 0, precision);
+    EXPECT_TRUE(qjson_add_float(&context, value));
+    EXPECT_NE(nullptr, qjson_end_encoding(&context));
+    return std::string((const char*)buff);
+}
+
+TEST(QJson_Encode, float_formatting)
+{
+    // Random bit patterns cover every exponent, including subnormals. Every precision rounds exactly as printf does,
+    // and the shortest form reads back as the same double with no more digits than the shortest printf form.
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for(int i = 0; i < 20000; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double value;
+        memcpy(&value, &state, sizeof(value));
+        if(!isfinite(value))
+        {
+            continue;
+        }
+        for(int precision = 1; precision <= 17; precision++)
+        {
+            char expected[100];
+            snprintf(expected, sizeof(expected), "%.*g", precision, value);
+            ASSERT_EQ(expected, encode_float(value, precision)) << "precision " << precision;
+        }
+
+        const std::string shortest = encode_float(value, QJSON_FLOAT_PRECISION_SHORTEST);
+        ASSERT_EQ(value, strtod(shortest.c_str(), NULL)) << shortest;
+        const std::string mantissa = shortest.substr(0, shortest.find('e'));
+        std::string digits = mantissa.substr(mantissa.find_first_of("123456789"));
+        digits.erase(std::remove(digits.begin(), digits.end(), '.'), digits.end());
+        size_t shortest_printf_digits = 17;
+        for(size_t digit_count = 1; digit_count < 17; digit_count++)
+        {
+            char candidate[100];
+            snprintf(candidate, sizeof(candidate), "%.*e", (int)digit_count - 1, value);
+            if(strtod(candidate, NULL) == value)
+            {
+                shortest_printf_digits = digit_count;
+                break;
+            }
+        }
+        ASSERT_LE(digits.find_last_not_of('0') + 1, shortest_printf_digits) << shortest;
+    }
+}
+
+TEST(QJson_Encode, float_formatting_hard_cases)
+{
+    // Plain Grisu2 writes one digit too many here.
+    ASSERT_EQ("30892612233637950", encode_float(30892612233637952.0, QJSON_FLOAT_PRECISION_SHORTEST));
+    ASSERT_EQ("5e-324", encode_float(5e-324, QJSON_FLOAT_PRECISION_SHORTEST));
+    ASSERT_EQ("1.7976931348623157e+308", encode_float(1.7976931348623157e308, QJSON_FLOAT_PRECISION_SHORTEST));
+    // Exact ties round to even, and values beyond the power table are still written exactly.
+    ASSERT_EQ("2", encode_float(2.5, 1));
+    ASSERT_EQ("0.12", encode_float(0.125, 2));
+    ASSERT_EQ("1.234e+04", encode_float(12345, 4));
+    ASSERT_EQ("12346", encode_float(12345.5, 5));
+    ASSERT_EQ("12344", encode_float(12344.5, 5));
+    ASSERT_EQ("4.9406564584124654e-324", encode_float(5e-324, 17));
+    ASSERT_EQ("2.2250738585072014e-308", encode_float(2.2250738585072014e-308, 17));
+}
+
+TEST(QJson_Encode, float_formatting_ignores_locale)
+{
+    const char* original = setlocale(LC_NUMERIC, NULL);
+    const std::string original_locale = original != NULL ? original : "C";
+    if(setlocale(LC_NUMERIC, "de_DE.UTF-8") == NULL && setlocale(LC_NUMERIC, "fr_FR.UTF-8") == NULL)
+    {
+        GTEST_SKIP() << "No locale with a decimal comma is installed";
+    }
+    // Tiny values and rounding ties once went through snprintf, which follows LC_NUMERIC.
+    const std::string tiny = encode_float(1.5e-300, 17);
+    const std::string tie = encode_float(0.125, 2);
+    setlocale(LC_NUMERIC, original_locale.c_str());
+    ASSERT_EQ("1.5000000000000001e-300", tiny);
+    ASSERT_EQ("0.12", tie);
+}
+
+TEST(QJson_Encode, float_precision_above_17)
+{
+    ASSERT_EQ("0.10000000000000001", encode_float(0.1, 30));
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include "managed_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+// Writes contents to a new temporary file, returning its path.
+static std::string write_temp_file(const std::string& contents)
+{
+    char path[] = "/tmp/qjson_test_XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ((ssize_t)contents.size(), write(fd, contents.data(), contents.size()));
+    close(fd);
+    return path;
+}
+
+static void expect_file_decoded(const std::string& json)
+{
+    managed_free_all();
+    std::string path = write_temp_file(json);
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    parse_test_context* expected = new parse_test_context();
+    parse_test_context* actual = new parse_test_context();
+    ASSERT_TRUE(qjson_parse_buffer(json.data(), json.size(), &callbacks, expected));
+    ASSERT_TRUE(qjson_parse_file(path.c_str(), &callbacks, actual));
+    unlink(path.c_str());
+
+    ASSERT_EQ(parse_get_item_count(expected), parse_get_item_count(actual));
+    for(int i = 0; i < parse_get_item_count(expected); i++)
+    {
+        ASSERT_EQ(parse_get_type(expected, i), parse_get_type(actual, i)) << "item " << i;
+        if(parse_get_type(expected, i) == TYPE_STRING)
+        {
+            ASSERT_STREQ(parse_get_string(expected, i), parse_get_string(actual, i)) << "item " << i;
+        }
+    }
+    delete expected;
+    delete actual;
+}
+
+TEST(QJson_File, small)
+{
+    expect_file_decoded("{\"a\": [1, 2.5, \"three\", null, true]}");
+}
+
+TEST(QJson_File, large)
+{
+    std::string json = "[";
+    for(int i = 0; i < 10000; i++)
+    {
+        json += "{\"id\": " + std::to_string(i) + ", \"name\": \"item " + std::to_string(i) + "\"},\n";
+    }
+    json += "null]";
+    expect_file_decoded(json);
+}
+
+TEST(QJson_File, ends_at_page_boundary)
+{
+    std::string json = "[\"" + std::string(4096 - 4, 'x') + "\"]";
+    ASSERT_EQ(4096u, json.size());
+    expect_file_decoded(json);
+}
+
+TEST(QJson_File, errors)
+{
+    managed_free_all();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    parse_test_context* context = new parse_test_context();
+    ASSERT_FALSE(qjson_parse_file("/nonexistent/qjson_test.json", &callbacks, context));
+    ASSERT_EQ(TYPE_ERROR, parse_get_type(context, 0));
+    ASSERT_STREQ("Could not open /nonexistent/qjson_test.json: No such file or directory", parse_get_string(context, 0));
+    delete context;
+
+    std::string path = write_temp_file("");
+    context = new parse_test_context();
+    ASSERT_FALSE(qjson_parse_file(path.c_str(), &callbacks, context));
+    ASSERT_STREQ("Unexpected end of document at offset 0", parse_get_string(context, 0));
+    delete context;
+    unlink(path.c_str());
+
+    path = write_temp_file("[1, 2");
+    context = new parse_test_context();
+    ASSERT_FALSE(qjson_parse_file(path.c_str(), &callbacks, context));
+    ASSERT_STREQ("Unexpected end of document at offset 5", parse_get_string(context, parse_get_item_count(context) - 1));
+    delete context;
+    unlink(path.c_str());
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.hpp>
+#include <string>
+
+// Renders the delivered events as text.
+struct text_handler
+{
+    std::string events;
+    std::string error;
+    const char* data = nullptr;
+    size_t data_length = 0;
+    size_t strings_in_data = 0;
+
+    void append(const std::string& text) { events += text; }
+
+    void on_parse_error(std::string_view message) { error = message; }
+    void on_null()                                { append("n "); }
+    void on_boolean(bool value)                   { append(value ? "t " : "f "); }
+    void on_int(int64_t value)                    { append(std::to_string(value) + " "); }
+    void on_float(double value)                   { append(std::to_string(value) + " "); }
+    void on_list_start()                          { append("[ "); }
+    void on_list_end()                            { append("] "); }
+    void on_map_start()                           { append("{ "); }
+    void on_map_end()                             { append("} "); }
+
+    void on_string(std::string_view value)
+    {
+        append("\"" + std::string(value) + "\" ");
+        if(value.data() >= data && value.data() < data + data_length)
+        {
+            strings_in_data++;
+        }
+    }
+};
+
+// Also takes map keys separately.
+struct keys_handler: public text_handler
+{
+    void on_map_key(std::string_view key) { append("#" + std::string(key) + " "); }
+};
+
+template<typename Handler>
+static Handler parse(const std::string& json, bool expect_success = true)
+{
+    Handler handler;
+    handler.data = json.data();
+    handler.data_length = json.size();
+    EXPECT_EQ(expect_success, qjson::parse(json, handler)) << handler.error;
+    return handler;
+}
+
+// Parses with the C API, for comparison.
+static std::string c_parse_error(const std::string& json)
+{
+    static const qjson_parse_callbacks callbacks =
+    {
+        [](void* context, const char* message) { *(std::string*)context = message; },
+        [](void*) {},
+        [](void*, bool) {},
+        [](void*, int64_t) {},
+        [](void*, double) {},
+        [](void*, const char*) {},
+        [](void*) {},
+        [](void*) {},
+        [](void*) {},
+        [](void*) {},
+    };
+    std::string error;
+    EXPECT_FALSE(qjson_parse_buffer(json.data(), json.size(), &callbacks, &error));
+    return error;
+}
+
+TEST(QJson_Hpp, values)
+{
+    ASSERT_EQ("{ \"a\" [ 1 -2.500000 t f n \"x\" ] \"b\" { } \"c\" [ ] } ",
+              parse<text_handler>(" {\"a\": [1, -2.5, true, false, null, \"x\"], \"b\": {}, \"c\": [ ]} ").events);
+    ASSERT_EQ("9223372036854775807 ", parse<text_handler>("9223372036854775807").events);
+    ASSERT_EQ("\"\" ", parse<text_handler>("\"\"").events);
+}
+
+TEST(QJson_Hpp, map_keys)
+{
+    ASSERT_EQ("{ #a 1 #b\tc { #d \"e\" } } ", parse<keys_handler>("{\"a\": 1, \"b\\tc\": {\"d\": \"e\"}}").events);
+}
+
+TEST(QJson_Hpp, strings)
+{
+    std::string json = "[\"plain\", \"esc\\\"aped\\u00e9\", \"\xc3\xa9t\xc3\xa9\", \"ctrl\\n\"]";
+    text_handler handler = parse<text_handler>(json);
+    ASSERT_EQ("[ \"plain\" \"esc\"aped\xc3\xa9\" \"\xc3\xa9t\xc3\xa9\" \"ctrl\n\" ] ", handler.events);
+    // Plain ASCII strings are viewed in place.
+    ASSERT_EQ(1u, handler.strings_in_data);
+
+    std::string long_string(10000, 'z');
+    ASSERT_EQ("[ \"" + long_string + "\n\" \"a\" ] ", parse<text_handler>("[\"" + long_string + "\\n\", \"\\u0061\"]").events);
+}
+
+TEST(QJson_Hpp, deep_nesting)
+{
+    const int depth = 1000;
+    std::string json = std::string(depth, '[') + std::string(depth, ']');
+    std::string expected;
+    for(int i = 0; i < depth; i++)
+    {
+        expected += "[ ";
+    }
+    for(int i = 0; i < depth; i++)
+    {
+        expected += "] ";
+    }
+    ASSERT_EQ(expected, parse<text_handler>(json).events);
+}
+
+TEST(QJson_Hpp, errors)
+{
+    // Errors are reported exactly as the C parser reports them.
+    for(const char* json: {
+        "",
+        "  ",
+        "[1, 2",
+        "[1, ]",
+        "[1} ",
+        "{\"a\" 1}",
+        "{1: 2}",
+        "{\"a\": 1,}",
+        "[1] x",
+        "[tru]",
+        "nul",
+        "[-]",
+        "1e+",
+        "99999999999999999999",
+        "1e999",
+        "[\"a\\qb\"]",
+        "\"bad \xff utf-8\"",
+        "\"a\x01\x1f b\"",
+        "[\"tab\there\"]",
+        "[\"a long enough string to be decoded with vectors \x1f\"]",
+        "[\"unterminated]",
+    })
+    {
+        text_handler handler = parse<text_handler>(json, false);
+        ASSERT_EQ(c_parse_error(json), handler.error) << json;
+    }
+    ASSERT_EQ("Unexpected token: 'x' at offset 10", parse<text_handler>("[1, {\"a\": x}]", false).error);
+}
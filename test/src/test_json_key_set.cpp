@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <string>
+#include <vector>
+
+// Collects keys as "#id" (or "?key" when unknown), and the other events as text.
+struct keys_context
+{
+    std::string events;
+    std::string error;
+    int skip_key_id = QJSON_UNKNOWN_KEY;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    ((keys_context*)context)->events += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((keys_context*)context)->error = message; }
+
+static qjson_action on_map_key(void* context, const char* key, size_t length, int key_id)
+{
+    EXPECT_EQ(strlen(key), length);
+    if(key_id == QJSON_UNKNOWN_KEY)
+    {
+        return text_recorder_add(context, (std::string("?") + key + " ").c_str());
+    }
+    text_recorder_add(context, ("#" + std::to_string(key_id) + " ").c_str());
+    keys_context* keys = (keys_context*)text_recorder_get_context(context);
+    return key_id == keys->skip_key_id ? QJSON_SKIP_CONTAINER : QJSON_CONTINUE;
+}
+
+static qjson_action_callbacks new_callbacks(const qjson_key_set* key_set)
+{
+    qjson_action_callbacks callbacks = text_recorder_new_action_callbacks();
+    callbacks.on_map_key = on_map_key;
+    callbacks.key_set = key_set;
+    return callbacks;
+}
+
+static keys_context parse(const std::string& json, const qjson_key_set* key_set, int skip_key_id = QJSON_UNKNOWN_KEY)
+{
+    keys_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    context.skip_key_id = skip_key_id;
+    qjson_action_callbacks callbacks = new_callbacks(key_set);
+    EXPECT_TRUE(qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder)) << context.error;
+    return context;
+}
+
+static qjson_key_set* new_key_set(const std::vector<const char*>& keys)
+{
+    return qjson_new_key_set(keys.data(), keys.size());
+}
+
+TEST(QJson_KeySet, key_ids)
+{
+    qjson_key_set* key_set = new_key_set({"id", "name", "tags", "a much longer key that spans several words"});
+    ASSERT_TRUE(key_set != NULL);
+    ASSERT_EQ("{ #1 \"x\" #0 1 ?other { #2 [ ] } #3 n } ",
+              parse("{\"name\": \"x\", \"id\": 1, \"other\": {\"tags\": []}, \"a much longer key that spans several words\": null}", key_set).events);
+    // Keys only differing by length or in their last word are told apart.
+    ASSERT_EQ("{ ?i 1 ?idx 2 ?a much longer key that spans several wordz 3 } ",
+              parse("{\"i\": 1, \"idx\": 2, \"a much longer key that spans several wordz\": 3}", key_set).events);
+    // String values are not keys.
+    ASSERT_EQ("[ \"id\" ] ", parse("[\"id\"]", key_set).events);
+    qjson_free_key_set(key_set);
+}
+
+TEST(QJson_KeySet, escaped_keys)
+{
+    qjson_key_set* key_set = new_key_set({"id", "back\\slash", "\xc3\xa9t\xc3\xa9"});
+    ASSERT_TRUE(key_set != NULL);
+    ASSERT_EQ("{ #0 1 #1 2 #2 3 #2 4 ?back\\\\slash 5 } ",
+              parse("{\"\\u0069d\": 1, \"back\\\\slash\": 2, \"\\u00e9t\\u00e9\": 3, \"\xc3\xa9t\xc3\xa9\": 4, \"back\\\\\\\\slash\": 5}", key_set).events);
+    qjson_free_key_set(key_set);
+}
+
+TEST(QJson_KeySet, no_key_set)
+{
+    ASSERT_EQ("{ ?a 1 ?b\\c 2 } ", parse("{\"a\": 1, \"b\\\\c\": 2}", NULL).events);
+}
+
+TEST(QJson_KeySet, older_table_version)
+{
+    keys_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks(NULL);
+    callbacks.version = 1;
+    std::string json = "{\"a\": 1}";
+    ASSERT_TRUE(qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder));
+    ASSERT_EQ("{ \"a\" 1 } ", context.events);
+}
+
+TEST(QJson_KeySet, skip_from_key)
+{
+    qjson_key_set* key_set = new_key_set({"skip", "keep"});
+    ASSERT_EQ("{ #1 { #0 } #1 t } ", parse("{\"keep\": {\"skip\": [1, {\"keep\": 2}], \"keep\": 3}, \"keep\": true}", key_set, 0).events);
+    qjson_free_key_set(key_set);
+}
+
+TEST(QJson_KeySet, many_keys)
+{
+    std::vector<std::string> keys;
+    for(int i = 0; i < 5000; i++)
+    {
+        keys.push_back("field_" + std::to_string(i * 7919));
+    }
+    std::vector<const char*> key_pointers;
+    std::string json = "{";
+    for(const std::string& key: keys)
+    {
+        key_pointers.push_back(key.c_str());
+        json += "\"" + key + "\": 0, ";
+    }
+    json += "\"field_1\": 0}";
+    qjson_key_set* key_set = new_key_set(key_pointers);
+    ASSERT_TRUE(key_set != NULL);
+
+    std::string expected = "{ ";
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        expected += "#" + std::to_string(i) + " 0 ";
+    }
+    expected += "?field_1 0 } ";
+    ASSERT_EQ(expected, parse(json, key_set).events);
+    qjson_free_key_set(key_set);
+}
+
+TEST(QJson_KeySet, in_chunks)
+{
+    qjson_key_set* key_set = new_key_set({"alpha", "beta"});
+    keys_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks(key_set);
+    qjson_parser* parser = qjson_new_parser(NULL, NULL);
+    qjson_reset_parser_with_actions(parser, &callbacks, &recorder);
+    std::string json = "{\"alpha\": 1, \"be\\u0074a\": 2, \"gamma\": 3}";
+    for(size_t i = 0; i < json.size(); i++)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + i, 1));
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    ASSERT_EQ("{ #0 1 #1 2 ?gamma 3 } ", context.events);
+    qjson_free_parser(parser);
+    qjson_free_key_set(key_set);
+}
+
+TEST(QJson_KeySet, bad_key_sets)
+{
+    ASSERT_TRUE(new_key_set({"a", "b", "a"}) == NULL);
+    ASSERT_TRUE(new_key_set({"bad \xff utf-8"}) == NULL);
+
+    qjson_key_set* empty = new_key_set({});
+    ASSERT_TRUE(empty != NULL);
+    ASSERT_EQ("{ ?a 1 } ", parse("{\"a\": 1}", empty).events);
+    qjson_free_key_set(empty);
+}
+
+TEST(QJson_KeySet, bad_key_in_document)
+{
+    qjson_key_set* key_set = new_key_set({"a"});
+    keys_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks(key_set);
+    std::string json = "{\"\\q\": 1}";
+    ASSERT_FALSE(qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder));
+    ASSERT_EQ("Bad encoding: invalid escape sequence at offset 2", context.error);
+    qjson_free_key_set(key_set);
+}
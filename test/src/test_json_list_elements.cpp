@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Collects each element's events as text. Every thread has a context of its own, so no locking is needed.
+struct elements_context
+{
+    std::map<size_t, std::string> elements;
+    std::string current;
+    std::string error;
+    bool is_in_element = false;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    ((elements_context*)context)->current += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((elements_context*)context)->error = message; }
+
+static void on_element_start(void* context, size_t element_index)
+{
+    elements_context* elements = (elements_context*)text_recorder_get_context(context);
+    EXPECT_FALSE(elements->is_in_element);
+    EXPECT_EQ(0u, elements->elements.count(element_index));
+    elements->is_in_element = true;
+    elements->current.clear();
+}
+
+static void on_element_end(void* context, size_t element_index)
+{
+    elements_context* elements = (elements_context*)text_recorder_get_context(context);
+    elements->elements[element_index] = elements->current;
+    elements->is_in_element = false;
+}
+
+static const qjson_parse_callbacks g_callbacks = text_recorder_new_callbacks();
+
+static const qjson_document_callbacks g_element_callbacks =
+{
+    on_element_start, on_element_end,
+};
+
+// The results of all threads, merged.
+struct parse_result
+{
+    bool is_successful;
+    std::vector<std::string> elements;
+    std::string error;
+    size_t element_count = 0;
+};
+
+static parse_result parse_elements(const std::string& input, int thread_count)
+{
+    std::vector<elements_context> contexts(thread_count < 1 ? 1 : thread_count);
+    std::vector<text_recorder> recorders;
+    for(elements_context& context: contexts)
+    {
+        recorders.push_back({on_text, on_parse_error, &context});
+    }
+    std::vector<void*> context_pointers;
+    for(text_recorder& recorder: recorders)
+    {
+        context_pointers.push_back(&recorder);
+    }
+
+    parse_result result;
+    result.is_successful = qjson_parse_list_elements(input.data(), input.size(), &g_callbacks, &g_element_callbacks,
+                                                     context_pointers.data(), thread_count);
+    for(const elements_context& context: contexts)
+    {
+        for(const auto& element: context.elements)
+        {
+            if(result.elements.size() <= element.first)
+            {
+                result.elements.resize(element.first + 1);
+            }
+            result.elements[element.first] = element.second;
+            result.element_count++;
+        }
+        if(!context.error.empty())
+        {
+            EXPECT_EQ("", result.error);
+            result.error = context.error;
+        }
+    }
+    return result;
+}
+
+static std::string make_record(int index)
+{
+    return "{\"id\": " + std::to_string(index) +
+           ", \"name\": \"record, [" + std::to_string(index) + "] {\\\"\"" +
+           ", \"tags\": [true, false, null, " + std::to_string(index * 0.5) + ", {\"x\": []}]}";
+}
+
+static std::string expected_record(int index)
+{
+    return "{ \"id\" " + std::to_string(index) +
+           " \"name\" \"record, [" + std::to_string(index) + "] {\"\"" +
+           " \"tags\" [ t f n " + std::to_string(index * 0.5) + " { \"x\" [ ] } ] } ";
+}
+
+static std::string make_list(int record_count)
+{
+    std::string input = "[\n";
+    for(int i = 0; i < record_count; i++)
+    {
+        input += (i > 0 ? ",\n  " : "  ") + make_record(i);
+    }
+    return input + "\n]\n";
+}
+
+TEST(QJson_ListElements, small_list)
+{
+    for(int thread_count: {1, 4})
+    {
+        parse_result result = parse_elements(" [1, \"a,]\", [2, [3]], {\"b\": [4]}, null] ", thread_count);
+        ASSERT_TRUE(result.is_successful) << result.error;
+        ASSERT_EQ(5u, result.element_count);
+        ASSERT_EQ("1 ", result.elements[0]);
+        ASSERT_EQ("\"a,]\" ", result.elements[1]);
+        ASSERT_EQ("[ 2 [ 3 ] ] ", result.elements[2]);
+        ASSERT_EQ("{ \"b\" [ 4 ] } ", result.elements[3]);
+        ASSERT_EQ("n ", result.elements[4]);
+    }
+}
+
+TEST(QJson_ListElements, empty_list)
+{
+    for(const char* input: {"[]", " [ \n ] "})
+    {
+        parse_result result = parse_elements(input, 4);
+        ASSERT_TRUE(result.is_successful) << result.error;
+        ASSERT_EQ(0u, result.element_count);
+    }
+}
+
+TEST(QJson_ListElements, large_list)
+{
+    const int record_count = 20000;
+    std::string input = make_list(record_count);
+    for(int thread_count: {0, 1, 2, 4, 7})
+    {
+        parse_result result = parse_elements(input, thread_count);
+        ASSERT_TRUE(result.is_successful) << result.error;
+        ASSERT_EQ((size_t)record_count, result.element_count);
+        for(int i = 0; i < record_count; i++)
+        {
+            ASSERT_EQ(expected_record(i), result.elements[i]) << "element " << i;
+        }
+    }
+}
+
+TEST(QJson_ListElements, errors)
+{
+    for(int thread_count: {1, 4})
+    {
+        ASSERT_EQ("Unexpected token: '{' at offset 1", parse_elements(" {\"a\": 1}", thread_count).error);
+        ASSERT_EQ("Unexpected end of document at offset 2", parse_elements("  ", thread_count).error);
+        ASSERT_EQ("Unexpected end of document at offset 6", parse_elements("[1, 2 ", thread_count).error);
+        ASSERT_EQ("Unexpected token: '}' at offset 5", parse_elements("[1, 2}", thread_count).error);
+        ASSERT_EQ("Unexpected token: ']' at offset 4", parse_elements("[1, ]", thread_count).error);
+        ASSERT_EQ("Unexpected token: 'x' at offset 4", parse_elements("[1] x", thread_count).error);
+        ASSERT_EQ("Unexpected token: 'x' at offset 3", parse_elements("[] x", thread_count).error);
+    }
+}
+
+TEST(QJson_ListElements, large_list_errors)
+{
+    const int record_count = 20000;
+    std::string list = make_list(record_count);
+    std::string bad_element = list;
+    const size_t bad_offset = bad_element.find("\"id\": 14000") + 6;
+    bad_element[bad_offset] = 'x';
+    std::string truncated = list.substr(0, list.size() - 3);
+    std::string trailing = list + "[1, 2]";
+
+    for(int thread_count: {1, 4})
+    {
+        ASSERT_EQ("Unexpected token: 'x' at offset " + std::to_string(bad_offset),
+                  parse_elements(bad_element, thread_count).error);
+        ASSERT_EQ("Unexpected end of document at offset " + std::to_string(truncated.size()),
+                  parse_elements(truncated, thread_count).error);
+        ASSERT_EQ("Unexpected token: '[' at offset " + std::to_string(list.size()),
+                  parse_elements(trailing, thread_count).error);
+    }
+}
@@ -2,7 +2,10 @@
 #include <qjson/qjson.h>
 #include "parse_test_helpers.h"
 #include "managed_allocator.h"
+#include "number_parser.h"
 #include <stdarg.h>
+#include <string.h>
+#include <string>
 
 void expect_decoded(const char* json, ...)
 {
@@ -103,7 +106,7 @@ TEST(QJson_Parse, string)
 
 TEST(QJson_Parse, string_multiline)
 {
-    expect_decoded("\"multi\nline\"", TYPE_STRING, "multi\nline", 0);
+    expect_decoded("\"multi\\nline\"", TYPE_STRING, "multi\nline", 0);
 }
 
 TEST(QJson_Parse, string_quoted)
@@ -156,6 +159,8 @@ TEST(QJson_Parse, integer)
 {
     expect_decoded("10000", TYPE_INT, (int64_t)10000, 0);
     expect_decoded("-5123", TYPE_INT, (int64_t)-5123, 0);
+    expect_decoded("9223372036854775807", TYPE_INT, (int64_t)INT64_MAX, 0);
+    expect_decoded("-9223372036854775808", TYPE_INT, (int64_t)INT64_MIN, 0);
 }
 
 TEST(QJson_Parse, float)
@@ -170,6 +175,22 @@ TEST(QJson_Parse, float)
     expect_decoded("-1.84E-9", TYPE_FLOAT, -1.84e-9, 0);
 }
 
+TEST(QJson_Parse, float_rounding)
+{
+    expect_decoded("0.1", TYPE_FLOAT, 0.1, 0);
+    expect_decoded("12345678901234567890.5", TYPE_FLOAT, 12345678901234567890.5, 0);
+    expect_decoded("0.000000000000000000000123456789012345678901", TYPE_FLOAT, 1.23456789012345678901e-22, 0);
+    expect_decoded("1.7976931348623157e308", TYPE_FLOAT, 1.7976931348623157e308, 0);
+    expect_decoded("2.2250738585072011e-308", TYPE_FLOAT, 2.2250738585072011e-308, 0);
+    expect_decoded("4.9406564584124654e-324", TYPE_FLOAT, 4.9406564584124654e-324, 0);
+    expect_decoded("1e-400", TYPE_FLOAT, 0.0, 0);
+    // Exactly halfway between two doubles: rounds to even.
+    expect_decoded("9007199254740993.0", TYPE_FLOAT, 9007199254740992.0, 0);
+    expect_decoded("1.00000000000000011102230246251565404236316680908203125", TYPE_FLOAT, 1.0, 0);
+    // Just past halfway, decided by the 54th significant digit.
+    expect_decoded("1.000000000000000111022302462515654042363166809082031251", TYPE_FLOAT, 1.0000000000000002, 0);
+}
+
 TEST(QJson_Parse, boolean)
 {
     expect_decoded("true", TYPE_BOOLEAN, (int)true, 0);
@@ -231,3 +252,139 @@ TEST(QJson_Parse, fail_bad_slash)
     expect_decode_failure("\"\\u00\"");
     expect_decode_failure("\"\\u000\"");
 }
+
+TEST(QJson_Parse, string_surrogate_pair)
+{
+    expect_decoded("\"\\ud83d\\ude00\"", TYPE_STRING, "\xf0\x9f\x98\x80", 0);
+}
+
+TEST(QJson_Parse, empty_containers)
+{
+    expect_decoded("[ ]", TYPE_LIST_START, TYPE_LIST_END, 0);
+    expect_decoded("{ }", TYPE_MAP_START, TYPE_MAP_END, 0);
+    expect_decoded("[[],{}]", TYPE_LIST_START, TYPE_LIST_START, TYPE_LIST_END, TYPE_MAP_START, TYPE_MAP_END, TYPE_LIST_END, 0);
+}
+
+TEST(QJson_Parse, deep_nesting)
+{
+    const int depth = 1000;
+    std::string json(depth, '[');
+    json += std::string(depth, ']');
+    parse_test_context* context = new parse_test_context();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    ASSERT_TRUE(qjson_parse_string(json.c_str(), &callbacks, context));
+    ASSERT_EQ(depth * 2, parse_get_item_count(context));
+    ASSERT_EQ(TYPE_LIST_START, parse_get_type(context, depth - 1));
+    ASSERT_EQ(TYPE_LIST_END, parse_get_type(context, depth));
+    delete context;
+}
+
+TEST(QJson_Parse, fail_trailing_data)
+{
+    expect_decode_failure("[1, 2] 3");
+    expect_decode_failure("truex");
+    expect_decode_failure("01");
+}
+
+TEST(QJson_Parse, fail_bad_number)
+{
+    expect_decode_failure("-");
+    expect_decode_failure("1.");
+    expect_decode_failure("1e");
+    expect_decode_failure("9223372036854775808");
+    expect_decode_failure("-9223372036854775809");
+    expect_decode_failure("123456789012345678901234567890");
+    expect_decode_failure("1.8e308");
+    expect_decode_failure("-1e400");
+    expect_decode_failure("1.e5");
+    expect_decode_failure("1e+");
+}
+
+TEST(QJson_Parse, number_parser_errors)
+{
+    struct
+    {
+        const char* text;
+        number_status status;
+        size_t end_offset;
+    } cases[] =
+    {
+        {"-",   NUMBER_STATUS_INCOMPLETE, 1},
+        {"",    NUMBER_STATUS_INCOMPLETE, 0},
+        {"1.",  NUMBER_STATUS_INCOMPLETE, 2},
+        {"1e",  NUMBER_STATUS_INCOMPLETE, 2},
+        {"-x",  NUMBER_STATUS_INVALID,    1},
+        {"1.e", NUMBER_STATUS_INVALID,    2},
+    };
+    for(const auto& c: cases)
+    {
+        json_number number;
+        // Garbage that a failed parse must not leave behind.
+        memset(&number, 0x20, sizeof(number));
+        const char* end = c.text + strlen(c.text);
+        ASSERT_EQ(c.status, parse_json_number(c.text, end, &number)) << c.text;
+        ASSERT_EQ(c.text + c.end_offset, number.end) << c.text;
+        ASSERT_FALSE(number.is_float) << c.text;
+        ASSERT_EQ(0, number.int_value) << c.text;
+    }
+}
+
+TEST(QJson_Parse, fail_bad_utf8)
+{
+    expect_decode_failure("\"\xc3\"");
+    expect_decode_failure("\"\xed\xa0\x80\"");
+    expect_decode_failure("[\"a long enough string to be decoded with vectors \xff\"]");
+}
+
+TEST(QJson_Parse, fail_control_character)
+{
+    expect_decode_failure("\"a\x01\x1f b\"");
+    expect_decode_failure("[\"tab\there\"]");
+    expect_decode_failure("{\"line\nbreak\": 1}");
+    expect_decode_failure("[\"a long enough string to be decoded with vectors \x1f\"]");
+}
+
+TEST(QJson_Parse, fail_bad_surrogate)
+{
+    expect_decode_failure("\"\\ud83d\"");
+    expect_decode_failure("\"\\ude00\"");
+    expect_decode_failure("\"\\ud83d\\u0041\"");
+}
+
+static int parse_buffer(parse_test_context* context, const char* data, size_t length)
+{
+    managed_free_all();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    return qjson_parse_buffer(data, length, &callbacks, context) ? parse_get_item_count(context) : -1;
+}
+
+TEST(QJson_Parse, buffer_not_null_terminated)
+{
+    parse_test_context* context = new parse_test_context();
+    const char data[] = {'[', '1', '.', '5', ',', '"', 'a', 'b', '"', ']', '9', '9'};
+    ASSERT_EQ(4, parse_buffer(context, data, 10));
+    ASSERT_EQ(TYPE_LIST_START, parse_get_type(context, 0));
+    ASSERT_EQ(1.5, parse_get_float(context, 1));
+    ASSERT_STREQ("ab", parse_get_string(context, 2));
+    ASSERT_EQ(TYPE_LIST_END, parse_get_type(context, 3));
+    delete context;
+}
+
+TEST(QJson_Parse, buffer_truncated)
+{
+    parse_test_context* context = new parse_test_context();
+    const char* data = "1.25e+10";
+    ASSERT_EQ(1, parse_buffer(context, data, 4));
+    ASSERT_EQ(1.25, parse_get_float(context, 0));
+    ASSERT_EQ(-1, parse_buffer(context, data, 2));
+    ASSERT_EQ(-1, parse_buffer(context, "\"abc\"", 4));
+    ASSERT_EQ(-1, parse_buffer(context, "null", 3));
+    delete context;
+}
+
+TEST(QJson_Parse, buffer_embedded_null)
+{
+    parse_test_context* context = new parse_test_context();
+    ASSERT_EQ(-1, parse_buffer(context, "[1,\0 2]", 7));
+    delete context;
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <string>
+#include <vector>
+
+// Collects the delivered events as text.
+struct filter_context
+{
+    std::string events;
+    std::string error;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    ((filter_context*)context)->events += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((filter_context*)context)->error = message; }
+
+static const qjson_parse_callbacks g_callbacks = text_recorder_new_callbacks();
+
+static filter_context parse_filtered(const std::string& json, const std::vector<const char*>& paths, bool expect_success = true)
+{
+    filter_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_path_filter* filter = qjson_new_path_filter(paths.data(), paths.size());
+    EXPECT_TRUE(filter != NULL);
+    if(filter != NULL)
+    {
+        EXPECT_EQ(expect_success, qjson_parse_buffer_filtered(json.data(), json.size(), filter, &g_callbacks, &recorder)) << context.error;
+        qjson_free_path_filter(filter);
+    }
+    return context;
+}
+
+static const char* g_record = "{\"id\": 7, \"user\": {\"name\": \"Ann\", \"tags\": [\"a\", \"b\"], \"bio\": \"long \\\"text\\\"\"}, "
+                              "\"events\": [{\"ts\": 1, \"x\": [1,2]}, {\"ts\": 2}, {\"y\": null}], \"ok\": true}";
+
+TEST(QJson_PathFilter, single_field)
+{
+    ASSERT_EQ("{ \"id\" 7 } ", parse_filtered(g_record, {"/id"}).events);
+    ASSERT_EQ("{ \"ok\" t } ", parse_filtered(g_record, {"/ok"}).events);
+}
+
+TEST(QJson_PathFilter, nested_field)
+{
+    ASSERT_EQ("{ \"user\" { \"name\" \"Ann\" } } ", parse_filtered(g_record, {"/user/name"}).events);
+    ASSERT_EQ("{ \"user\" { \"tags\" [ \"a\" \"b\" ] } } ", parse_filtered(g_record, {"/user/tags"}).events);
+    ASSERT_EQ("{ \"user\" { \"tags\" [ \"b\" ] } } ", parse_filtered(g_record, {"/user/tags/1"}).events);
+}
+
+TEST(QJson_PathFilter, several_paths)
+{
+    ASSERT_EQ("{ \"id\" 7 \"user\" { \"name\" \"Ann\" } \"ok\" t } ",
+              parse_filtered(g_record, {"/ok", "/user/name", "/id"}).events);
+}
+
+TEST(QJson_PathFilter, wildcards)
+{
+    ASSERT_EQ("{ \"events\" [ { \"ts\" 1 } { \"ts\" 2 } ] } ", parse_filtered(g_record, {"/events/*/ts"}).events);
+    ASSERT_EQ("{ \"user\" { \"name\" \"Ann\" \"tags\" [ \"a\" \"b\" ] \"bio\" \"long \"text\"\" } } ",
+              parse_filtered(g_record, {"/user/*"}).events);
+}
+
+TEST(QJson_PathFilter, whole_document)
+{
+    ASSERT_EQ("[ 1 { \"a\" n } ] ", parse_filtered("[1, {\"a\": null}]", {""}).events);
+    ASSERT_EQ("\"top\" ", parse_filtered(" \"top\" ", {""}).events);
+}
+
+TEST(QJson_PathFilter, nothing_selected)
+{
+    ASSERT_EQ("", parse_filtered(g_record, {"/missing"}).events);
+    ASSERT_EQ("", parse_filtered(g_record, {"/id/deeper"}).events);
+    ASSERT_EQ("", parse_filtered(g_record, {"/events/9"}).events);
+    ASSERT_EQ("", parse_filtered(g_record, {}).events);
+}
+
+TEST(QJson_PathFilter, escaped_keys)
+{
+    const char* json = "{\"a/b\": 1, \"c~d\": 2, \"\\u0065\": 3, \"0\": 4}";
+    ASSERT_EQ("{ \"a/b\" 1 } ", parse_filtered(json, {"/a~1b"}).events);
+    ASSERT_EQ("{ \"c~d\" 2 } ", parse_filtered(json, {"/c~0d"}).events);
+    ASSERT_EQ("{ \"e\" 3 } ", parse_filtered(json, {"/e"}).events);
+    ASSERT_EQ("{ \"0\" 4 } ", parse_filtered(json, {"/0"}).events);
+}
+
+TEST(QJson_PathFilter, list_indices)
+{
+    ASSERT_EQ("[ 30 ] ", parse_filtered("[10, 20, 30]", {"/2"}).events);
+    ASSERT_EQ("", parse_filtered("[10, 20, 30]", {"/02"}).events);
+    ASSERT_EQ("", parse_filtered("[10, 20, 30]", {"/x"}).events);
+}
+
+TEST(QJson_PathFilter, skipped_values_are_not_decoded)
+{
+    // The skipped string holds an invalid escape and the skipped number is out of range, but neither is converted.
+    ASSERT_EQ("{ \"b\" 1 } ", parse_filtered("{\"a\": [\"\\q\", 1e999999], \"b\": 1}", {"/b"}).events);
+}
+
+TEST(QJson_PathFilter, bad_paths)
+{
+    const char* no_slash[] = {"a"};
+    const char* bad_escape[] = {"/a~2"};
+    const char* trailing_tilde[] = {"/a~"};
+    ASSERT_TRUE(qjson_new_path_filter(no_slash, 1) == NULL);
+    ASSERT_TRUE(qjson_new_path_filter(bad_escape, 1) == NULL);
+    ASSERT_TRUE(qjson_new_path_filter(trailing_tilde, 1) == NULL);
+
+    std::vector<const char*> too_many(QJSON_MAX_FILTER_PATHS + 1, "/a");
+    ASSERT_TRUE(qjson_new_path_filter(too_many.data(), too_many.size()) == NULL);
+}
+
+TEST(QJson_PathFilter, max_paths)
+{
+    std::vector<std::string> keys;
+    std::vector<const char*> paths;
+    std::string json = "{";
+    for(int i = 0; i < QJSON_MAX_FILTER_PATHS; i++)
+    {
+        keys.push_back("/k" + std::to_string(i));
+        json += (i > 0 ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    json += "}";
+    for(const std::string& key: keys)
+    {
+        paths.push_back(key.c_str());
+    }
+    filter_context context = parse_filtered(json, paths);
+    ASSERT_EQ(0u, context.events.find("{ \"k0\" 0 "));
+    ASSERT_NE(std::string::npos, context.events.find("\"k63\" 63 } "));
+}
+
+TEST(QJson_PathFilter, errors)
+{
+    ASSERT_EQ("Unexpected token: 'x' at offset 14", parse_filtered("{\"a\": 1, \"b\": x}", {"/b"}, false).error);
+    ASSERT_EQ("Unexpected end of document at offset 11", parse_filtered("{\"a\": [1, 2", {"/b"}, false).error);
+    ASSERT_EQ("Unexpected token: ']' at offset 8", parse_filtered("{\"a\": 1 ]", {"/b"}, false).error);
+    ASSERT_EQ("Unexpected token: '2' at offset 4", parse_filtered("[1] 2", {"/0"}, false).error);
+    ASSERT_EQ("Unexpected end of document at offset 2", parse_filtered("  ", {}, false).error);
+    ASSERT_EQ("Bad encoding: invalid escape sequence at offset 2", parse_filtered("{\"\\q\": 1}", {"/*"}, false).error);
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include <string.h>
+#include <string>
+
+// Collects raw numbers as "<text>/<flags>", converted ones with their type, and everything else as text.
+struct raw_context
+{
+    std::string events;
+    std::string error;
+    std::string stop_at;
+};
+
+static qjson_action on_text(void* context, const char* text)
+{
+    ((raw_context*)context)->events += text;
+    return QJSON_CONTINUE;
+}
+
+static void on_parse_error(void* context, const char* message) { ((raw_context*)context)->error = message; }
+
+static qjson_action on_int(void* context, int64_t value)
+{
+    return text_recorder_add(context, ("int:" + std::to_string(value) + " ").c_str());
+}
+
+static qjson_action on_float(void* context, double value)
+{
+    return text_recorder_add(context, ("float:" + std::to_string(value) + " ").c_str());
+}
+
+static qjson_action on_number_raw(void* context, const char* start, size_t length, int flags)
+{
+    std::string text(start, length);
+    text_recorder_add(context, (text + "/" + std::to_string(flags) + " ").c_str());
+    return text == ((raw_context*)text_recorder_get_context(context))->stop_at ? QJSON_STOP : QJSON_CONTINUE;
+}
+
+static qjson_action_callbacks new_callbacks()
+{
+    qjson_action_callbacks callbacks = text_recorder_new_action_callbacks();
+    callbacks.on_int = on_int;
+    callbacks.on_float = on_float;
+    callbacks.on_number_raw = on_number_raw;
+    return callbacks;
+}
+
+static raw_context parse(const std::string& json, bool expect_success = true)
+{
+    raw_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks();
+    EXPECT_EQ(expect_success, qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder)) << context.error;
+    return context;
+}
+
+TEST(QJson_RawNumbers, lexemes)
+{
+    ASSERT_EQ("[ 0/0 -12/0 3.25/1 1e5/2 -1.5E-3/3 ] ", parse("[0, -12, 3.25, 1e5, -1.5E-3]").events);
+    ASSERT_EQ("42/0 ", parse(" 42 ").events);
+}
+
+TEST(QJson_RawNumbers, not_converted)
+{
+    // Numbers that do not fit an int64 or a double arrive as they are.
+    ASSERT_EQ("{ \"id\" 123456789012345678901234567890/0 \"big\" 1e999999/2 \"precise\" 0.10000000000000000000001/1 } ",
+              parse("{\"id\": 123456789012345678901234567890, \"big\": 1e999999, \"precise\": 0.10000000000000000000001}").events);
+}
+
+TEST(QJson_RawNumbers, stop)
+{
+    raw_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    context.stop_at = "2";
+    qjson_action_callbacks callbacks = new_callbacks();
+    std::string json = "[1, 2, 3]";
+    ASSERT_TRUE(qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder));
+    ASSERT_EQ("[ 1/0 2/0 ", context.events);
+}
+
+TEST(QJson_RawNumbers, in_chunks)
+{
+    raw_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks();
+    qjson_parser* parser = qjson_new_parser(NULL, NULL);
+    qjson_reset_parser_with_actions(parser, &callbacks, &recorder);
+    std::string json = "[12345678901234567890, -0.5e+10]";
+    for(size_t i = 0; i < json.size(); i++)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + i, 1));
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    ASSERT_EQ("[ 12345678901234567890/0 -0.5e+10/3 ] ", context.events);
+    qjson_free_parser(parser);
+}
+
+TEST(QJson_RawNumbers, older_table_version)
+{
+    raw_context context;
+    text_recorder recorder = {on_text, on_parse_error, &context};
+    qjson_action_callbacks callbacks = new_callbacks();
+    callbacks.version = 2;
+    std::string json = "[1, 2.5]";
+    ASSERT_TRUE(qjson_parse_buffer_with_actions(json.data(), json.size(), &callbacks, &recorder));
+    ASSERT_EQ("[ int:1 float:2.500000 ] ", context.events);
+}
+
+TEST(QJson_RawNumbers, errors)
+{
+    ASSERT_EQ("Unexpected token: 'x' at offset 3", parse("[1.x]", false).error);
+    ASSERT_EQ("Unexpected token: ']' at offset 2", parse("[-]", false).error);
+    ASSERT_EQ("Unexpected end of document at offset 3", parse("1e+", false).error);
+}
+
+TEST(QJson_RawNumbers, conversion)
+{
+    int64_t int_value = 0;
+    ASSERT_TRUE(qjson_number_to_int64("-9223372036854775808", 20, &int_value));
+    ASSERT_EQ(INT64_MIN, int_value);
+    ASSERT_FALSE(qjson_number_to_int64("9223372036854775808", 19, &int_value));
+    ASSERT_FALSE(qjson_number_to_int64("1.0", 3, &int_value));
+    ASSERT_FALSE(qjson_number_to_int64("12 ", 3, &int_value));
+
+    double float_value = 0;
+    ASSERT_TRUE(qjson_number_to_double("2.5e-3", 6, &float_value));
+    ASSERT_EQ(2.5e-3, float_value);
+    ASSERT_TRUE(qjson_number_to_double("42", 2, &float_value));
+    ASSERT_EQ(42.0, float_value);
+    ASSERT_TRUE(qjson_number_to_double("123456789012345678901234567890", 30, &float_value));
+    ASSERT_EQ(123456789012345678901234567890.0, float_value);
+    ASSERT_TRUE(qjson_number_to_double("-9007199254740993", 17, &float_value));
+    ASSERT_EQ(-9007199254740992.0, float_value);
+    ASSERT_FALSE(qjson_number_to_double("1e999999", 8, &float_value));
+    ASSERT_FALSE(qjson_number_to_double("1.", 2, &float_value));
+    ASSERT_FALSE(qjson_number_to_double("", 0, &float_value));
+}
+
+TEST(QJson_RawNumbers, parse_number_errors)
+{
+    struct
+    {
+        const char* text;
+        qjson_number_status status;
+        size_t end_offset;
+    } cases[] =
+    {
+        {"-",   QJSON_NUMBER_INCOMPLETE, 1},
+        {"",    QJSON_NUMBER_INCOMPLETE, 0},
+        {"1.",  QJSON_NUMBER_INCOMPLETE, 2},
+        {"1e",  QJSON_NUMBER_INCOMPLETE, 2},
+        {"-x",  QJSON_NUMBER_INVALID,    1},
+        {"1.e", QJSON_NUMBER_INVALID,    2},
+    };
+    for(const auto& c: cases)
+    {
+        qjson_number number;
+        // Garbage that a failed parse must not leave behind.
+        memset(&number, 0x20, sizeof(number));
+        const char* end = c.text + strlen(c.text);
+        ASSERT_EQ(c.status, qjson_parse_number(c.text, end, &number)) << c.text;
+        ASSERT_EQ(c.text + c.end_offset, number.end) << c.text;
+        ASSERT_FALSE(number.is_float) << c.text;
+    }
+
+    const char* out_of_range = "1e999";
+    qjson_number number;
+    ASSERT_EQ(QJSON_NUMBER_OUT_OF_RANGE, qjson_parse_number(out_of_range, out_of_range + 5, &number));
+    ASSERT_TRUE(number.is_float);
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "parse_test_helpers.h"
+#include "managed_allocator.h"
+#include <string.h>
+
+static void expect_same_events(parse_test_context* expected, parse_test_context* actual)
+{
+    ASSERT_EQ(parse_get_item_count(expected), parse_get_item_count(actual));
+    for(int i = 0; i < parse_get_item_count(expected); i++)
+    {
+        parsed_type type = parse_get_type(expected, i);
+        ASSERT_EQ(type, parse_get_type(actual, i));
+        switch(type)
+        {
+            case TYPE_BOOLEAN:
+                ASSERT_EQ(parse_get_bool(expected, i), parse_get_bool(actual, i));
+                break;
+            case TYPE_STRING:
+                ASSERT_STREQ(parse_get_string(expected, i), parse_get_string(actual, i));
+                break;
+            case TYPE_INT:
+                ASSERT_EQ(parse_get_int(expected, i), parse_get_int(actual, i));
+                break;
+            case TYPE_FLOAT:
+                ASSERT_EQ(parse_get_float(expected, i), parse_get_float(actual, i));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static bool parse_in_chunks(parse_test_context* context, const char* json, size_t length, size_t chunk_size)
+{
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    qjson_parser* parser = qjson_new_parser(&callbacks, context);
+    bool result = true;
+    for(size_t offset = 0; offset < length && result; offset += chunk_size)
+    {
+        size_t remaining = length - offset;
+        // Copy each chunk so that the parser cannot rely on earlier chunks staying valid.
+        std::string chunk(json + offset, remaining < chunk_size ? remaining : chunk_size);
+        result = qjson_feed_parser(parser, chunk.data(), chunk.size());
+    }
+    result = result && qjson_finish_parser(parser);
+    qjson_free_parser(parser);
+    return result;
+}
+
+static void expect_stream_decoded(const char* json)
+{
+    managed_free_all();
+    size_t length = strlen(json);
+    parse_test_context* expected = new parse_test_context();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    ASSERT_TRUE(qjson_parse_buffer(json, length, &callbacks, expected));
+
+    for(size_t chunk_size = 1; chunk_size <= length; chunk_size++)
+    {
+        parse_test_context* actual = new parse_test_context();
+        ASSERT_TRUE(parse_in_chunks(actual, json, length, chunk_size)) << "chunk size " << chunk_size;
+        expect_same_events(expected, actual);
+        delete actual;
+    }
+    delete expected;
+}
+
+static void expect_stream_failure(const char* json)
+{
+    managed_free_all();
+    size_t length = strlen(json);
+    for(size_t chunk_size = 1; chunk_size <= length; chunk_size++)
+    {
+        parse_test_context* context = new parse_test_context();
+        ASSERT_FALSE(parse_in_chunks(context, json, length, chunk_size)) << "chunk size " << chunk_size;
+        delete context;
+    }
+}
+
+TEST(QJson_Stream, scalars)
+{
+    expect_stream_decoded("12345");
+    expect_stream_decoded("-1.25e+10");
+    expect_stream_decoded("true");
+    expect_stream_decoded("false");
+    expect_stream_decoded("null");
+    expect_stream_decoded("  \"a string\"  ");
+}
+
+TEST(QJson_Stream, escapes)
+{
+    expect_stream_decoded("[\"a\\\\\", \"\\\"q\\\"\", \"\\u00df\\ud83d\\ude00\"]");
+}
+
+TEST(QJson_Stream, mixed)
+{
+    expect_stream_decoded("{\"a\": [1, 2.5, -3], \"b\": {\"c\": false, \"d\": null}, \"e\": [[], {}], \"f\": \"\\t\"}");
+}
+
+TEST(QJson_Stream, events_fire_before_finish)
+{
+    managed_free_all();
+    parse_test_context* context = new parse_test_context();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    qjson_parser* parser = qjson_new_parser(&callbacks, context);
+    ASSERT_TRUE(qjson_feed_parser(parser, "[1, \"ab", 7));
+    ASSERT_EQ(2, parse_get_item_count(context));
+    ASSERT_TRUE(qjson_feed_parser(parser, "c\", 2", 5));
+    ASSERT_EQ(3, parse_get_item_count(context));
+    ASSERT_STREQ("abc", parse_get_string(context, 2));
+    ASSERT_TRUE(qjson_feed_parser(parser, "]", 1));
+    ASSERT_EQ(5, parse_get_item_count(context));
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    qjson_free_parser(parser);
+    delete context;
+}
+
+TEST(QJson_Stream, failures)
+{
+    expect_stream_failure("[1, 2");
+    expect_stream_failure("[1, 2,]");
+    expect_stream_failure("\"unterminated");
+    expect_stream_failure("tru");
+    expect_stream_failure("trux");
+    expect_stream_failure("{\"a\" 1}");
+    expect_stream_failure("1 2");
+}
+
+TEST(QJson_Stream, empty)
+{
+    parse_test_context* context = new parse_test_context();
+    ASSERT_FALSE(parse_in_chunks(context, "", 0, 1));
+    delete context;
+}
+
+TEST(QJson_Reuse, parser_reset_between_documents)
+{
+    managed_free_all();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+    qjson_parser* parser = qjson_new_parser(&callbacks, NULL);
+
+    parse_test_context* context = new parse_test_context();
+    ASSERT_FALSE(qjson_parse_buffer_with_parser(parser, "[1, [2, ", 8, &callbacks, context));
+
+    std::string long_string(10000, 'x');
+    std::string json = "[\"" + long_string + "\", {\"a\": 1}]";
+    for(int i = 0; i < 3; i++)
+    {
+        delete context;
+        context = new parse_test_context();
+        ASSERT_TRUE(qjson_parse_buffer_with_parser(parser, json.data(), json.size(), &callbacks, context));
+        ASSERT_EQ(7, parse_get_item_count(context));
+        ASSERT_EQ(long_string, parse_get_string(context, 1));
+    }
+
+    delete context;
+    context = new parse_test_context();
+    qjson_reset_parser(parser, &callbacks, context);
+    ASSERT_TRUE(qjson_feed_parser(parser, "{\"b\": tr", 8));
+    ASSERT_TRUE(qjson_feed_parser(parser, "ue}", 3));
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    ASSERT_EQ(4, parse_get_item_count(context));
+
+    qjson_free_parser(parser);
+    delete context;
+}
+
+TEST(QJson_Reuse, thread_pool)
+{
+    qjson_parser* first = qjson_acquire_thread_parser();
+    qjson_parser* second = qjson_acquire_thread_parser();
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(first, second);
+    qjson_release_thread_parser(second);
+    qjson_release_thread_parser(first);
+    ASSERT_EQ(first, qjson_acquire_thread_parser());
+    ASSERT_EQ(second, qjson_acquire_thread_parser());
+    qjson_release_thread_parser(second);
+    qjson_release_thread_parser(first);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include <string>
+
+static qjson_document* parse(const std::string& json)
+{
+    qjson_document* document = qjson_new_document();
+    EXPECT_TRUE(qjson_parse_into_document(document, json.data(), json.size())) << qjson_document_error(document);
+    return document;
+}
+
+static std::string get_string(qjson_value value)
+{
+    size_t length = 0;
+    const char* str = qjson_value_string(value, &length);
+    return std::string(str, length);
+}
+
+TEST(QJson_Tape, scalars)
+{
+    qjson_document* document = parse("[null, true, false, -12345678901, 1.5, \"\", \"1234567\", \"12345678\", \"\\u00e9\"]");
+    qjson_value root = qjson_document_root(document);
+    ASSERT_EQ(QJSON_TYPE_LIST, qjson_value_type(root));
+    ASSERT_EQ(9u, qjson_value_count(root));
+
+    qjson_value value = qjson_value_first(root);
+    ASSERT_EQ(QJSON_TYPE_NULL, qjson_value_type(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ(QJSON_TYPE_BOOLEAN, qjson_value_type(value));
+    ASSERT_TRUE(qjson_value_boolean(value));
+    value = qjson_value_next(value);
+    ASSERT_FALSE(qjson_value_boolean(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ(QJSON_TYPE_INT, qjson_value_type(value));
+    ASSERT_EQ(-12345678901, qjson_value_int(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ(QJSON_TYPE_FLOAT, qjson_value_type(value));
+    ASSERT_EQ(1.5, qjson_value_float(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ(QJSON_TYPE_STRING, qjson_value_type(value));
+    ASSERT_EQ("", get_string(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ("1234567", get_string(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ("12345678", get_string(value));
+    ASSERT_STREQ("12345678", qjson_value_string(value, NULL));
+    value = qjson_value_next(value);
+    ASSERT_EQ("\xc3\xa9", get_string(value));
+    value = qjson_value_next(value);
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(value));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_next(value)));
+
+    qjson_free_document(document);
+}
+
+TEST(QJson_Tape, top_level_scalar)
+{
+    qjson_document* document = parse(" \"top\" ");
+    qjson_value root = qjson_document_root(document);
+    ASSERT_EQ("top", get_string(root));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_next(root)));
+    qjson_free_document(document);
+}
+
+TEST(QJson_Tape, containers)
+{
+    qjson_document* document = parse("{\"a\": {\"x\": [1, [2, 3], {}], \"y\": \"why\"}, \"b\": [], \"c\": {\"d\": 4.25}}");
+    qjson_value root = qjson_document_root(document);
+    ASSERT_EQ(QJSON_TYPE_MAP, qjson_value_type(root));
+    ASSERT_EQ(3u, qjson_value_count(root));
+
+    // Skipping the first field's value jumps straight to the next key.
+    qjson_value key = qjson_value_first(root);
+    ASSERT_EQ("a", get_string(key));
+    key = qjson_value_next(qjson_value_next(key));
+    ASSERT_EQ("b", get_string(key));
+
+    qjson_value a = qjson_value_field(root, "a");
+    ASSERT_EQ(QJSON_TYPE_MAP, qjson_value_type(a));
+    ASSERT_EQ(2u, qjson_value_count(a));
+    ASSERT_EQ("why", get_string(qjson_value_field(a, "y")));
+
+    qjson_value x = qjson_value_field(a, "x");
+    ASSERT_EQ(3u, qjson_value_count(x));
+    qjson_value nested = qjson_value_next(qjson_value_first(x));
+    ASSERT_EQ(QJSON_TYPE_LIST, qjson_value_type(nested));
+    ASSERT_EQ(3, qjson_value_int(qjson_value_next(qjson_value_first(nested))));
+    qjson_value empty_map = qjson_value_next(nested);
+    ASSERT_EQ(QJSON_TYPE_MAP, qjson_value_type(empty_map));
+    ASSERT_EQ(0u, qjson_value_count(empty_map));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_first(empty_map)));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_next(empty_map)));
+
+    qjson_value b = qjson_value_field(root, "b");
+    ASSERT_EQ(QJSON_TYPE_LIST, qjson_value_type(b));
+    ASSERT_EQ(0u, qjson_value_count(b));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_first(b)));
+
+    ASSERT_EQ(4.25, qjson_value_float(qjson_value_field(qjson_value_field(root, "c"), "d")));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_field(root, "d")));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_field(root, "")));
+
+    qjson_free_document(document);
+}
+
+TEST(QJson_Tape, reuse_and_failure)
+{
+    qjson_document* document = qjson_new_document();
+    std::string json = "[";
+    for(int i = 0; i < 10000; i++)
+    {
+        json += std::to_string(i) + ", \"string " + std::to_string(i) + "\", ";
+    }
+    json += "{}]";
+
+    for(int i = 0; i < 2; i++)
+    {
+        ASSERT_TRUE(qjson_parse_into_document(document, json.data(), json.size()));
+        ASSERT_EQ(NULL, qjson_document_error(document));
+        qjson_value root = qjson_document_root(document);
+        ASSERT_EQ(20001u, qjson_value_count(root));
+        qjson_value value = qjson_value_first(root);
+        for(int j = 0; j < 10000; j++)
+        {
+            ASSERT_EQ(j, qjson_value_int(value));
+            value = qjson_value_next(value);
+            ASSERT_EQ("string " + std::to_string(j), get_string(value));
+            value = qjson_value_next(value);
+        }
+        ASSERT_EQ(QJSON_TYPE_MAP, qjson_value_type(value));
+    }
+
+    ASSERT_FALSE(qjson_parse_into_document(document, "[1, 2", 5));
+    ASSERT_STREQ("Unexpected end of document at offset 5", qjson_document_error(document));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_document_root(document)));
+
+    ASSERT_TRUE(qjson_parse_into_document(document, "{\"k\": null}", 11));
+    ASSERT_EQ(QJSON_TYPE_NULL, qjson_value_type(qjson_value_field(qjson_document_root(document), "k")));
+
+    qjson_free_document(document);
+}
+
+TEST(QJson_Tape, missing_values)
+{
+    qjson_document* document = parse("{\"a\": 1}");
+    qjson_value missing = qjson_value_field(qjson_document_root(document), "b");
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(missing));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_first(missing)));
+    ASSERT_EQ(QJSON_TYPE_NONE, qjson_value_type(qjson_value_first(qjson_value_field(qjson_document_root(document), "a"))));
+    qjson_free_document(document);
+}
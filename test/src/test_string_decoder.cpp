@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include "string_decoder.h"
+#include "structural_index.h"
+#include <stdlib.h>
+#include <string>
+
+static const simd_level g_all_levels[] = {SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, SIMD_LEVEL_AVX512};
+
+struct decode_result
+{
+    string_decode_status status;
+    std::string output;
+    size_t error_offset;
+
+    bool operator==(const decode_result& other) const
+    {
+        return status == other.status && output == other.output && error_offset == other.error_offset;
+    }
+};
+
+static decode_result decode(const std::string& input)
+{
+    std::string buffer(input.size() + 1, 0);
+    char* end = NULL;
+    const char* error_pos = NULL;
+    decode_result result;
+    result.status = decode_json_string(input.data(), input.data() + input.size(), &buffer[0], &end, &error_pos);
+    result.error_offset = result.status == STRING_DECODE_OK ? 0 : error_pos - input.data();
+    if(result.status == STRING_DECODE_OK)
+    {
+        result.output.assign(buffer.data(), end);
+    }
+    return result;
+}
+
+static decode_result decode_in_place(const std::string& input)
+{
+    std::string buffer = input;
+    char* end = NULL;
+    const char* error_pos = NULL;
+    decode_result result;
+    result.status = decode_json_string(&buffer[0], &buffer[0] + buffer.size(), &buffer[0], &end, &error_pos);
+    result.error_offset = result.status == STRING_DECODE_OK ? 0 : error_pos - buffer.data();
+    if(result.status == STRING_DECODE_OK)
+    {
+        result.output.assign(buffer.data(), end);
+    }
+    return result;
+}
+
+// Pads the input on both sides so that it straddles the vector boundaries.
+static std::string pad(const std::string& prefix_filler, const std::string& input)
+{
+    return prefix_filler + input + std::string(40, 'z');
+}
+
+static void expect_decoded_at_each_level(const std::string& input, const std::string& expected)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    for(simd_level level: g_all_levels)
+    {
+        if(!structural_index_set_simd_level(level))
+        {
+            continue;
+        }
+        for(size_t offset = 0; offset < 40; offset += 13)
+        {
+            std::string filler(offset, 'y');
+            decode_result result = decode(pad(filler, input));
+            ASSERT_EQ(STRING_DECODE_OK, result.status) << "level " << level << ", offset " << offset;
+            ASSERT_EQ(pad(filler, expected), result.output) << "level " << level << ", offset " << offset;
+            ASSERT_EQ(result, decode_in_place(pad(filler, input))) << "level " << level << ", offset " << offset;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+static void expect_failure_at_each_level(const std::string& input, string_decode_status status, size_t error_offset)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    for(simd_level level: g_all_levels)
+    {
+        if(!structural_index_set_simd_level(level))
+        {
+            continue;
+        }
+        for(size_t offset = 0; offset < 40; offset += 13)
+        {
+            decode_result result = decode(pad(std::string(offset, 'y'), input));
+            ASSERT_EQ(status, result.status) << "level " << level << ", offset " << offset;
+            ASSERT_EQ(offset + error_offset, result.error_offset) << "level " << level << ", offset " << offset;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+TEST(QJson_StringDecoder, escapes)
+{
+    expect_decoded_at_each_level("a\\nb\\tc\\\\d\\\"e\\/f\\bg\\fh\\ri", "a\nb\tc\\d\"e/f\bg\fh\ri");
+    expect_decoded_at_each_level("\\u0041\\u00e9\\u4E2D", "A\xc3\xa9\xe4\xb8\xad");
+    expect_decoded_at_each_level("\\ud83d\\ude00", "\xf0\x9f\x98\x80");
+    expect_decoded_at_each_level("\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\", "\\\\\\\\\\\\\\\\\\\\");
+}
+
+TEST(QJson_StringDecoder, valid_utf8)
+{
+    expect_decoded_at_each_level("\xc2\x80\xdf\xbf", "\xc2\x80\xdf\xbf");
+    expect_decoded_at_each_level("\xe0\xa0\x80\xed\x9f\xbf\xee\x80\x80\xef\xbf\xbf", "\xe0\xa0\x80\xed\x9f\xbf\xee\x80\x80\xef\xbf\xbf");
+    expect_decoded_at_each_level("\xf0\x90\x80\x80\xf4\x8f\xbf\xbf", "\xf0\x90\x80\x80\xf4\x8f\xbf\xbf");
+    expect_decoded_at_each_level("\xc3\xa9\\n\xe4\xb8\xad\\u00e9\xf0\x9f\x98\x80", "\xc3\xa9\n\xe4\xb8\xad\xc3\xa9\xf0\x9f\x98\x80");
+}
+
+TEST(QJson_StringDecoder, invalid_utf8)
+{
+    // Lone continuation
+    expect_failure_at_each_level("ab\x80", STRING_DECODE_BAD_UTF8, 2);
+    // Overlong encodings
+    expect_failure_at_each_level("\xc0\xaf", STRING_DECODE_BAD_UTF8, 0);
+    expect_failure_at_each_level("\xe0\x80\xaf", STRING_DECODE_BAD_UTF8, 1);
+    expect_failure_at_each_level("\xf0\x80\x80\xaf", STRING_DECODE_BAD_UTF8, 1);
+    // Surrogate
+    expect_failure_at_each_level("\xed\xa0\x80", STRING_DECODE_BAD_UTF8, 1);
+    // Above U+10FFFF
+    expect_failure_at_each_level("\xf4\x90\x80\x80", STRING_DECODE_BAD_UTF8, 1);
+    expect_failure_at_each_level("\xf5\x80\x80\x80", STRING_DECODE_BAD_UTF8, 0);
+    expect_failure_at_each_level("\xff", STRING_DECODE_BAD_UTF8, 0);
+    // Truncated sequences
+    expect_failure_at_each_level("\xe4\xb8z", STRING_DECODE_BAD_UTF8, 2);
+    expect_failure_at_each_level("\xf0\x9f\x98\\n", STRING_DECODE_BAD_UTF8, 3);
+}
+
+TEST(QJson_StringDecoder, invalid_utf8_at_end)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    for(simd_level level: g_all_levels)
+    {
+        if(!structural_index_set_simd_level(level))
+        {
+            continue;
+        }
+        for(size_t length = 0; length < 70; length++)
+        {
+            decode_result result = decode(std::string(length, 'x') + "\xf0\x9f\x98");
+            ASSERT_EQ(STRING_DECODE_BAD_UTF8, result.status) << "level " << level << ", length " << length;
+            ASSERT_EQ(length, result.error_offset) << "level " << level << ", length " << length;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+TEST(QJson_StringDecoder, invalid_escapes)
+{
+    expect_failure_at_each_level("ab\\x", STRING_DECODE_BAD_ESCAPE, 2);
+    expect_failure_at_each_level("\\u12g4", STRING_DECODE_BAD_ESCAPE, 0);
+    expect_failure_at_each_level("\\ude00", STRING_DECODE_BAD_ESCAPE, 0);
+    expect_failure_at_each_level("\\ud83d\\u0041", STRING_DECODE_BAD_ESCAPE, 0);
+    expect_failure_at_each_level("\\ud83dz", STRING_DECODE_BAD_ESCAPE, 0);
+}
+
+TEST(QJson_StringDecoder, control_characters)
+{
+    expect_failure_at_each_level("a\x01\x1f b", STRING_DECODE_CONTROL_CHARACTER, 1);
+    expect_failure_at_each_level("ab\tc", STRING_DECODE_CONTROL_CHARACTER, 2);
+    expect_failure_at_each_level("\n", STRING_DECODE_CONTROL_CHARACTER, 0);
+    expect_failure_at_each_level(std::string("a\0b", 3), STRING_DECODE_CONTROL_CHARACTER, 1);
+    expect_failure_at_each_level("\xc3\xa9\\n\x1f", STRING_DECODE_CONTROL_CHARACTER, 4);
+    // Escaped control characters and DEL are fine.
+    expect_decoded_at_each_level("\\u0001\\t\x7f", "\x01\t\x7f");
+}
+
+TEST(QJson_StringDecoder, levels_match_scalar)
+{
+    static const char* const pieces[] =
+    {
+        "a", "b", " ", "\\n", "\\\\", "\\\"", "\\u0041", "\\u4e2d", "\\ud83d\\ude00",
+        "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80", "\xed\x9f\xbf",
+        "\xc3", "\xa9", "\xe0\x80\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xff", "\\x", "\\ud83d",
+        "\x01", "\t", "\x1f",
+    };
+    static const size_t valid_piece_count = 13;
+    static const size_t piece_count = sizeof(pieces) / sizeof(*pieces);
+
+    simd_level original_level = structural_index_get_simd_level();
+    srand(1);
+    for(int iteration = 0; iteration < 3000; iteration++)
+    {
+        const bool allow_invalid = iteration % 4 == 0;
+        std::string input;
+        size_t length = rand() % 150;
+        while(input.size() < length)
+        {
+            input += pieces[rand() % (allow_invalid ? piece_count : valid_piece_count)];
+        }
+
+        structural_index_set_simd_level(SIMD_LEVEL_SCALAR);
+        decode_result expected = decode(input);
+        for(simd_level level: g_all_levels)
+        {
+            if(!structural_index_set_simd_level(level))
+            {
+                continue;
+            }
+            ASSERT_EQ(expected, decode(input)) << "level " << level << ", iteration " << iteration;
+            ASSERT_EQ(expected, decode_in_place(input)) << "level " << level << ", iteration " << iteration;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include "string_encoder.h"
+#include "structural_index.h"
+#include <stdlib.h>
+#include <string>
+
+static const simd_level g_all_levels[] = {SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, SIMD_LEVEL_AVX512};
+
+static size_t reference_find(const std::string& input)
+{
+    for(size_t i = 0; i < input.size(); i++)
+    {
+        const uint8_t ch = (uint8_t)input[i];
+        if(ch < 0x20 || ch == '"' || ch == '\\')
+        {
+            return i;
+        }
+    }
+    return input.size();
+}
+
+static size_t find(const std::string& input)
+{
+    return (size_t)(find_byte_to_escape(input.data(), input.data() + input.size()) - input.data());
+}
+
+TEST(QJson_StringEncoder, every_byte)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    for(simd_level level: g_all_levels)
+    {
+        if(!structural_index_set_simd_level(level))
+        {
+            continue;
+        }
+        for(int byte = 0; byte < 256; byte++)
+        {
+            for(size_t position: {0, 5, 15, 16, 31, 32, 47, 70})
+            {
+                std::string input(80, 'a');
+                input[position] = (char)byte;
+                ASSERT_EQ(reference_find(input), find(input)) << "level " << level << ", byte " << byte << ", position " << position;
+            }
+        }
+        ASSERT_EQ(0u, find(""));
+        ASSERT_EQ(3u, find("\xc3\xa9\x7f"));
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+TEST(QJson_StringEncoder, random)
+{
+    static const char pieces[] = {'a', 'z', ' ', '~', '"', '\\', '\n', '\x01', '\x1f', '\x7f', '\x80', '\xff'};
+
+    simd_level original_level = structural_index_get_simd_level();
+    srand(1);
+    for(int iteration = 0; iteration < 3000; iteration++)
+    {
+        std::string input;
+        size_t length = rand() % 150;
+        // Mostly plain text, so that the interesting byte lands at any offset within a vector.
+        while(input.size() < length)
+        {
+            input += rand() % 40 == 0 ? pieces[rand() % sizeof(pieces)] : 'm';
+        }
+        size_t expected = reference_find(input);
+        for(simd_level level: g_all_levels)
+        {
+            if(!structural_index_set_simd_level(level))
+            {
+                continue;
+            }
+            ASSERT_EQ(expected, find(input)) << "level " << level << ", iteration " << iteration;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
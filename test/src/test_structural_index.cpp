@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <qjson/qjson.h>
+#include "structural_index.h"
+#include "parse_test_helpers.h"
+#include "managed_allocator.h"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static const simd_level g_all_levels[] = {SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, SIMD_LEVEL_AVX512};
+
+static bool is_operator(char ch)
+{
+    return ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ',' || ch == ':';
+}
+
+static bool is_whitespace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static std::vector<uint32_t> reference_index(const std::string& data)
+{
+    std::vector<uint32_t> positions;
+    bool is_escaped = false;
+    bool is_in_string = false;
+    bool follows_scalar = false;
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        char ch = data[i];
+        bool was_escaped = is_escaped;
+        is_escaped = ch == '\\' && !was_escaped;
+        if(ch == '"' && !was_escaped)
+        {
+            positions.push_back(i);
+            is_in_string = !is_in_string;
+            follows_scalar = false;
+        }
+        else if(is_in_string || is_whitespace(ch))
+        {
+            follows_scalar = false;
+        }
+        else if(is_operator(ch))
+        {
+            positions.push_back(i);
+            follows_scalar = false;
+        }
+        else
+        {
+            if(!follows_scalar)
+            {
+                positions.push_back(i);
+            }
+            follows_scalar = true;
+        }
+    }
+    return positions;
+}
+
+static std::vector<uint32_t> simd_index(const std::string& data, size_t window_size)
+{
+    std::vector<uint32_t> positions;
+    std::vector<uint64_t> structurals(window_size / STRUCTURAL_BLOCK_SIZE);
+    std::vector<uint64_t> backslashes(window_size / STRUCTURAL_BLOCK_SIZE);
+    structural_scanner scanner;
+    structural_scanner_init(&scanner);
+    for(size_t offset = 0; offset < data.size(); offset += window_size)
+    {
+        size_t length = data.size() - offset < window_size ? data.size() - offset : window_size;
+        size_t count = structural_index_window(&scanner, data.data() + offset, length, structurals.data(), backslashes.data());
+        for(size_t block = 0; block < count; block++)
+        {
+            for(int bit = 0; bit < STRUCTURAL_BLOCK_SIZE; bit++)
+            {
+                size_t position = offset + block * STRUCTURAL_BLOCK_SIZE + bit;
+                if(structurals[block] & (1ULL << bit))
+                {
+                    positions.push_back(position);
+                }
+                bool is_backslash = position < data.size() && data[position] == '\\';
+                EXPECT_EQ(is_backslash, (backslashes[block] & (1ULL << bit)) != 0);
+            }
+        }
+    }
+    return positions;
+}
+
+static std::string random_document(size_t length)
+{
+    static const char alphabet[] = "\"\"\\\\  \t\n{}[],:a1\xc3\xa9x";
+    std::string data;
+    for(size_t i = 0; i < length; i++)
+    {
+        data += alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    return data;
+}
+
+TEST(QJson_StructuralIndex, matches_reference)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    srand(1);
+    for(int iteration = 0; iteration < 500; iteration++)
+    {
+        std::string data = random_document(rand() % 700);
+        std::vector<uint32_t> expected = reference_index(data);
+        for(simd_level level: g_all_levels)
+        {
+            if(!structural_index_set_simd_level(level))
+            {
+                continue;
+            }
+            ASSERT_EQ(expected, simd_index(data, 64)) << "level " << level;
+            ASSERT_EQ(expected, simd_index(data, 256)) << "level " << level;
+            ASSERT_EQ(expected, simd_index(data, 4096)) << "level " << level;
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+TEST(QJson_StructuralIndex, backslash_runs_across_blocks)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    for(size_t run_length = 1; run_length < 140; run_length++)
+    {
+        for(size_t start = 55; start < 70; start++)
+        {
+            std::string data = std::string(start, ' ') + "\"" + std::string(run_length, '\\') + "\"  , \"x\" 1";
+            std::vector<uint32_t> expected = reference_index(data);
+            for(simd_level level: g_all_levels)
+            {
+                if(structural_index_set_simd_level(level))
+                {
+                    ASSERT_EQ(expected, simd_index(data, 64)) << "level " << level;
+                }
+            }
+        }
+    }
+    structural_index_set_simd_level(original_level);
+}
+
+static std::string pretty_document()
+{
+    std::string json = "{\n";
+    for(int i = 0; i < 200; i++)
+    {
+        json += "    \"key" + std::to_string(i) + "\": {\n";
+        json += "        \"text\": \"" + std::string(i % 97, 'a' + i % 26) + (i % 3 == 0 ? "\\\"\\\\\\n" : "") + "\",\n";
+        json += "        \"list\": [ " + std::to_string(i) + " , -" + std::to_string(i) + ".5e3 , true , null , false ],\n";
+        json += "        \"empty\": [ ] , \"nested\" : { }\n";
+        json += "    }" + std::string(i < 199 ? "," : "") + "\n";
+    }
+    return json + "}\n";
+}
+
+TEST(QJson_StructuralIndex, parse_with_each_level)
+{
+    simd_level original_level = structural_index_get_simd_level();
+    std::string json = pretty_document();
+    qjson_parse_callbacks callbacks = parse_new_callbacks();
+
+    // Chunks below the indexing threshold are parsed unindexed, which gives the reference event stream.
+    managed_free_all();
+    parse_test_context* expected = new parse_test_context();
+    qjson_parser* parser = qjson_new_parser(&callbacks, expected);
+    for(size_t offset = 0; offset < json.size(); offset += 16)
+    {
+        ASSERT_TRUE(qjson_feed_parser(parser, json.data() + offset, json.size() - offset < 16 ? json.size() - offset : 16));
+    }
+    ASSERT_TRUE(qjson_finish_parser(parser));
+    qjson_free_parser(parser);
+
+    for(simd_level level: g_all_levels)
+    {
+        if(!structural_index_set_simd_level(level))
+        {
+            continue;
+        }
+        parse_test_context* actual = new parse_test_context();
+        ASSERT_TRUE(qjson_parse_buffer(json.data(), json.size(), &callbacks, actual));
+        ASSERT_EQ(parse_get_item_count(expected), parse_get_item_count(actual));
+        for(int i = 0; i < parse_get_item_count(expected); i++)
+        {
+            ASSERT_EQ(parse_get_type(expected, i), parse_get_type(actual, i));
+            if(parse_get_type(expected, i) == TYPE_STRING)
+            {
+                ASSERT_STREQ(parse_get_string(expected, i), parse_get_string(actual, i));
+            }
+        }
+        delete actual;
+
+        std::string broken = json;
+        broken[json.size() / 2] = '@';
+        actual = new parse_test_context();
+        ASSERT_FALSE(qjson_parse_buffer(broken.data(), broken.size(), &callbacks, actual));
+        delete actual;
+    }
+    delete expected;
+    structural_index_set_simd_level(original_level);
+}